@@ -1,19 +1,21 @@
 #include "akiro.h"
 
+#include <assert.h>
+
 // EASTL MEMORY OVERLOADS
 // ----------------------
 
+// NOTE: akiro is a build tool and doesn't link the engine allocator from
+// core.cpp. EASTL frees with a plain delete[], so these can't over-allocate
+// for alignment, instead they check that operator new[] alignment suffices.
 void* operator new[](size_t size, size_t alignment, size_t alignmentOffset, const char* pName, int flags, unsigned debugFlags, const char* file, int line)
 {
-	//rgLog("new[] size=%ld alignment=%ld alignmentOffset=%ld name=%s flags=%d debugFlags=%d file=%s line=%d\n",
-	//    size, alignment, alignmentOffset, pName, flags, debugFlags, file, line);
+	assert(alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__ && alignmentOffset == 0);
 	return new uint8_t[size];
 }
 
-void* __cdecl operator new[](size_t size, const char* name, int flags, unsigned debugFlags, const char* file, int line)
+void* operator new[](size_t size, const char* name, int flags, unsigned debugFlags, const char* file, int line)
 {
-	//rgLog("new[] size=%ld name=%s flags=%d debugFlags=%d file=%s line=%d\n",
-	//    size, name, flags, debugFlags, file, line);
 	return new uint8_t[size];
 }
 
@@ -1,386 +1,3167 @@
 #include "core.h"
 #include "gfx.h"
 
+#include "pack.h"
+
 #include "backends/imgui_impl_sdl2.h"
 
+#include <EASTL/sort.h>
+
+#include <atomic>
+#include <new>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 SDL_Window* g_AppMainWindow;
-rgBool      g_ShouldAppQuit;
+std::atomic<rgBool> g_ShouldAppQuit;
 u32      g_FrameNumber;
 WindowInfo  g_WindowInfo;
 
-// EASTL MEMORY OVERLOADS
-// ----------------------
+// MEMORY
+// ------
 
-void* operator new[](size_t size, size_t alignment, size_t alignmentOffset, const char* pName, int flags, unsigned debugFlags, const char* file, int line)
+static const u32 kMemoryMaxTags = 256;
+static const u16 kMemoryHeaderMagic = 0xA110;
+static const rgSize kMemoryMallocAlignment = alignof(max_align_t);
+
+// Placed right before every pointer returned by memAlloc()
+struct MemoryHeader
+{
+    u64 size;
+    u32 offset;     // From the malloc'd pointer to the user pointer
+    u16 tagIndex;
+    u16 magic;
+};
+static_assert(sizeof(MemoryHeader) % kMemoryMallocAlignment == 0, "MemoryHeader must keep the malloc alignment");
+
+#if defined(RG_ENABLE_MEMORY_TRACKING)
+// NOTE: Everything here is zero initialized, so it's usable by allocations
+// made before main(), during the static initialization
+struct MemoryTagStats
+{
+    char const*         name;
+    std::atomic<i64>    liveBytes;
+    std::atomic<i64>    peakBytes;
+    std::atomic<i64>    liveCount;
+    std::atomic<u64>    totalCount;
+};
+
+static MemoryTagStats   memoryTags[kMemoryMaxTags]; // memoryTags[0] collects untagged allocations
+static std::atomic<u32> memoryTagCount;
+static SDL_SpinLock     memoryTagsLock;
+static std::atomic<i64> memoryTotalLiveBytes;
+static std::atomic<i64> memoryTotalPeakBytes;
+
+static thread_local char const* memoryLastTagName;
+static thread_local u16         memoryLastTagIndex;
+
+static void memoryUpdatePeak(std::atomic<i64>* peak, i64 value)
 {
-    //rgLog("new[] size=%ld alignment=%ld alignmentOffset=%ld name=%s flags=%d debugFlags=%d file=%s line=%d\n",
-    //    size, alignment, alignmentOffset, pName, flags, debugFlags, file, line);
-    return new uint8_t[size];
+    i64 currentPeak = peak->load(std::memory_order_relaxed);
+    while(value > currentPeak && !peak->compare_exchange_weak(currentPeak, value, std::memory_order_relaxed))
+    {
+    }
 }
 
-void* __cdecl operator new[](size_t size, const char* name, int flags, unsigned debugFlags, const char* file, int line)
+static u16 memoryFindOrAddTag(char const* name)
 {
-    //rgLog("new[] size=%ld name=%s flags=%d debugFlags=%d file=%s line=%d\n",
-    //    size, name, flags, debugFlags, file, line);
-    return new uint8_t[size];
+    if(name == nullptr)
+    {
+        return 0;
+    }
+
+    // Most allocations in a row come from the same place
+    if(name == memoryLastTagName)
+    {
+        return memoryLastTagIndex;
+    }
+
+    u16 tagIndex = 0;
+    SDL_AtomicLock(&memoryTagsLock);
+    u32 tagCount = memoryTagCount.load(std::memory_order_relaxed);
+    u32 i = 1;
+    for(; i < tagCount; ++i)
+    {
+        if(memoryTags[i].name == name || SDL_strcmp(memoryTags[i].name, name) == 0)
+        {
+            break;
+        }
+    }
+    if(i < tagCount)
+    {
+        tagIndex = (u16)i;
+    }
+    else if(tagCount < kMemoryMaxTags)
+    {
+        tagCount = eastl::max(tagCount, 1u); // Skip the untagged slot
+        memoryTags[tagCount].name = name;
+        memoryTagCount.store(tagCount + 1, std::memory_order_release);
+        tagIndex = (u16)tagCount;
+    }
+    SDL_AtomicUnlock(&memoryTagsLock);
+
+    memoryLastTagName = name;
+    memoryLastTagIndex = tagIndex;
+    return tagIndex;
 }
+#endif
 
-// THE APP
-// -------
+void* memAllocOffset(rgSize size, rgSize alignment, rgSize alignmentOffset, char const* tag)
+{
+    alignment = eastl::max(alignment, kMemoryMallocAlignment);
+    rgAssert((alignment & (alignment - 1)) == 0);
 
-AppInput* theAppInput;
-static AppInput* oldAppInput, *newAppInput;
+    // malloc() alignment is enough unless more is asked for
+    rgSize padding = (alignment > kMemoryMallocAlignment || alignmentOffset != 0) ? alignment + alignmentOffset : 0;
+    u8* base = (u8*)malloc(sizeof(MemoryHeader) + padding + size);
+    if(base == nullptr)
+    {
+        rgAssert(!"Out of memory");
+        return nullptr;
+    }
 
-static rgBool processGameButtonState(GameButtonState* newButtonState, rgBool isDown)
+    rgUPtr user = (rgUPtr)base + sizeof(MemoryHeader);
+    if(padding != 0)
+    {
+        user = ((user + alignmentOffset + alignment - 1) & ~(rgUPtr)(alignment - 1)) - alignmentOffset;
+    }
+
+    MemoryHeader* header = (MemoryHeader*)user - 1;
+    header->size = size;
+    header->offset = (u32)(user - (rgUPtr)base);
+    header->magic = kMemoryHeaderMagic;
+    header->tagIndex = 0;
+
+#if defined(RG_ENABLE_MEMORY_TRACKING)
+    header->tagIndex = memoryFindOrAddTag(tag);
+    MemoryTagStats* stats = &memoryTags[header->tagIndex];
+    i64 liveBytes = stats->liveBytes.fetch_add((i64)size, std::memory_order_relaxed) + (i64)size;
+    memoryUpdatePeak(&stats->peakBytes, liveBytes);
+    stats->liveCount.fetch_add(1, std::memory_order_relaxed);
+    stats->totalCount.fetch_add(1, std::memory_order_relaxed);
+    i64 totalLiveBytes = memoryTotalLiveBytes.fetch_add((i64)size, std::memory_order_relaxed) + (i64)size;
+    memoryUpdatePeak(&memoryTotalPeakBytes, totalLiveBytes);
+#endif
+
+    return (void*)user;
+}
+
+void* memAlloc(rgSize size, rgSize alignment, char const* tag)
 {
-    if(newButtonState->endedDown != isDown)
+    return memAllocOffset(size, alignment, 0, tag);
+}
+
+void memFree(void* ptr)
+{
+    if(ptr == nullptr)
     {
-        newButtonState->endedDown = isDown;
-        ++newButtonState->halfTransitionCount;
-        return true;
+        return;
     }
-    return false;
+
+    MemoryHeader* header = (MemoryHeader*)ptr - 1;
+    rgAssert(header->magic == kMemoryHeaderMagic); // Not allocated by memAlloc() or freed twice
+    header->magic = 0;
+
+#if defined(RG_ENABLE_MEMORY_TRACKING)
+    MemoryTagStats* stats = &memoryTags[header->tagIndex];
+    stats->liveBytes.fetch_sub((i64)header->size, std::memory_order_relaxed);
+    stats->liveCount.fetch_sub(1, std::memory_order_relaxed);
+    memoryTotalLiveBytes.fetch_sub((i64)header->size, std::memory_order_relaxed);
+#endif
+
+    free((u8*)ptr - header->offset);
 }
 
-static rgBool processGameInputs(SDL_Event* event, AppInput* appInput)
+void memShowImGuiWindow(bool* open)
 {
-    GameControllerInput* controller1 = &appInput->controllers[0];
-    
-    switch(event->type)
+    ImGui::SetNextWindowSize(ImVec2(600, 400), ImGuiCond_FirstUseEver);
+    if(ImGui::Begin("Memory", open))
     {
-        case SDL_KEYDOWN:
-        case SDL_KEYUP:
+#if defined(RG_ENABLE_MEMORY_TRACKING)
+        ImGui::Text("Live %0.2f MB, Peak %0.2f MB", memoryTotalLiveBytes.load() / (1024.0 * 1024.0), memoryTotalPeakBytes.load() / (1024.0 * 1024.0));
+
+        ImGuiTableFlags tableFlags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_Sortable | ImGuiTableFlags_ScrollY | ImGuiTableFlags_Resizable;
+        if(ImGui::BeginTable("MemoryTags", 5, tableFlags))
         {
-            if(!event->key.repeat)
+            ImGui::TableSetupScrollFreeze(0, 1);
+            ImGui::TableSetupColumn("Tag");
+            ImGui::TableSetupColumn("Live KB", ImGuiTableColumnFlags_DefaultSort | ImGuiTableColumnFlags_PreferSortDescending);
+            ImGui::TableSetupColumn("Peak KB", ImGuiTableColumnFlags_PreferSortDescending);
+            ImGui::TableSetupColumn("Live Count", ImGuiTableColumnFlags_PreferSortDescending);
+            ImGui::TableSetupColumn("Total Count", ImGuiTableColumnFlags_PreferSortDescending);
+            ImGui::TableHeadersRow();
+
+            u32 tagCount = eastl::max(memoryTagCount.load(std::memory_order_acquire), 1u);
+            u16 order[kMemoryMaxTags];
+            for(u32 i = 0; i < tagCount; ++i)
             {
-                rgBool isDown = (event->key.state == SDL_PRESSED);
-                switch(event->key.keysym.sym)
+                order[i] = (u16)i;
+            }
+
+            ImGuiTableSortSpecs* sortSpecs = ImGui::TableGetSortSpecs();
+            if(sortSpecs != nullptr && sortSpecs->SpecsCount > 0)
+            {
+                ImGuiTableColumnSortSpecs const& spec = sortSpecs->Specs[0];
+                auto value = [&spec](u16 i) -> i64
                 {
-                    case SDLK_w:
-                    case SDLK_UP:
-                    {
-                        processGameButtonState(&controller1->forward, isDown);
-                    } break;
-                        
-                    case SDLK_s:
-                    case SDLK_DOWN:
-                    {
-                        processGameButtonState(&controller1->backward, isDown);
-                    } break;
-                        
-                    case SDLK_a:
-                    case SDLK_LEFT:
-                    {
-                        processGameButtonState(&controller1->left, isDown);
-                    } break;
-                        
-                    case SDLK_d:
-                    case SDLK_RIGHT:
-                    {
-                        processGameButtonState(&controller1->right, isDown);
-                    } break;
-                    
-                    case SDLK_q:
-                    case SDLK_c:
-                    {
-                        processGameButtonState(&controller1->up, isDown);
-                    } break;
-                        
-                    case SDLK_e:
-                    case SDLK_f:
+                    switch(spec.ColumnIndex)
                     {
-                        processGameButtonState(&controller1->down, isDown);
-                    } break;
-                    
-                    case SDLK_ESCAPE:
+                        case 1: return memoryTags[i].liveBytes.load(std::memory_order_relaxed);
+                        case 2: return memoryTags[i].peakBytes.load(std::memory_order_relaxed);
+                        case 3: return memoryTags[i].liveCount.load(std::memory_order_relaxed);
+                        case 4: return (i64)memoryTags[i].totalCount.load(std::memory_order_relaxed);
+                    }
+                    return 0;
+                };
+                eastl::sort(order, order + tagCount, [&](u16 a, u16 b)
+                {
+                    if(spec.ColumnIndex == 0)
                     {
-                        SDL_Event quitEvent;
-                        quitEvent.type = SDL_QUIT;
-                        SDL_PushEvent(&quitEvent);
-                    } break;
-                }
+                        char const* nameA = memoryTags[a].name ? memoryTags[a].name : "";
+                        char const* nameB = memoryTags[b].name ? memoryTags[b].name : "";
+                        i32 c = SDL_strcmp(nameA, nameB);
+                        return spec.SortDirection == ImGuiSortDirection_Ascending ? c < 0 : c > 0;
+                    }
+                    return spec.SortDirection == ImGuiSortDirection_Ascending ? value(a) < value(b) : value(a) > value(b);
+                });
             }
-        } break;
-            
-        case SDL_MOUSEMOTION:
-        {
-            appInput->mouse.x = event->motion.x;
-            appInput->mouse.y = event->motion.y;
-            appInput->mouse.relX = event->motion.xrel;
-            appInput->mouse.relY = event->motion.yrel;
-        } break;
-            
-        case SDL_MOUSEBUTTONUP:
-        case SDL_MOUSEBUTTONDOWN:
-        {
-            rgBool isDown = (event->button.state == SDL_PRESSED);
-            switch(event->button.button)
+
+            for(u32 i = 0; i < tagCount; ++i)
             {
-                case SDL_BUTTON_LEFT:
-                {
-                    processGameButtonState(&appInput->mouse.left, isDown);
-                } break;
-                    
-                case SDL_BUTTON_MIDDLE:
-                {
-                    processGameButtonState(&appInput->mouse.middle, isDown);
-                } break;
-                    
-                case SDL_BUTTON_RIGHT:
-                {
-                    processGameButtonState(&appInput->mouse.right, isDown);
-                } break;
+                MemoryTagStats const& stats = memoryTags[order[i]];
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(stats.name != nullptr ? stats.name : "<untagged>");
+                ImGui::TableNextColumn();
+                ImGui::Text("%0.1f", stats.liveBytes.load(std::memory_order_relaxed) / 1024.0);
+                ImGui::TableNextColumn();
+                ImGui::Text("%0.1f", stats.peakBytes.load(std::memory_order_relaxed) / 1024.0);
+                ImGui::TableNextColumn();
+                ImGui::Text("%lld", (long long)stats.liveCount.load(std::memory_order_relaxed));
+                ImGui::TableNextColumn();
+                ImGui::Text("%llu", (unsigned long long)stats.totalCount.load(std::memory_order_relaxed));
             }
-        } break;
+            ImGui::EndTable();
+        }
+#else
+        ImGui::Text("Memory tracking is compiled out, see RG_ENABLE_MEMORY_TRACKING in core.h");
+#endif
     }
-    return true;
+    ImGui::End();
 }
 
-static i32 createSDLWindow()
+void memReportLeaks()
 {
-#if 0
-    g_WindowInfo.width = 1056;
-    g_WindowInfo.height = 594;
-#else
-    g_WindowInfo.width = 1280;
-    g_WindowInfo.height = 720;
+#if defined(RG_ENABLE_MEMORY_TRACKING)
+    u32 tagCount = eastl::max(memoryTagCount.load(std::memory_order_acquire), 1u);
+    i64 leakedBytes = 0;
+    for(u32 i = 0; i < tagCount; ++i)
+    {
+        MemoryTagStats const& stats = memoryTags[i];
+        i64 liveCount = stats.liveCount.load(std::memory_order_relaxed);
+        if(liveCount > 0)
+        {
+            i64 liveBytes = stats.liveBytes.load(std::memory_order_relaxed);
+            rgLogWarn("Memory leak: %lld bytes in %lld allocations, tag '%s'", (long long)liveBytes, (long long)liveCount, stats.name != nullptr ? stats.name : "<untagged>");
+            leakedBytes += liveBytes;
+        }
+    }
+    rgLog("Memory: %lld bytes still allocated at exit, peak was %lld bytes", (long long)leakedBytes, (long long)memoryTotalPeakBytes.load());
 #endif
+}
 
-    Uint32 windowFlags = 0;
-    
-#if defined(RG_VULKAN_RNDR)
-    windowFlags |= SDL_WINDOW_VULKAN;
-#elif defined(RG_METAL_RNDR)
-    // NOTE: If memory leaks occure when the window is occluded enable this line
-    //windowFlags |= SDL_WINDOW_ALWAYS_ON_TOP;
-    windowFlags |= SDL_WINDOW_METAL;
-    SDL_SetHint(SDL_HINT_RENDER_DRIVER, "metal");
-#elif defined(RG_D3D12_RNDR)
-    windowFlags |= SDL_WINDOW_RESIZABLE;
-    //windowFlags |= SDL_WINDOW_FULLSCREEN;
-#endif
-    
-    if (SDL_Init(SDL_INIT_VIDEO) == 0)
+// GLOBAL NEW/DELETE OVERLOADS
+// ---------------------------
+
+// Every operator new but the nothrow ones must throw instead of returning nullptr
+static void* memAllocOrThrow(size_t size, rgSize alignment, char const* tagName)
+{
+    void* ptr = memAlloc(size, alignment, tagName);
+    if(ptr == nullptr)
     {
-        g_AppMainWindow = SDL_CreateWindow("gamelib",
-                                           SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
-                                           g_WindowInfo.width, g_WindowInfo.height, windowFlags);
-        rgAssert(g_AppMainWindow != NULL);
-        return 0;
+        throw std::bad_alloc();
     }
-    
-    return -1;
+    return ptr;
+}
+
+void* operator new(size_t size)
+{
+    return memAllocOrThrow(size, kMemoryDefaultAlignment, nullptr);
+}
+
+void* operator new[](size_t size)
+{
+    return memAllocOrThrow(size, kMemoryDefaultAlignment, nullptr);
+}
+
+void* operator new(size_t size, std::nothrow_t const&) noexcept
+{
+    return memAlloc(size, kMemoryDefaultAlignment, nullptr);
+}
+
+void* operator new[](size_t size, std::nothrow_t const&) noexcept
+{
+    return memAlloc(size, kMemoryDefaultAlignment, nullptr);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    memFree(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    memFree(ptr);
+}
+
+void operator delete(void* ptr, size_t size) noexcept
+{
+    memFree(ptr);
+}
+
+void operator delete[](void* ptr, size_t size) noexcept
+{
+    memFree(ptr);
+}
+
+void operator delete(void* ptr, std::nothrow_t const&) noexcept
+{
+    memFree(ptr);
+}
+
+void operator delete[](void* ptr, std::nothrow_t const&) noexcept
+{
+    memFree(ptr);
+}
+
+void* operator new(size_t size, MemoryTag tag)
+{
+    return memAllocOrThrow(size, kMemoryDefaultAlignment, tag.name);
+}
+
+void* operator new[](size_t size, MemoryTag tag)
+{
+    return memAllocOrThrow(size, kMemoryDefaultAlignment, tag.name);
+}
+
+void operator delete(void* ptr, MemoryTag tag)
+{
+    memFree(ptr);
+}
+
+void operator delete[](void* ptr, MemoryTag tag)
+{
+    memFree(ptr);
+}
+
+#if defined(__cpp_aligned_new)
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    return memAllocOrThrow(size, (rgSize)alignment, nullptr);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+    return memAllocOrThrow(size, (rgSize)alignment, nullptr);
+}
+
+void operator delete(void* ptr, std::align_val_t alignment) noexcept
+{
+    memFree(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t alignment) noexcept
+{
+    memFree(ptr);
+}
+
+void operator delete(void* ptr, size_t size, std::align_val_t alignment) noexcept
+{
+    memFree(ptr);
+}
+
+void operator delete[](void* ptr, size_t size, std::align_val_t alignment) noexcept
+{
+    memFree(ptr);
+}
+
+void* operator new(size_t size, std::align_val_t alignment, MemoryTag tag)
+{
+    return memAllocOrThrow(size, (rgSize)alignment, tag.name);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, MemoryTag tag)
+{
+    return memAllocOrThrow(size, (rgSize)alignment, tag.name);
+}
+
+void operator delete(void* ptr, std::align_val_t alignment, MemoryTag tag)
+{
+    memFree(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t alignment, MemoryTag tag)
+{
+    memFree(ptr);
+}
+#endif
+
+// EASTL MEMORY OVERLOADS
+// ----------------------
+
+void* operator new[](size_t size, size_t alignment, size_t alignmentOffset, const char* pName, int flags, unsigned debugFlags, const char* file, int line)
+{
+    void* ptr = memAllocOffset(size, alignment, alignmentOffset, pName);
+    if(ptr == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new[](size_t size, const char* name, int flags, unsigned debugFlags, const char* file, int line)
+{
+    return memAllocOrThrow(size, kMemoryDefaultAlignment, name);
+}
+
+// TIMEDEMO
+// --------
+
+static const u32 kTimedemoMagic = 0x44544752; // 'RGTD'
+static const u32 kTimedemoVersion = 1;
+static const u32 kTimedemoMouseButtonCount = rgArrayCount(GameMouseState::buttons);
+static const u32 kTimedemoControllerButtonCount = rgArrayCount(GameControllerInput::buttons);
+static const u32 kTimedemoButtonCount = kTimedemoMouseButtonCount + RG_MAX_GAME_CONTROLLERS * kTimedemoControllerButtonCount;
+static_assert(kTimedemoButtonCount <= 32, "TimedemoFrame::buttonsDown is a 32 bit mask");
+
+enum TimedemoMode : u8
+{
+    TimedemoMode_None,
+    TimedemoMode_Record,
+    TimedemoMode_Replay,
+};
+
+// File layout: [TimedemoHeader][TimedemoFrame x frameCount]
+struct TimedemoHeader
+{
+    u32 magic;
+    u32 version;
+    u32 frameCount;
+    u32 frameSize;
+};
+
+struct TimedemoFrame
+{
+    f64 deltaTime;
+    i32 mouseX, mouseY, mouseRelX, mouseRelY;
+    u32 buttonsDown; // endedDown bit per button, mouse buttons first
+    u8  halfTransitionCounts[kTimedemoButtonCount];
+};
+
+struct Timedemo
+{
+    TimedemoMode    mode;
+    char const*     filepath;
+    char const*     csvFilepath;
+    u32             frameLimit;
+    u32             warmupFrameCount;
+    f64             fixedDeltaTime; // 0 replays the recorded timestep
+
+    eastl::vector<TimedemoFrame> frames;
+    eastl::vector<f64>  cpuFrameTimes; // Milliseconds, one per replayed frame
+    eastl::vector<f64>  deltaTimes;
+    u32             frameCursor;
+    f64             replayTime;
+    u64             frameBeginCounter;
+};
+
+static Timedemo timedemo;
+
+static GameButtonState* timedemoGetButton(AppInput* input, u32 buttonIndex)
+{
+    if(buttonIndex < kTimedemoMouseButtonCount)
+    {
+        return &input->mouse.buttons[buttonIndex];
+    }
+    buttonIndex -= kTimedemoMouseButtonCount;
+    return &input->controllers[buttonIndex / kTimedemoControllerButtonCount].buttons[buttonIndex % kTimedemoControllerButtonCount];
+}
+
+static void timedemoBegin()
+{
+    if(timedemo.mode != TimedemoMode_Replay)
+    {
+        return;
+    }
+
+    FileData file = fileRead(timedemo.filepath);
+    TimedemoHeader header = {};
+    if(file.isValid && file.dataSize >= sizeof(header))
+    {
+        SDL_memcpy(&header, file.data, sizeof(header));
+    }
+
+    rgBool isValid = header.magic == kTimedemoMagic && header.version == kTimedemoVersion && header.frameSize == sizeof(TimedemoFrame)
+        && file.dataSize >= sizeof(header) + (rgSize)header.frameCount * sizeof(TimedemoFrame);
+    if(!isValid)
+    {
+        rgLogError("Can't replay %s, not a valid timedemo", timedemo.filepath);
+        timedemo.mode = TimedemoMode_None;
+    }
+    else
+    {
+        TimedemoFrame const* frames = (TimedemoFrame const*)(file.data + sizeof(header));
+        timedemo.frames.assign(frames, frames + header.frameCount);
+        if(timedemo.frameLimit == 0 || timedemo.frameLimit > header.frameCount)
+        {
+            timedemo.frameLimit = header.frameCount;
+        }
+        timedemo.cpuFrameTimes.reserve(timedemo.frameLimit);
+        timedemo.deltaTimes.reserve(timedemo.frameLimit);
+        rgLog("Replaying %u frames from %s", timedemo.frameLimit, timedemo.filepath);
+
+        if(timedemo.frameLimit == 0)
+        {
+            g_ShouldAppQuit = true;
+        }
+    }
+
+    if(file.isValid)
+    {
+        fileFree(&file);
+    }
+}
+
+// Records the frame input, or replaces it with the recorded one
+static void timedemoOnInput(AppInput* input)
+{
+    if(timedemo.mode == TimedemoMode_Record)
+    {
+        TimedemoFrame frame = {};
+        frame.deltaTime = input->deltaTime;
+        frame.mouseX = input->mouse.x;
+        frame.mouseY = input->mouse.y;
+        frame.mouseRelX = input->mouse.relX;
+        frame.mouseRelY = input->mouse.relY;
+        for(u32 i = 0; i < kTimedemoButtonCount; ++i)
+        {
+            GameButtonState* button = timedemoGetButton(input, i);
+            frame.buttonsDown |= button->endedDown ? (1u << i) : 0;
+            frame.halfTransitionCounts[i] = (u8)eastl::min(button->halfTransitionCount, 255u);
+        }
+        timedemo.frames.push_back(frame);
+    }
+    else if(timedemo.mode == TimedemoMode_Replay)
+    {
+        rgAssert(timedemo.frameCursor < timedemo.frameLimit);
+        TimedemoFrame const& frame = timedemo.frames[timedemo.frameCursor++];
+
+        input->deltaTime = (timedemo.fixedDeltaTime > 0.0) ? timedemo.fixedDeltaTime : frame.deltaTime;
+        timedemo.replayTime += input->deltaTime;
+        input->time = timedemo.replayTime;
+        input->mouse.x = frame.mouseX;
+        input->mouse.y = frame.mouseY;
+        input->mouse.relX = frame.mouseRelX;
+        input->mouse.relY = frame.mouseRelY;
+        for(u32 i = 0; i < kTimedemoButtonCount; ++i)
+        {
+            GameButtonState* button = timedemoGetButton(input, i);
+            button->endedDown = (frame.buttonsDown & (1u << i)) != 0;
+            button->halfTransitionCount = frame.halfTransitionCounts[i];
+        }
+        timedemo.deltaTimes.push_back(input->deltaTime);
+
+        if(timedemo.frameCursor == timedemo.frameLimit)
+        {
+            g_ShouldAppQuit = true; // This is the last frame
+        }
+    }
+}
+
+static void timedemoOnFrameEnd()
+{
+    if(timedemo.mode == TimedemoMode_Replay)
+    {
+        u64 frameEndCounter = SDL_GetPerformanceCounter();
+        timedemo.cpuFrameTimes.push_back((frameEndCounter - timedemo.frameBeginCounter) * 1000.0 / (f64)SDL_GetPerformanceFrequency());
+    }
+}
+
+static f64 timedemoPercentile(eastl::vector<f64> const& sortedValues, f64 percentile)
+{
+    // Nearest-rank
+    rgSize rank = (rgSize)SDL_ceil(percentile * sortedValues.size());
+    return sortedValues[eastl::max(rank, (rgSize)1) - 1];
+}
+
+static void timedemoEnd()
+{
+    if(timedemo.mode == TimedemoMode_Record)
+    {
+        TimedemoHeader header = { kTimedemoMagic, kTimedemoVersion, (u32)timedemo.frames.size(), sizeof(TimedemoFrame) };
+        eastl::vector<u8> fileData(sizeof(header) + timedemo.frames.size() * sizeof(TimedemoFrame));
+        SDL_memcpy(fileData.data(), &header, sizeof(header));
+        if(!timedemo.frames.empty())
+        {
+            SDL_memcpy(fileData.data() + sizeof(header), timedemo.frames.data(), timedemo.frames.size() * sizeof(TimedemoFrame));
+        }
+        if(fileWrite(timedemo.filepath, fileData.data(), fileData.size()))
+        {
+            rgLog("Recorded %u frames to %s", header.frameCount, timedemo.filepath);
+        }
+    }
+    else if(timedemo.mode == TimedemoMode_Replay && !timedemo.cpuFrameTimes.empty())
+    {
+        // Per-frame CSV includes the warmup frames, the statistics don't
+        eastl::string csv = "frame,cpuFrameMs,deltaTimeMs\n";
+        for(rgSize i = 0; i < timedemo.cpuFrameTimes.size(); ++i)
+        {
+            char line[96];
+            SDL_snprintf(line, sizeof(line), "%u,%.4f,%.4f\n", (u32)i, timedemo.cpuFrameTimes[i], timedemo.deltaTimes[i] * 1000.0);
+            csv += line;
+        }
+        if(fileWrite(timedemo.csvFilepath, csv.data(), csv.size()))
+        {
+            rgLog("Timedemo per-frame times written to %s", timedemo.csvFilepath);
+        }
+
+        rgSize warmupFrameCount = eastl::min((rgSize)timedemo.warmupFrameCount, timedemo.cpuFrameTimes.size() - 1);
+        eastl::vector<f64> sortedTimes(timedemo.cpuFrameTimes.begin() + warmupFrameCount, timedemo.cpuFrameTimes.end());
+        eastl::sort(sortedTimes.begin(), sortedTimes.end());
+
+        f64 totalTime = 0.0;
+        for(f64 t : sortedTimes)
+        {
+            totalTime += t;
+        }
+        rgLog("Timedemo %s: %u frames, CPU frame time avg %.3fms p50 %.3fms p95 %.3fms p99 %.3fms max %.3fms",
+            timedemo.filepath, (u32)sortedTimes.size(), totalTime / sortedTimes.size(),
+            timedemoPercentile(sortedTimes, 0.50), timedemoPercentile(sortedTimes, 0.95), timedemoPercentile(sortedTimes, 0.99), sortedTimes.back());
+    }
+
+    // Freed here and not at exit, so they don't show up as leaks
+    timedemo.frames.set_capacity(0);
+    timedemo.cpuFrameTimes.set_capacity(0);
+    timedemo.deltaTimes.set_capacity(0);
+    timedemo.mode = TimedemoMode_None;
+}
+
+rgBool timedemoIsReplaying()
+{
+    return timedemo.mode == TimedemoMode_Replay;
+}
+
+// THE APP
+// -------
+
+AppInput* theAppInput;
+static AppInput* oldAppInput, *newAppInput;
+
+static rgBool processGameButtonState(GameButtonState* newButtonState, rgBool isDown)
+{
+    if(newButtonState->endedDown != isDown)
+    {
+        newButtonState->endedDown = isDown;
+        ++newButtonState->halfTransitionCount;
+        return true;
+    }
+    return false;
+}
+
+static rgBool processGameInputs(SDL_Event* event, AppInput* appInput)
+{
+    GameControllerInput* controller1 = &appInput->controllers[0];
+    
+    switch(event->type)
+    {
+        case SDL_KEYDOWN:
+        case SDL_KEYUP:
+        {
+            if(!event->key.repeat)
+            {
+                rgBool isDown = (event->key.state == SDL_PRESSED);
+                switch(event->key.keysym.sym)
+                {
+                    case SDLK_w:
+                    case SDLK_UP:
+                    {
+                        processGameButtonState(&controller1->forward, isDown);
+                    } break;
+                        
+                    case SDLK_s:
+                    case SDLK_DOWN:
+                    {
+                        processGameButtonState(&controller1->backward, isDown);
+                    } break;
+                        
+                    case SDLK_a:
+                    case SDLK_LEFT:
+                    {
+                        processGameButtonState(&controller1->left, isDown);
+                    } break;
+                        
+                    case SDLK_d:
+                    case SDLK_RIGHT:
+                    {
+                        processGameButtonState(&controller1->right, isDown);
+                    } break;
+                    
+                    case SDLK_q:
+                    case SDLK_c:
+                    {
+                        processGameButtonState(&controller1->up, isDown);
+                    } break;
+                        
+                    case SDLK_e:
+                    case SDLK_f:
+                    {
+                        processGameButtonState(&controller1->down, isDown);
+                    } break;
+                    
+                    case SDLK_ESCAPE:
+                    {
+                        SDL_Event quitEvent;
+                        quitEvent.type = SDL_QUIT;
+                        SDL_PushEvent(&quitEvent);
+                    } break;
+
+                    case SDLK_F11:
+                    {
+                        if(isDown)
+                        {
+                            profilerDumpChromeTrace("rg_profile_trace.json");
+                        }
+                    } break;
+                }
+            }
+        } break;
+            
+        case SDL_MOUSEMOTION:
+        {
+            appInput->mouse.x = event->motion.x;
+            appInput->mouse.y = event->motion.y;
+            appInput->mouse.relX = event->motion.xrel;
+            appInput->mouse.relY = event->motion.yrel;
+        } break;
+            
+        case SDL_MOUSEBUTTONUP:
+        case SDL_MOUSEBUTTONDOWN:
+        {
+            rgBool isDown = (event->button.state == SDL_PRESSED);
+            switch(event->button.button)
+            {
+                case SDL_BUTTON_LEFT:
+                {
+                    processGameButtonState(&appInput->mouse.left, isDown);
+                } break;
+                    
+                case SDL_BUTTON_MIDDLE:
+                {
+                    processGameButtonState(&appInput->mouse.middle, isDown);
+                } break;
+                    
+                case SDL_BUTTON_RIGHT:
+                {
+                    processGameButtonState(&appInput->mouse.right, isDown);
+                } break;
+            }
+        } break;
+    }
+    return true;
+}
+
+static i32 createSDLWindow()
+{
+#if 0
+    g_WindowInfo.width = 1056;
+    g_WindowInfo.height = 594;
+#else
+    g_WindowInfo.width = 1280;
+    g_WindowInfo.height = 720;
+#endif
+
+    Uint32 windowFlags = 0;
+    
+#if defined(RG_VULKAN_RNDR)
+    windowFlags |= SDL_WINDOW_VULKAN;
+#elif defined(RG_METAL_RNDR)
+    // NOTE: If memory leaks occure when the window is occluded enable this line
+    //windowFlags |= SDL_WINDOW_ALWAYS_ON_TOP;
+    windowFlags |= SDL_WINDOW_METAL;
+    SDL_SetHint(SDL_HINT_RENDER_DRIVER, "metal");
+#elif defined(RG_D3D12_RNDR)
+    windowFlags |= SDL_WINDOW_RESIZABLE;
+    //windowFlags |= SDL_WINDOW_FULLSCREEN;
+#elif defined(RG_NULL_RNDR)
+    // Nothing is presented, use the offscreen video driver so that no display
+    // server is needed. SDL_VIDEODRIVER env var can still override this hint.
+    windowFlags |= SDL_WINDOW_HIDDEN;
+    SDL_SetHintWithPriority(SDL_HINT_VIDEODRIVER, "offscreen,dummy", SDL_HINT_DEFAULT);
+#endif
+    
+    if (SDL_Init(SDL_INIT_VIDEO) == 0)
+    {
+        g_AppMainWindow = SDL_CreateWindow("gamelib",
+                                           SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+                                           g_WindowInfo.width, g_WindowInfo.height, windowFlags);
+        rgAssert(g_AppMainWindow != NULL);
+        return 0;
+    }
+    
+    return -1;
+}
+
+void TheApp::parseCommandLine(int argc, char* argv[])
+{
+    timedemo.csvFilepath = "timedemo.csv";
+    for(i32 i = 1; i < argc; ++i)
+    {
+        rgBool hasValue = (i + 1) < argc;
+        if(SDL_strcmp(argv[i], "--timedemo-record") == 0 && hasValue)
+        {
+            timedemo.mode = TimedemoMode_Record;
+            timedemo.filepath = argv[++i];
+        }
+        else if(SDL_strcmp(argv[i], "--timedemo-play") == 0 && hasValue)
+        {
+            timedemo.mode = TimedemoMode_Replay;
+            timedemo.filepath = argv[++i];
+        }
+        else if(SDL_strcmp(argv[i], "--timedemo-frames") == 0 && hasValue)
+        {
+            timedemo.frameLimit = (u32)SDL_atoi(argv[++i]);
+        }
+        else if(SDL_strcmp(argv[i], "--timedemo-warmup") == 0 && hasValue)
+        {
+            timedemo.warmupFrameCount = (u32)SDL_atoi(argv[++i]);
+        }
+        else if(SDL_strcmp(argv[i], "--timedemo-dt") == 0 && hasValue)
+        {
+            timedemo.fixedDeltaTime = SDL_atof(argv[++i]);
+        }
+        else if(SDL_strcmp(argv[i], "--pipelined") == 0)
+        {
+            // For apps that implement update() and render()
+            pipelined = true;
+        }
+        else if(SDL_strcmp(argv[i], "--timedemo-csv") == 0 && hasValue)
+        {
+            timedemo.csvFilepath = argv[++i];
+        }
+    }
+}
+
+int TheApp::beginApp()
+{
+    g_FrameIndex = -1;
+
+    logInit("rg_gamelib.log");
+    profilerSetThreadName("Main");
+    jobSystemInit();
+
+    // Loose files are used for anything not in the pack
+    vfsMountPack("assets.rgpack");
+
+    if(createSDLWindow() != 0)
+    {
+        return -1; // error;
+    }
+
+    i32 gfxPreInitResult = gfxPreInit();
+    i32 gfxInitResult = gfxInit();
+    i32 gfxCommonInitResult = gfxPostInit();
+
+    if(gfxInitResult || gfxCommonInitResult)
+    {
+        return gfxInitResult | gfxCommonInitResult;
+    }
+
+    //setup();
+
+    g_ShouldAppQuit = false;
+    
+    currentPerfCounter = SDL_GetPerformanceCounter();
+    previousPerfCounter = currentPerfCounter;
+    
+    oldAppInput = &inputs[0];
+    newAppInput = &inputs[1];
+
+    timedemoBegin();
+
+    return 1;
+}
+
+void TheApp::run()
+{
+    if(pipelined)
+    {
+        runPipelined();
+        return;
+    }
+
+    while(!g_ShouldAppQuit)
+    {
+        beforeUpdateAndDraw();
+        runFixedUpdates();
+        {
+            rgProfileScope("updateAndDraw");
+            updateAndDraw();
+        }
+        afterUpdateAndDraw();
+    }
+}
+
+// PIPELINED APP
+// -------------
+
+static const u32 kAppFramePacketCount = 2; // So the update runs at most one frame ahead of the render
+
+// Packets are used round-robin, so the semaphores are enough for a bounded queue
+struct AppPipeline
+{
+    AppFramePacket          packets[kAppFramePacketCount];
+    ImDrawData              imguiDrawData[kAppFramePacketCount];
+    ImVector<ImDrawList*>   imguiDrawLists[kAppFramePacketCount]; // Owned by the update thread
+    SDL_sem*                freePacketSemaphore;
+    SDL_sem*                readyPacketSemaphore;
+    SDL_sem*                renderThreadReadySemaphore;
+    SDL_Thread*             renderThread;
+    std::atomic<bool>       windowSizeChanged;
+};
+
+static AppPipeline* appPipeline;
+
+static void appReleaseImGuiDrawData(u32 packetIndex)
+{
+    ImVector<ImDrawList*>& drawLists = appPipeline->imguiDrawLists[packetIndex];
+    for(ImDrawList* drawList : drawLists)
+    {
+        IM_DELETE(drawList);
+    }
+    drawLists.resize(0);
+    appPipeline->imguiDrawData[packetIndex].Clear();
+}
+
+// ImGui reuses its draw lists on the next NewFrame(), so the render thread gets a copy
+static void appCopyImGuiDrawData(u32 packetIndex)
+{
+    ImDrawData* srcDrawData = ImGui::GetDrawData();
+    ImDrawData* dstDrawData = &appPipeline->imguiDrawData[packetIndex];
+    ImVector<ImDrawList*>& drawLists = appPipeline->imguiDrawLists[packetIndex];
+
+    *dstDrawData = *srcDrawData;
+    for(i32 i = 0; i < srcDrawData->CmdListsCount; ++i)
+    {
+        drawLists.push_back(srcDrawData->CmdLists[i]->CloneOutput());
+    }
+    dstDrawData->CmdLists = drawLists.Data;
+}
+
+int appRenderThreadMain(void* data)
+{
+    TheApp* app = (TheApp*)data;
+    profilerSetThreadName("Render");
+
+    u32 packetIndex = 0;
+    rgBool isFirstFrame = true;
+    rgBool isQuit = false;
+    while(!isQuit)
+    {
+        if(appPipeline->windowSizeChanged.exchange(false))
+        {
+            gfxOnSizeChanged();
+        }
+
+        // Waits on the GPU while the update thread works on the packet
+        {
+            rgProfileScope("gfxStartNextFrame");
+            gfxStartNextFrame();
+            gfxRunOnFrameBeginJob();
+            gfxRendererImGuiNewFrame();
+        }
+
+        if(isFirstFrame)
+        {
+            // ImGui::NewFrame() on the update thread needs the renderer's font texture
+            SDL_SemPost(appPipeline->renderThreadReadySemaphore);
+            isFirstFrame = false;
+        }
+
+        {
+            rgProfileScope("waitForUpdate");
+            SDL_SemWait(appPipeline->readyPacketSemaphore);
+        }
+        AppFramePacket* packet = &appPipeline->packets[packetIndex];
+        packetIndex = (packetIndex + 1) % kAppFramePacketCount;
+
+        isQuit = packet->isQuit;
+        if(!isQuit)
+        {
+            {
+                rgProfileScope("render");
+                app->render(packet);
+            }
+            {
+                rgProfileScope("ImGuiRender");
+                gfxRendererImGuiRenderDrawData(packet->imguiDrawData);
+            }
+        }
+
+        // Everything is recorded, the update thread can reuse the packet. The
+        // frame started above is ended even when quitting, to keep the backend consistent.
+        gfxAtFrameEnd();
+        SDL_SemPost(appPipeline->freePacketSemaphore);
+
+        {
+            rgProfileScope("gfxEndFrame");
+            gfxEndFrame();
+        }
+    }
+    return 0;
+}
+
+void TheApp::runPipelined()
+{
+    appPipeline = rgNew(AppPipeline);
+    for(u32 i = 0; i < kAppFramePacketCount; ++i)
+    {
+        appPipeline->packets[i] = {};
+        appPipeline->packets[i].arena = rgNew(LinearAllocator)("AppFramePacket", rgMegabyte(4));
+        appPipeline->packets[i].imguiDrawData = &appPipeline->imguiDrawData[i];
+    }
+    appPipeline->freePacketSemaphore = SDL_CreateSemaphore(kAppFramePacketCount);
+    appPipeline->readyPacketSemaphore = SDL_CreateSemaphore(0);
+    appPipeline->renderThreadReadySemaphore = SDL_CreateSemaphore(0);
+    appPipeline->windowSizeChanged.store(false);
+
+    appPipeline->renderThread = SDL_CreateThread(appRenderThreadMain, "Render", this);
+    rgAssert(appPipeline->renderThread != nullptr);
+    SDL_SemWait(appPipeline->renderThreadReadySemaphore);
+
+    u32 packetIndex = 0;
+    for(;;)
+    {
+        rgBool isQuit = g_ShouldAppQuit;
+        if(!isQuit)
+        {
+            timedemo.frameBeginCounter = SDL_GetPerformanceCounter();
+            profilerBeginFrame();
+        }
+
+        {
+            rgProfileScope("waitForRender");
+            SDL_SemWait(appPipeline->freePacketSemaphore);
+        }
+        AppFramePacket* packet = &appPipeline->packets[packetIndex];
+        packet->arena->reset();
+        packet->userData = nullptr;
+        packet->isQuit = isQuit;
+        appReleaseImGuiDrawData(packetIndex);
+
+        if(!isQuit)
+        {
+            // Frame containers built by update(), e.g. TexturedQuads, live in the packet
+            gfxSetThreadFrameArena(packet->arena);
+
+            processInput();
+            {
+                rgProfileScope("ImGuiNewFrame");
+                ImGui_ImplSDL2_NewFrame();
+                ImGui::NewFrame();
+            }
+            runFixedUpdates();
+            {
+                rgProfileScope("update");
+                update(packet);
+            }
+            {
+                rgProfileScope("ImGuiRender");
+                ImGui::Render();
+                appCopyImGuiDrawData(packetIndex);
+            }
+
+            packet->input = *theAppInput;
+            packet->frameNumber = g_FrameNumber;
+            *oldAppInput = *newAppInput;
+
+            gfxSetThreadFrameArena(nullptr);
+        }
+
+        SDL_SemPost(appPipeline->readyPacketSemaphore);
+        packetIndex = (packetIndex + 1) % kAppFramePacketCount;
+
+        if(isQuit)
+        {
+            break;
+        }
+        timedemoOnFrameEnd();
+    }
+
+    SDL_WaitThread(appPipeline->renderThread, nullptr);
+
+    for(u32 i = 0; i < kAppFramePacketCount; ++i)
+    {
+        appReleaseImGuiDrawData(i);
+        rgDelete(appPipeline->packets[i].arena);
+    }
+    SDL_DestroySemaphore(appPipeline->freePacketSemaphore);
+    SDL_DestroySemaphore(appPipeline->readyPacketSemaphore);
+    SDL_DestroySemaphore(appPipeline->renderThreadReadySemaphore);
+    rgDelete(appPipeline);
+    appPipeline = nullptr;
+}
+
+// Input, timing and window events of the frame, shared by both modes
+void TheApp::processInput()
+{
+    rgProfileFunction();
+
+    ++g_FrameNumber;
+    
+    // Copy old input state to new input state
+    *newAppInput = {};
+    GameControllerInput* oldController1 = &oldAppInput->controllers[0];
+    GameControllerInput* newController1 = &newAppInput->controllers[0];
+    for(i32 buttonIdx = 0; buttonIdx < rgArrayCount(GameControllerInput::buttons); ++buttonIdx)
+    {
+        newController1->buttons[buttonIdx].endedDown = oldController1->buttons[buttonIdx].endedDown;
+    }
+    
+    // Copy old mouse input state to new mouse input state
+    newAppInput->mouse.x = oldAppInput->mouse.x;
+    newAppInput->mouse.y = oldAppInput->mouse.y;
+    for(i32 buttonIdx = 0; buttonIdx < rgArrayCount(GameControllerInput::buttons); ++buttonIdx)
+    {
+        newAppInput->mouse.buttons[buttonIdx].endedDown = oldAppInput->mouse.buttons[buttonIdx].endedDown;
+    }
+    
+    theAppInput = newAppInput;
+
+    // Copy timing information
+    Uint64 counterFrequency = SDL_GetPerformanceFrequency();
+    previousPerfCounter = currentPerfCounter;
+    currentPerfCounter = SDL_GetPerformanceCounter();
+    theAppInput->deltaTime = ((currentPerfCounter - previousPerfCounter) / (1.0 * SDL_GetPerformanceFrequency()));
+    theAppInput->time = currentPerfCounter / (1.0 * counterFrequency);
+    
+    // Process events
+    rgProfileBegin("processEvents");
+    SDL_Event event;
+    while(SDL_PollEvent(&event) != 0)
+    {
+        ImGui_ImplSDL2_ProcessEvent(&event); // TODO: Is this the right to place this here?
+        
+        if(event.type == SDL_QUIT)
+        {
+            g_ShouldAppQuit = true;
+        }
+        else if(event.type == SDL_WINDOWEVENT_SIZE_CHANGED)
+        {
+            g_WindowInfo.width = event.window.data1;
+            g_WindowInfo.height = event.window.data2;
+            if(appPipeline != nullptr)
+            {
+                appPipeline->windowSizeChanged.store(true); // The render thread owns the swapchain
+            }
+            else
+            {
+                gfxOnSizeChanged();
+            }
+        }
+        else
+        {
+            // process event
+            processGameInputs(&event, newAppInput);
+        }
+    }
+    timedemoOnInput(newAppInput);
+    rgProfileEnd();
+}
+
+void TheApp::runFixedUpdates()
+{
+    rgProfileFunction();
+
+    if(fixedTickRate <= 0.0)
+    {
+        theAppInput->fixedDeltaTime = 0.0;
+        theAppInput->interpolationAlpha = 0.0;
+        theAppInput->fixedStepCount = 0;
+        return;
+    }
+
+    f64 fixedDeltaTime = 1.0 / fixedTickRate;
+    fixedTimeAccumulator += theAppInput->deltaTime;
+
+    u32 stepCount = 0;
+    while(fixedTimeAccumulator >= fixedDeltaTime && stepCount < maxFixedStepsPerFrame)
+    {
+        fixedUpdate(fixedDeltaTime);
+        fixedTimeAccumulator -= fixedDeltaTime;
+        ++stepCount;
+    }
+
+    // Couldn't catch up, drop the whole ticks but keep the phase
+    if(fixedTimeAccumulator >= fixedDeltaTime)
+    {
+        fixedTimeAccumulator = SDL_fmod(fixedTimeAccumulator, fixedDeltaTime);
+    }
+
+    theAppInput->fixedDeltaTime = fixedDeltaTime;
+    theAppInput->interpolationAlpha = fixedTimeAccumulator / fixedDeltaTime;
+    theAppInput->fixedStepCount = stepCount;
+}
+
+void TheApp::beforeUpdateAndDraw()
+{
+    timedemo.frameBeginCounter = SDL_GetPerformanceCounter();
+    profilerBeginFrame();
+    rgProfileFunction();
+
+    processInput();
+    
+    {
+        rgProfileScope("gfxStartNextFrame");
+        gfxStartNextFrame();
+        gfxRunOnFrameBeginJob();
+    }
+    
+    rgProfileScope("ImGuiNewFrame");
+    gfxRendererImGuiNewFrame();
+    ImGui_ImplSDL2_NewFrame();
+    ImGui::NewFrame();
+}
+
+void TheApp::afterUpdateAndDraw()
+{
+    rgProfileFunction();
+
+    {
+        rgProfileScope("ImGuiRender");
+        ImGui::Render();
+        gfxRendererImGuiRenderDrawData(ImGui::GetDrawData());
+    }
+
+    gfxAtFrameEnd();
+
+    {
+        rgProfileScope("gfxEndFrame");
+        gfxEndFrame();
+    }
+    
+    *oldAppInput = *newAppInput;
+
+    timedemoOnFrameEnd();
+}
+
+void TheApp::endApp()
+{
+    timedemoEnd();
+
+    // Everything is released first, so the leak report only has real leaks
+    shutdown();
+    gfxDestroy();
+    gfxPostDestroy();
+    SDL_DestroyWindow(g_AppMainWindow);
+    g_AppMainWindow = nullptr;
+
+    jobSystemShutdown();
+    vfsUnmountAll();
+    memReportLeaks();
+    logShutdown();
+}
+
+void TheApp::setTitle(const char *_title)
+{
+}
+
+// FILE IO
+// -------
+
+struct MountedPack
+{
+    FileMapping         file;
+    PackHeader const*   header;
+    PackEntry const*    entries;
+    u32 const*          hashTable;
+    char const*         paths;
+};
+
+static eastl::vector<MountedPack> mountedPacks;
+
+static PackEntry const* vfsFindEntry(char const* filepath, MountedPack const** outPack)
+{
+    if(mountedPacks.empty())
+    {
+        return nullptr;
+    }
+
+    char normalizedPath[512];
+    if(!packNormalizePath(filepath, normalizedPath, rgArrayCount(normalizedPath)))
+    {
+        return nullptr;
+    }
+    u32 pathHash = packHashPath(normalizedPath);
+
+    // Last mounted pack wins
+    for(i32 packIndex = (i32)mountedPacks.size() - 1; packIndex >= 0; --packIndex)
+    {
+        MountedPack const& pack = mountedPacks[packIndex];
+        u32 mask = pack.header->hashTableSize - 1;
+        // A well formed table always has an empty slot, the bound only matters for corrupt packs
+        u32 slot = pathHash & mask;
+        for(u32 probe = 0; probe < pack.header->hashTableSize; ++probe, slot = (slot + 1) & mask)
+        {
+            u32 entryIndex = pack.hashTable[slot];
+            if(entryIndex == kPackInvalidEntry)
+            {
+                break;
+            }
+            if(entryIndex >= pack.header->entryCount)
+            {
+                rgLogCategory(LogCategory_Asset, LogLevel_Error, "Corrupt hash table in pack, entry %u of %u", entryIndex, pack.header->entryCount);
+                break;
+            }
+
+            PackEntry const* entry = &pack.entries[entryIndex];
+            if(entry->pathHash == pathHash && strcmp(pack.paths + entry->pathOffset, normalizedPath) == 0)
+            {
+                *outPack = &pack;
+                return entry;
+            }
+        }
+    }
+    return nullptr;
+}
+
+// Copies or decompresses the entry into rgMalloc'd memory
+static u8* vfsReadEntry(MountedPack const* pack, PackEntry const* entry)
+{
+    u8 const* storedData = pack->file.data + entry->dataOffset;
+    u8* data = (u8*)rgMalloc(entry->size);
+    if(entry->flags & PackEntryFlag_Compressed)
+    {
+        if(!lzDecompress(storedData, entry->storedSize, data, entry->size))
+        {
+            rgLogCategory(LogCategory_Asset, LogLevel_Error, "Corrupt pack entry %s", pack->paths + entry->pathOffset);
+            rgFree(data);
+            return nullptr;
+        }
+    }
+    else
+    {
+        memcpy(data, storedData, entry->size);
+    }
+    return data;
+}
+
+// Overflow safe, offset and size come from the file
+static rgBool isPackRangeValid(u64 offset, u64 size, u64 fileSize)
+{
+    return offset <= fileSize && size <= fileSize - offset;
+}
+
+// Everything vfsFindEntry() and vfsReadEntry() read has to be inside the file,
+// so a truncated or corrupt pack is rejected here instead of read out of bounds
+static rgBool isPackValid(MountedPack const& pack)
+{
+    PackHeader const* header = pack.header;
+    u64 fileSize = (u64)pack.file.dataSize;
+    if(header->magic != kPackMagic || header->version != kPackVersion || header->hashTableSize == 0 ||
+       (header->hashTableSize & (header->hashTableSize - 1)) != 0)
+    {
+        return false;
+    }
+    if((header->entriesOffset % alignof(PackEntry)) != 0 || (header->hashTableOffset % alignof(u32)) != 0 ||
+       !isPackRangeValid(header->entriesOffset, (u64)header->entryCount * sizeof(PackEntry), fileSize) ||
+       !isPackRangeValid(header->hashTableOffset, (u64)header->hashTableSize * sizeof(u32), fileSize) ||
+       !isPackRangeValid(header->pathsOffset, 0, fileSize))
+    {
+        return false;
+    }
+
+    PackEntry const* entries = (PackEntry const*)(pack.file.data + header->entriesOffset);
+    char const* paths = (char const*)(pack.file.data + header->pathsOffset);
+    u64 pathsSize = fileSize - header->pathsOffset;
+    for(u32 i = 0; i < header->entryCount; ++i)
+    {
+        PackEntry const& entry = entries[i];
+        rgBool isCompressed = (entry.flags & PackEntryFlag_Compressed) != 0;
+        if(entry.pathOffset >= pathsSize || memchr(paths + entry.pathOffset, 0, (size_t)(pathsSize - entry.pathOffset)) == nullptr ||
+           !isPackRangeValid(entry.dataOffset, entry.storedSize, fileSize) || (!isCompressed && entry.storedSize != entry.size))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+rgBool vfsMountPack(char const* packFilepath)
+{
+    SDL_RWops* fp = SDL_RWFromFile(packFilepath, "rb");
+    if(fp == NULL)
+    {
+        return false;
+    }
+    SDL_RWclose(fp);
+
+    MountedPack pack = {};
+    pack.file = fileMap(packFilepath, FileMapAccess_Random);
+    if(!pack.file.isValid || pack.file.dataSize < sizeof(PackHeader))
+    {
+        fileUnmap(&pack.file);
+        return false;
+    }
+
+    pack.header = (PackHeader const*)pack.file.data;
+    if(!isPackValid(pack))
+    {
+        rgLogCategory(LogCategory_Asset, LogLevel_Error, "%s is not a valid pack", packFilepath);
+        fileUnmap(&pack.file);
+        return false;
+    }
+    pack.entries = (PackEntry const*)(pack.file.data + pack.header->entriesOffset);
+    pack.hashTable = (u32 const*)(pack.file.data + pack.header->hashTableOffset);
+    pack.paths = (char const*)(pack.file.data + pack.header->pathsOffset);
+
+    mountedPacks.push_back(pack);
+    rgLogCategory(LogCategory_Asset, LogLevel_Info, "Mounted pack %s with %u files", packFilepath, pack.header->entryCount);
+    return true;
+}
+
+void vfsUnmountAll()
+{
+    for(MountedPack& pack : mountedPacks)
+    {
+        fileUnmap(&pack.file);
+    }
+    mountedPacks.clear();
+}
+
+FileData fileRead(const char* filepath)
+{
+	FileData result = {};
+
+    MountedPack const* pack;
+    PackEntry const* entry = vfsFindEntry(filepath, &pack);
+    if(entry != nullptr)
+    {
+        result.data = vfsReadEntry(pack, entry);
+        result.dataSize = (rgSize)entry->size;
+        result.isValid = result.data != nullptr;
+        return result;
+    }
+
+	SDL_RWops* fp = SDL_RWFromFile(filepath, "rb");
+
+	if (fp != NULL)
+	{
+		SDL_RWseek(fp, 0, RW_SEEK_END);
+		Sint64 size = (rgSize)SDL_RWtell(fp);
+
+		if (size == -1 || size <= 0)
+		{
+			SDL_RWclose(fp);
+			result.isValid = false;
+			return result;
+		}
+		else
+		{
+			result.dataSize = (rgSize)size;
+		}
+
+		SDL_RWseek(fp, 0, RW_SEEK_SET);
+
+		result.data = (u8*)rgMalloc(sizeof(u8) * size);
+		if (result.data == NULL)
+		{
+			rgLog("Cannot allocate memory(%dbytes) for reading file %s", size, filepath);
+			SDL_RWclose(fp);
+			result.isValid = false;
+			return result;
+		}
+
+		rgSize sizeRead = SDL_RWread(fp, result.data, sizeof(u8), size);
+		if (sizeRead != size)
+		{
+			result.isValid = false;
+			rgFree(result.data);
+		}
+
+		SDL_RWclose(fp);
+
+		result.isValid = true;
+	}
+	else
+	{
+		rgLog("Cannot open/read file %s", filepath);
+		result.isValid = false;
+	}
+
+	return result;
+}
+
+rgBool fileWrite(char const* filepath, void* bufferPtr, rgSize bufferSizeInBytes)
+{
+	// Open file for writing
+	SDL_RWops* fp = SDL_RWFromFile(filepath, "wb");
+
+	// If file is opened
+	if (fp != 0)
+	{
+		size_t bytesWritten = SDL_RWwrite(fp, bufferPtr, sizeof(u8), bufferSizeInBytes);
+		if (bytesWritten != (size_t)bufferSizeInBytes)
+		{
+			rgLogError("Can't write file %s completely\n", filepath);
+			return false;
+		}
+
+		SDL_RWclose(fp);
+	}
+	// If file can't be opened
+	else
+	{
+		rgLogError("Can't open file %s for writing\n", filepath);
+		return false;
+	}
+	return true;
+}
+
+void fileFree(FileData* fd)
+{
+    rgFree(fd->data);
+}
+
+FileMapping fileMap(char const* filepath, FileMapAccess access)
+{
+    FileMapping result = {};
+
+    MountedPack const* pack;
+    PackEntry const* entry = vfsFindEntry(filepath, &pack);
+    if(entry != nullptr)
+    {
+        if(entry->flags & PackEntryFlag_Compressed)
+        {
+            result.data = vfsReadEntry(pack, entry);
+            result.isValid = result.data != nullptr;
+        }
+        else
+        {
+            result.data = pack->file.data + entry->dataOffset;
+            result.isValid = true;
+            result.isInPack = true;
+        }
+        result.dataSize = (rgSize)entry->size;
+        return result;
+    }
+
+#if defined(_WIN32)
+    DWORD flags = (access == FileMapAccess_Sequential) ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS;
+    HANDLE fileHandle = CreateFileA(filepath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | flags, NULL);
+    if(fileHandle != INVALID_HANDLE_VALUE)
+    {
+        LARGE_INTEGER fileSize;
+        if(GetFileSizeEx(fileHandle, &fileSize) && fileSize.QuadPart > 0)
+        {
+            HANDLE mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+            void* view = (mappingHandle != NULL) ? MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0) : NULL;
+            if(view != NULL)
+            {
+                result.isValid = true;
+                result.isMapped = true;
+                result.data = (u8 const*)view;
+                result.dataSize = (rgSize)fileSize.QuadPart;
+                result.fileHandle = fileHandle;
+                result.mappingHandle = mappingHandle;
+
+                if(access == FileMapAccess_Sequential)
+                {
+                    // Fault in the whole file with large reads, instead of page by page
+                    WIN32_MEMORY_RANGE_ENTRY range = { view, (SIZE_T)fileSize.QuadPart };
+                    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+                }
+                return result;
+            }
+
+            if(mappingHandle != NULL)
+            {
+                CloseHandle(mappingHandle);
+            }
+        }
+        CloseHandle(fileHandle);
+    }
+#else
+    int fd = open(filepath, O_RDONLY);
+    if(fd != -1)
+    {
+        struct stat fileStat;
+        if(fstat(fd, &fileStat) == 0 && fileStat.st_size > 0)
+        {
+            void* view = mmap(nullptr, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(view != MAP_FAILED)
+            {
+                // Mapping stays valid after the descriptor is closed
+                close(fd);
+
+                if(access == FileMapAccess_Sequential)
+                {
+                    madvise(view, (size_t)fileStat.st_size, MADV_SEQUENTIAL);
+                    madvise(view, (size_t)fileStat.st_size, MADV_WILLNEED);
+                }
+                else
+                {
+                    madvise(view, (size_t)fileStat.st_size, MADV_RANDOM);
+                }
+
+                result.isValid = true;
+                result.isMapped = true;
+                result.data = (u8 const*)view;
+                result.dataSize = (rgSize)fileStat.st_size;
+                return result;
+            }
+        }
+        close(fd);
+    }
+#endif
+
+    // Fall back to reading, SDL_RWFromFile() also looks in the app bundle on Apple platforms
+    FileData fileData = fileRead(filepath);
+    result.isValid = fileData.isValid;
+    result.isMapped = false;
+    result.data = fileData.data;
+    result.dataSize = fileData.dataSize;
+    return result;
+}
+
+void fileUnmap(FileMapping* fm)
+{
+    if(!fm->isValid)
+    {
+        return;
+    }
+
+    if(fm->isInPack)
+    {
+    }
+    else if(fm->isMapped)
+    {
+#if defined(_WIN32)
+        UnmapViewOfFile(fm->data);
+        CloseHandle((HANDLE)fm->mappingHandle);
+        CloseHandle((HANDLE)fm->fileHandle);
+#else
+        munmap((void*)fm->data, fm->dataSize);
+#endif
+    }
+    else
+    {
+        rgFree((void*)fm->data);
+    }
+
+    *fm = {};
+}
+
+// LINEAR ALLOCATOR
+// ----------------
+
+LinearAllocator::LinearAllocator(char const* name, rgSize capacity)
+    : name(name)
+    , capacity(capacity)
+    , offset(0)
+    , overflowSize(0)
+    , overflowBlocks(nullptr)
+    , resetCount(0)
+    , lock(0)
+{
+    memory = (u8*)rgMalloc(capacity);
+    rgAssert(memory != nullptr);
+}
+
+LinearAllocator::~LinearAllocator()
+{
+    reset();
+    rgFree(memory);
+}
+
+void* LinearAllocator::allocate(rgSize size, rgSize alignment)
+{
+    rgAssert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+    SDL_AtomicLock(&lock);
+
+    void* result;
+    rgUPtr base = (rgUPtr)memory;
+    rgUPtr alignedStart = (base + offset + alignment - 1) & ~(rgUPtr)(alignment - 1);
+    if(alignedStart + size <= base + capacity)
+    {
+        offset = (alignedStart + size) - base;
+        result = (void*)alignedStart;
+    }
+    else
+    {
+        // Out of space, take it from the heap till the next reset()
+        rgSize blockSize = sizeof(OverflowBlock) + alignment + size;
+        OverflowBlock* block = (OverflowBlock*)rgMalloc(blockSize);
+        rgAssert(block != nullptr);
+        block->next = overflowBlocks;
+        overflowBlocks = block;
+        overflowSize += blockSize;
+
+        rgUPtr blockStart = (rgUPtr)(block + 1);
+        result = (void*)((blockStart + alignment - 1) & ~(rgUPtr)(alignment - 1));
+    }
+
+    SDL_AtomicUnlock(&lock);
+    return result;
+}
+
+void LinearAllocator::reset()
+{
+    SDL_AtomicLock(&lock);
+
+    if(overflowBlocks != nullptr)
+    {
+        while(overflowBlocks != nullptr)
+        {
+            OverflowBlock* next = overflowBlocks->next;
+            rgFree(overflowBlocks);
+            overflowBlocks = next;
+        }
+
+        // Grow so that the same workload fits next time
+        rgSize newCapacity = capacity;
+        while(newCapacity < offset + overflowSize)
+        {
+            newCapacity *= 2;
+        }
+        rgLogWarn("LinearAllocator '%s' overflowed by %zu bytes, growing from %zu to %zu bytes", name, overflowSize, capacity, newCapacity);
+
+        rgFree(memory);
+        memory = (u8*)rgMalloc(newCapacity);
+        rgAssert(memory != nullptr);
+        capacity = newCapacity;
+        overflowSize = 0;
+    }
+    offset = 0;
+    ++resetCount;
+
+    SDL_AtomicUnlock(&lock);
+}
+
+// UTILS
+// -----
+
+char* getSaveDataPath()
+{
+    return SDL_GetPrefPath("rg", "gamelib");
+}
+
+// LOGGING
+// -------
+
+static const u32 kLogSlotCount = 16 * 1024; // Must be power of 2
+static const u32 kLogSlotPayloadSize = 60;
+static const u32 kLogMaxMessageLength = 8192;
+static const rgSize kLogFileInitialCapacity = rgMegabyte(1);
+
+static_assert(sizeof(LogRecordHeader) <= kLogSlotPayloadSize, "LogRecordHeader must fit in the first slot");
+
+LogLevel g_LogCategoryLevels[LogCategory_Count]; // Everything is enabled by default
+
+static char const* logLevelNames[LogLevel_Count] = { "Debug", "Info", "Warn", "Error" };
+static char const* logCategoryNames[LogCategory_Count] = { "General", "Core", "Gfx", "Asset", "Physics", "Game" };
+static SDL_LogPriority logLevelPriorities[LogLevel_Count] = { SDL_LOG_PRIORITY_DEBUG, SDL_LOG_PRIORITY_INFO, SDL_LOG_PRIORITY_WARN, SDL_LOG_PRIORITY_ERROR };
+
+// Bounded MPSC ring, see Dmitry Vyukov's bounded MPMC queue. A record takes
+// one or more consecutive slots. A slot's sequence equals the position when
+// it's free for that lap, and position + 1 once the record starting at it
+// is written; only the first slot of a record is published.
+struct alignas(64) LogSlot
+{
+    std::atomic<u32>    sequence;
+    u8                  payload[kLogSlotPayloadSize];
+};
+
+// Grows by remapping, the file is trimmed to the written size when closed.
+// Written pages belong to the OS, so they reach the disk even if we crash.
+struct LogFileSink
+{
+    rgBool  isOpen;
+    u8*     view;
+    rgSize  capacity;
+    rgSize  size;
+#if defined(_WIN32)
+    HANDLE  fileHandle;
+    HANDLE  mappingHandle;
+#else
+    int     fd;
+#endif
+};
+
+struct Logger
+{
+    LogSlot                         slots[kLogSlotCount];
+    alignas(64) std::atomic<u32>    writePosition;
+    alignas(64) std::atomic<u32>    readPosition; // Advanced by the logger thread after the record is written out
+    std::atomic<u32>                droppedCount;
+    std::atomic<u32>                isLoggerThreadSleeping;
+    std::atomic<u32>                activeWriterCount; // logSubmitRecord() calls that may still write to the ring
+    std::atomic<bool>               isRunning;
+    std::atomic<bool>               shouldQuit;
+    SDL_sem*                        wakeSemaphore;
+    SDL_Thread*                     thread;
+    u64                             startTimestamp;
+    LogFileSink                     file;
+    SDL_SpinLock                    outputLock; // Serializes the logger thread and the synchronous path
+};
+
+// Static, so it can be used before logInit() and isn't reported as a leak
+static Logger logger;
+
+struct LogArg
+{
+    LogArgType  type;
+    u8          size;
+    u64         value;
+    char const* str;
+    u16         strLength;
+};
+
+struct LogArgReader
+{
+    u8 const*   cursor;
+    u8 const*   end;
+};
+
+static rgBool logFileSinkMap(LogFileSink* sink, rgSize capacity)
+{
+#if defined(_WIN32)
+    LARGE_INTEGER mappingSize;
+    mappingSize.QuadPart = (LONGLONG)capacity;
+    sink->mappingHandle = CreateFileMappingA(sink->fileHandle, NULL, PAGE_READWRITE, mappingSize.HighPart, mappingSize.LowPart, NULL);
+    void* view = (sink->mappingHandle != NULL) ? MapViewOfFile(sink->mappingHandle, FILE_MAP_WRITE, 0, 0, capacity) : NULL;
+    if(view == NULL)
+    {
+        if(sink->mappingHandle != NULL)
+        {
+            CloseHandle(sink->mappingHandle);
+            sink->mappingHandle = NULL;
+        }
+        return false;
+    }
+#else
+    if(ftruncate(sink->fd, (off_t)capacity) != 0)
+    {
+        return false;
+    }
+    void* view = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, sink->fd, 0);
+    if(view == MAP_FAILED)
+    {
+        return false;
+    }
+#endif
+    sink->view = (u8*)view;
+    sink->capacity = capacity;
+    return true;
+}
+
+static void logFileSinkUnmap(LogFileSink* sink)
+{
+    if(sink->view == nullptr)
+    {
+        return;
+    }
+#if defined(_WIN32)
+    UnmapViewOfFile(sink->view);
+    CloseHandle(sink->mappingHandle);
+    sink->mappingHandle = NULL;
+#else
+    munmap(sink->view, sink->capacity);
+#endif
+    sink->view = nullptr;
+}
+
+static rgBool logFileSinkOpen(LogFileSink* sink, char const* filepath)
+{
+    *sink = {};
+#if defined(_WIN32)
+    sink->fileHandle = CreateFileA(filepath, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(sink->fileHandle == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+#else
+    sink->fd = open(filepath, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(sink->fd == -1)
+    {
+        return false;
+    }
+#endif
+    sink->isOpen = true;
+    return logFileSinkMap(sink, kLogFileInitialCapacity);
+}
+
+static void logFileSinkWrite(LogFileSink* sink, char const* text, rgSize length)
+{
+    if(sink->view == nullptr)
+    {
+        return;
+    }
+
+    if(sink->size + length > sink->capacity)
+    {
+        rgSize newCapacity = sink->capacity * 2;
+        while(sink->size + length > newCapacity)
+        {
+            newCapacity *= 2;
+        }
+        logFileSinkUnmap(sink);
+        if(!logFileSinkMap(sink, newCapacity))
+        {
+            return; // Stop writing, the close still trims the file
+        }
+    }
+
+    SDL_memcpy(sink->view + sink->size, text, length);
+    sink->size += length;
+}
+
+static void logFileSinkClose(LogFileSink* sink)
+{
+    if(!sink->isOpen)
+    {
+        return;
+    }
+
+    logFileSinkUnmap(sink);
+#if defined(_WIN32)
+    LARGE_INTEGER fileSize;
+    fileSize.QuadPart = (LONGLONG)sink->size;
+    SetFilePointerEx(sink->fileHandle, fileSize, NULL, FILE_BEGIN);
+    SetEndOfFile(sink->fileHandle);
+    CloseHandle(sink->fileHandle);
+#else
+    if(ftruncate(sink->fd, (off_t)sink->size) != 0)
+    {
+        // Nothing to do, the tail of the file is just zeros
+    }
+    close(sink->fd);
+#endif
+    *sink = {};
+}
+
+void logWriteValueArg(LogRecordWriter* writer, LogArgType type, u8 size, u64 value)
+{
+    if(writer->cursor + 2 + sizeof(u64) > writer->record + kLogMaxRecordSize)
+    {
+        return; // Shows up as a missing argument
+    }
+    writer->cursor[0] = type;
+    writer->cursor[1] = size;
+    SDL_memcpy(writer->cursor + 2, &value, sizeof(u64));
+    writer->cursor += 2 + sizeof(u64);
+    ++writer->argCount;
+}
+
+void logWriteStringArg(LogRecordWriter* writer, char const* str)
+{
+    if(str == nullptr)
+    {
+        str = "(null)";
+    }
+
+    rgSize available = (writer->record + kLogMaxRecordSize) - writer->cursor;
+    if(available < 1 + sizeof(u16))
+    {
+        return;
+    }
+    u16 length = (u16)eastl::min(SDL_strlen(str), available - 1 - sizeof(u16));
+
+    writer->cursor[0] = LogArgType_String;
+    SDL_memcpy(writer->cursor + 1, &length, sizeof(u16));
+    SDL_memcpy(writer->cursor + 1 + sizeof(u16), str, length);
+    writer->cursor += 1 + sizeof(u16) + length;
+    ++writer->argCount;
+}
+
+static rgBool logReadArg(LogArgReader* reader, LogArg* arg)
+{
+    if(reader->cursor >= reader->end)
+    {
+        return false;
+    }
+
+    arg->type = (LogArgType)*reader->cursor++;
+    if(arg->type == LogArgType_String)
+    {
+        SDL_memcpy(&arg->strLength, reader->cursor, sizeof(u16));
+        arg->str = (char const*)reader->cursor + sizeof(u16);
+        reader->cursor += sizeof(u16) + arg->strLength;
+    }
+    else
+    {
+        arg->size = *reader->cursor++;
+        SDL_memcpy(&arg->value, reader->cursor, sizeof(u64));
+        reader->cursor += sizeof(u64);
+    }
+    return true;
+}
+
+static u64 logArgAsUnsigned(LogArg const* arg)
+{
+    // Matches printf, e.g. %u with an i32 -1 prints 4294967295
+    return (arg->size < sizeof(u64)) ? arg->value & ((1ULL << (arg->size * 8)) - 1) : arg->value;
+}
+
+// Formats the stored arguments. As their types are known, the length
+// modifiers of the format are ignored, and mismatches print "<?>" instead
+// of being undefined behaviour.
+static void logFormatMessage(char const* fmt, LogArgReader* reader, char* out, rgSize outSize)
+{
+    rgSize length = 0;
+    char const* c = fmt;
+    while(*c != '\0' && length + 1 < outSize)
+    {
+        if(*c != '%')
+        {
+            out[length++] = *c++;
+            continue;
+        }
+        if(c[1] == '%')
+        {
+            out[length++] = '%';
+            c += 2;
+            continue;
+        }
+
+        // Rebuild the conversion spec, '*' are replaced by their values. Flags,
+        // width and precision are capped so the spec and its conversion fit
+        char spec[48];
+        rgSize specLength = 0;
+        spec[specLength++] = *c++;
+        while(*c != '\0' && SDL_strchr("-+ #0", *c) != nullptr && specLength < 8)
+        {
+            spec[specLength++] = *c++;
+        }
+        for(i32 i = 0; i < 2; ++i)
+        {
+            if(i == 1)
+            {
+                if(*c != '.')
+                {
+                    break;
+                }
+                spec[specLength++] = *c++;
+            }
+
+            if(*c == '*')
+            {
+                ++c;
+                LogArg starArg;
+                i64 starValue = (logReadArg(reader, &starArg) && starArg.type != LogArgType_String) ? (i64)starArg.value : 0;
+                specLength += SDL_snprintf(spec + specLength, 12, "%d", (i32)eastl::max<i64>(i == 0 ? INT_MIN : 0, starValue)); // At most 11 chars
+            }
+            else
+            {
+                while(*c >= '0' && *c <= '9')
+                {
+                    if(specLength < (i == 0 ? 20u : 32u))
+                    {
+                        spec[specLength++] = *c;
+                    }
+                    ++c;
+                }
+            }
+        }
+        while(*c != '\0' && SDL_strchr("hlLqjzt", *c) != nullptr)
+        {
+            ++c;
+        }
+        char conversion = *c;
+        if(conversion == '\0')
+        {
+            break;
+        }
+        ++c;
+
+        LogArg arg;
+        rgBool hasArg = logReadArg(reader, &arg);
+        rgBool isInteger = hasArg && (arg.type == LogArgType_Int || arg.type == LogArgType_UInt);
+        char* dst = out + length;
+        rgSize dstSize = outSize - length;
+        int written = -1;
+
+        switch(conversion)
+        {
+            case 'd': case 'i':
+                if(isInteger)
+                {
+                    SDL_strlcpy(spec + specLength, "lld", sizeof(spec) - specLength);
+                    written = snprintf(dst, dstSize, spec, (long long)arg.value);
+                }
+                break;
+            case 'u': case 'o': case 'x': case 'X':
+                if(isInteger)
+                {
+                    char modifier[4] = { 'l', 'l', conversion, '\0' };
+                    SDL_strlcpy(spec + specLength, modifier, sizeof(spec) - specLength);
+                    written = snprintf(dst, dstSize, spec, (unsigned long long)logArgAsUnsigned(&arg));
+                }
+                break;
+            case 'c':
+                if(isInteger)
+                {
+                    SDL_strlcpy(spec + specLength, "c", sizeof(spec) - specLength);
+                    written = snprintf(dst, dstSize, spec, (int)arg.value);
+                }
+                break;
+            case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+                if(hasArg && arg.type == LogArgType_Float)
+                {
+                    char modifier[2] = { conversion, '\0' };
+                    SDL_strlcpy(spec + specLength, modifier, sizeof(spec) - specLength);
+                    f64 value;
+                    SDL_memcpy(&value, &arg.value, sizeof(f64));
+                    written = snprintf(dst, dstSize, spec, value);
+                }
+                break;
+            case 's':
+                if(hasArg && arg.type == LogArgType_String)
+                {
+                    char str[kLogMaxRecordSize];
+                    SDL_memcpy(str, arg.str, arg.strLength);
+                    str[arg.strLength] = '\0';
+                    SDL_strlcpy(spec + specLength, "s", sizeof(spec) - specLength);
+                    written = snprintf(dst, dstSize, spec, str);
+                }
+                break;
+            case 'p':
+                if(hasArg && arg.type != LogArgType_String && arg.type != LogArgType_Float)
+                {
+                    SDL_strlcpy(spec + specLength, "p", sizeof(spec) - specLength);
+                    written = snprintf(dst, dstSize, spec, (void*)(rgUPtr)arg.value);
+                }
+                break;
+            default:
+                break;
+        }
+
+        if(written < 0)
+        {
+            written = snprintf(dst, dstSize, "%s", hasArg ? "<?>" : "<missing>");
+        }
+        length += eastl::min((rgSize)written, dstSize - 1);
+    }
+    out[length] = '\0';
+}
+
+static void logOutputRecord(u8 const* record)
+{
+    LogRecordHeader header;
+    SDL_memcpy(&header, record, sizeof(header));
+
+    char message[kLogMaxMessageLength];
+    LogArgReader reader = { record + sizeof(header), record + header.size };
+    logFormatMessage(header.fmt, &reader, message, sizeof(message));
+
+    // Sinks add their own line ending
+    rgSize messageLength = SDL_strlen(message);
+    while(messageLength > 0 && message[messageLength - 1] == '\n')
+    {
+        message[--messageLength] = '\0';
+    }
+
+    SDL_AtomicLock(&logger.outputLock);
+
+    SDL_LogMessage(SDL_LOG_CATEGORY_TEST, logLevelPriorities[header.level], "[%s] %s", logCategoryNames[header.category], message);
+
+    if(logger.file.view != nullptr)
+    {
+        f64 seconds = (f64)(header.timestamp - logger.startTimestamp) / (f64)SDL_GetPerformanceFrequency();
+        char line[kLogMaxMessageLength + 64];
+        int lineLength = snprintf(line, sizeof(line), "%10.4f [%s][%s] %s\n", seconds, logLevelNames[header.level], logCategoryNames[header.category], message);
+        if(lineLength > 0)
+        {
+            logFileSinkWrite(&logger.file, line, eastl::min((rgSize)lineLength, sizeof(line) - 1));
+        }
+    }
+
+    SDL_AtomicUnlock(&logger.outputLock);
+}
+
+void logSubmitRecord(LogRecordWriter* writer, LogCategory category, LogLevel level, char const* fmt)
+{
+    LogRecordHeader header;
+    header.fmt = fmt;
+    header.timestamp = SDL_GetPerformanceCounter();
+    header.threadId = (u64)SDL_ThreadID();
+    header.size = (u16)(writer->cursor - writer->record);
+    header.category = category;
+    header.level = level;
+    header.argCount = writer->argCount;
+    SDL_memcpy(writer->record, &header, sizeof(header));
+
+    // Counted before isRunning is read, so logShutdown() can wait for the writers
+    // that still saw it set. Both are seq_cst, one of the two sides sees the other
+    logger.activeWriterCount.fetch_add(1);
+    if(!logger.isRunning.load())
+    {
+        logger.activeWriterCount.fetch_sub(1, std::memory_order_release);
+        logOutputRecord(writer->record);
+        return;
+    }
+
+    u32 slotCount = (header.size + kLogSlotPayloadSize - 1) / kLogSlotPayloadSize;
+    u32 position = logger.writePosition.load(std::memory_order_relaxed);
+    for(;;)
+    {
+        // The logger thread frees slots in order, so if the last one is free all of them are
+        u32 lastPosition = position + slotCount - 1;
+        u32 sequence = logger.slots[lastPosition & (kLogSlotCount - 1)].sequence.load(std::memory_order_acquire);
+        i32 difference = (i32)(sequence - lastPosition);
+        if(difference == 0)
+        {
+            if(logger.writePosition.compare_exchange_weak(position, position + slotCount, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if(difference < 0)
+        {
+            // Full, dropping is better than stalling the caller
+            logger.droppedCount.fetch_add(1, std::memory_order_relaxed);
+            logger.activeWriterCount.fetch_sub(1, std::memory_order_release);
+            return;
+        }
+        else
+        {
+            position = logger.writePosition.load(std::memory_order_relaxed);
+        }
+    }
+
+    for(u32 i = 0; i < slotCount; ++i)
+    {
+        u32 offset = i * kLogSlotPayloadSize;
+        SDL_memcpy(logger.slots[(position + i) & (kLogSlotCount - 1)].payload, writer->record + offset, eastl::min(kLogSlotPayloadSize, (u32)header.size - offset));
+    }
+    logger.slots[position & (kLogSlotCount - 1)].sequence.store(position + 1, std::memory_order_release);
+
+    // No fence here to keep the caller cheap, a missed wake up is bounded by the logger thread's wait timeout
+    if(logger.isLoggerThreadSleeping.load(std::memory_order_relaxed) && logger.isLoggerThreadSleeping.exchange(0, std::memory_order_relaxed))
+    {
+        SDL_SemPost(logger.wakeSemaphore);
+    }
+    logger.activeWriterCount.fetch_sub(1, std::memory_order_release);
+}
+
+static rgBool logProcessOne()
+{
+    u32 position = logger.readPosition.load(std::memory_order_relaxed);
+    LogSlot* firstSlot = &logger.slots[position & (kLogSlotCount - 1)];
+    if(firstSlot->sequence.load(std::memory_order_acquire) != position + 1)
+    {
+        return false;
+    }
+
+    u8 record[kLogMaxRecordSize];
+    SDL_memcpy(record, firstSlot->payload, kLogSlotPayloadSize);
+    LogRecordHeader header;
+    SDL_memcpy(&header, record, sizeof(header));
+
+    u32 slotCount = (header.size + kLogSlotPayloadSize - 1) / kLogSlotPayloadSize;
+    for(u32 i = 1; i < slotCount; ++i)
+    {
+        u32 offset = i * kLogSlotPayloadSize;
+        SDL_memcpy(record + offset, logger.slots[(position + i) & (kLogSlotCount - 1)].payload, eastl::min(kLogSlotPayloadSize, (u32)header.size - offset));
+    }
+
+    // Free the slots before the slow part
+    for(u32 i = 0; i < slotCount; ++i)
+    {
+        logger.slots[(position + i) & (kLogSlotCount - 1)].sequence.store(position + i + kLogSlotCount, std::memory_order_release);
+    }
+
+    logOutputRecord(record);
+    logger.readPosition.store(position + slotCount, std::memory_order_release);
+    return true;
+}
+
+static int logThreadMain(void* data)
+{
+    profilerSetThreadName("Logger");
+
+    for(;;)
+    {
+        if(logProcessOne())
+        {
+            continue;
+        }
+
+        if(logger.shouldQuit.load(std::memory_order_acquire))
+        {
+            // Wait for the records claimed before isRunning was cleared
+            while(logger.readPosition.load(std::memory_order_relaxed) != logger.writePosition.load(std::memory_order_acquire))
+            {
+                if(!logProcessOne())
+                {
+                    SDL_CPUPauseInstruction();
+                }
+            }
+            break;
+        }
+
+        logger.isLoggerThreadSleeping.store(1);
+        if(!logProcessOne())
+        {
+            SDL_SemWaitTimeout(logger.wakeSemaphore, 10);
+        }
+        logger.isLoggerThreadSleeping.store(0, std::memory_order_relaxed);
+    }
+    return 0;
+}
+
+void logInit(char const* logFilepath)
+{
+    rgAssert(!logger.isRunning.load());
+
+    for(u32 i = 0; i < kLogSlotCount; ++i)
+    {
+        logger.slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    logger.writePosition.store(0, std::memory_order_relaxed);
+    logger.readPosition.store(0, std::memory_order_relaxed);
+    logger.droppedCount.store(0, std::memory_order_relaxed);
+    logger.isLoggerThreadSleeping.store(0, std::memory_order_relaxed);
+    logger.activeWriterCount.store(0, std::memory_order_relaxed);
+    logger.shouldQuit.store(false, std::memory_order_relaxed);
+    logger.startTimestamp = SDL_GetPerformanceCounter();
+
+    rgBool isFileOpen = (logFilepath == nullptr) || logFileSinkOpen(&logger.file, logFilepath);
+
+    logger.wakeSemaphore = SDL_CreateSemaphore(0);
+    logger.isRunning.store(true, std::memory_order_release);
+    logger.thread = SDL_CreateThread(logThreadMain, "Logger", nullptr);
+    if(logger.thread == nullptr)
+    {
+        logger.isRunning.store(false, std::memory_order_release);
+        SDL_DestroySemaphore(logger.wakeSemaphore);
+        logger.wakeSemaphore = nullptr;
+        rgLogCategory(LogCategory_Core, LogLevel_Warn, "Can't create the logger thread, logging synchronously");
+    }
+
+    if(!isFileOpen)
+    {
+        rgLogCategory(LogCategory_Core, LogLevel_Warn, "Can't open log file %s", logFilepath);
+    }
+}
+
+void logShutdown()
+{
+    if(logger.isRunning.load(std::memory_order_acquire))
+    {
+        // New records go out synchronously from here on. Records of writers that
+        // saw isRunning set are published before the stop flag, so the drain
+        // in logThreadMain() writes them out
+        logger.isRunning.store(false);
+        while(logger.activeWriterCount.load(std::memory_order_acquire) != 0)
+        {
+            SDL_CPUPauseInstruction();
+        }
+        logger.shouldQuit.store(true, std::memory_order_release);
+        SDL_SemPost(logger.wakeSemaphore);
+        SDL_WaitThread(logger.thread, nullptr);
+        rgAssert(logger.readPosition.load() == logger.writePosition.load());
+        SDL_DestroySemaphore(logger.wakeSemaphore);
+        logger.thread = nullptr;
+        logger.wakeSemaphore = nullptr;
+
+        u32 droppedCount = logger.droppedCount.load();
+        if(droppedCount > 0)
+        {
+            rgLogCategory(LogCategory_Core, LogLevel_Warn, "%u log messages were dropped, the log ring was full", droppedCount);
+        }
+    }
+
+    SDL_AtomicLock(&logger.outputLock);
+    logFileSinkClose(&logger.file);
+    SDL_AtomicUnlock(&logger.outputLock);
+}
+
+void logFlush()
+{
+    if(!logger.isRunning.load(std::memory_order_acquire))
+    {
+        return;
+    }
+
+    u32 position = logger.writePosition.load(std::memory_order_acquire);
+    SDL_SemPost(logger.wakeSemaphore);
+    while((i32)(logger.readPosition.load(std::memory_order_acquire) - position) < 0)
+    {
+        SDL_Delay(0);
+    }
+}
+
+void logSetCategoryLevel(LogCategory category, LogLevel minLevel)
+{
+    rgAssert(category < LogCategory_Count);
+    g_LogCategoryLevels[category] = minLevel;
+}
+
+u32 logGetDroppedCount()
+{
+    return logger.droppedCount.load(std::memory_order_relaxed);
+}
+
+// PROFILER
+// --------
+
+#if defined(RG_ENABLE_PROFILER)
+
+static const u32 kProfilerMaxThreads = 64;
+static const u32 kProfilerMaxEventsPerThread = 64 * 1024; // Must be power of 2
+static const u32 kProfilerMaxZoneDepth = 64;
+
+struct ProfilerEvent
+{
+    char const* name; // nullptr marks the end of a zone
+    u64         timestamp;
+};
+
+// Events are written only by the owner thread, the main thread reads
+// the events up to writeIndex when capturing a frame or dumping a trace
+struct ProfilerThreadData
+{
+    ProfilerEvent       events[kProfilerMaxEventsPerThread];
+    std::atomic<u32>    writeIndex;
+    u32                 frameStartIndex; // Accessed only by the main thread
+    SDL_threadID        threadId;
+    rgChar              name[32];
+};
+
+struct ProfilerZone
+{
+    char const* name;
+    u64         begin;
+    u64         end;
+    u16         depth;
+    u16         threadIndex;
+};
+
+static std::atomic<ProfilerThreadData*> profilerThreads[kProfilerMaxThreads];
+static std::atomic<u32>                 profilerThreadCount;
+static thread_local ProfilerThreadData* profilerCurrentThread;
+
+static eastl::vector<ProfilerZone>      profilerCapturedZones;
+static u64                              profilerCapturedFrameBegin;
+static u64                              profilerCapturedFrameEnd;
+static u64                              profilerLastFrameBoundary;
+static rgBool                           profilerCapturePaused;
+
+static ProfilerThreadData* profilerRegisterCurrentThread()
+{
+    u32 threadIndex = profilerThreadCount.fetch_add(1, std::memory_order_relaxed);
+    if(threadIndex >= kProfilerMaxThreads)
+    {
+        rgAssert(!"Increase kProfilerMaxThreads");
+        return nullptr;
+    }
+
+    ProfilerThreadData* t = rgNew(ProfilerThreadData);
+    t->writeIndex.store(0, std::memory_order_relaxed);
+    t->frameStartIndex = 0;
+    t->threadId = SDL_ThreadID();
+    SDL_snprintf(t->name, rgArrayCount(t->name), "Thread %u", threadIndex);
+
+    profilerThreads[threadIndex].store(t, std::memory_order_release);
+    profilerCurrentThread = t;
+    return t;
+}
+
+static RG_INLINE void profilerPushEvent(char const* name)
+{
+    ProfilerThreadData* t = profilerCurrentThread;
+    if(t == nullptr)
+    {
+        t = profilerRegisterCurrentThread();
+        if(t == nullptr)
+        {
+            return;
+        }
+    }
+
+    u32 index = t->writeIndex.load(std::memory_order_relaxed);
+    ProfilerEvent* e = &t->events[index & (kProfilerMaxEventsPerThread - 1)];
+    e->name = name;
+    e->timestamp = SDL_GetPerformanceCounter();
+    t->writeIndex.store(index + 1, std::memory_order_release);
+}
+
+void profilerBeginZone(char const* name)
+{
+    profilerPushEvent(name);
+}
+
+void profilerEndZone()
+{
+    profilerPushEvent(nullptr);
+}
+
+void profilerSetThreadName(char const* name)
+{
+    ProfilerThreadData* t = profilerCurrentThread != nullptr ? profilerCurrentThread : profilerRegisterCurrentThread();
+    if(t != nullptr)
+    {
+        SDL_strlcpy(t->name, name, rgArrayCount(t->name));
+    }
+}
+
+void profilerBeginFrame()
+{
+    u64 now = SDL_GetPerformanceCounter();
+    u32 threadCount = eastl::min(profilerThreadCount.load(std::memory_order_acquire), kProfilerMaxThreads);
+
+    if(!profilerCapturePaused)
+    {
+        profilerCapturedZones.clear();
+        profilerCapturedFrameBegin = profilerLastFrameBoundary;
+        profilerCapturedFrameEnd = now;
+    }
+
+    for(u32 threadIndex = 0; threadIndex < threadCount; ++threadIndex)
+    {
+        ProfilerThreadData* t = profilerThreads[threadIndex].load(std::memory_order_acquire);
+        if(t == nullptr)
+        {
+            continue;
+        }
+
+        u32 endIndex = t->writeIndex.load(std::memory_order_acquire);
+        u32 startIndex = t->frameStartIndex;
+        t->frameStartIndex = endIndex;
+
+        if(profilerCapturePaused)
+        {
+            continue;
+        }
+
+        // Older events are already overwritten
+        if(endIndex - startIndex > kProfilerMaxEventsPerThread)
+        {
+            startIndex = endIndex - kProfilerMaxEventsPerThread;
+        }
+
+        u32 openZones[kProfilerMaxZoneDepth];
+        u32 depth = 0;
+        for(u32 i = startIndex; i != endIndex; ++i)
+        {
+            ProfilerEvent const& e = t->events[i & (kProfilerMaxEventsPerThread - 1)];
+            if(e.name != nullptr)
+            {
+                if(depth < kProfilerMaxZoneDepth)
+                {
+                    openZones[depth] = (u32)profilerCapturedZones.size();
+                    profilerCapturedZones.push_back({ e.name, e.timestamp, now, (u16)depth, (u16)threadIndex });
+                }
+                ++depth;
+            }
+            else if(depth > 0)
+            {
+                --depth;
+                if(depth < kProfilerMaxZoneDepth)
+                {
+                    profilerCapturedZones[openZones[depth]].end = e.timestamp;
+                }
+            }
+            // else the zone began before this frame, ignore it
+        }
+    }
+
+    profilerLastFrameBoundary = now;
+}
+
+void profilerShowImGuiWindow(bool* open)
+{
+    static f32 zoom = 1.0f;
+
+    ImGui::SetNextWindowSize(ImVec2(800, 300), ImGuiCond_FirstUseEver);
+    if(ImGui::Begin("Profiler", open))
+    {
+        f64 ticksToMs = 1000.0 / (f64)SDL_GetPerformanceFrequency();
+        f64 frameMs = (profilerCapturedFrameEnd - profilerCapturedFrameBegin) * ticksToMs;
+
+        ImGui::Checkbox("Pause", &profilerCapturePaused);
+        ImGui::SameLine();
+        if(ImGui::Button("Dump Chrome Trace (F11)"))
+        {
+            profilerDumpChromeTrace("rg_profile_trace.json");
+        }
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(150.0f);
+        ImGui::SliderFloat("Zoom", &zoom, 1.0f, 50.0f, "%.1fx", ImGuiSliderFlags_Logarithmic);
+        ImGui::Text("Frame %0.3f ms, %u zones", frameMs, (u32)profilerCapturedZones.size());
+        ImGui::Separator();
+
+        ImGui::BeginChild("ProfilerFlameGraph", ImVec2(0, 0), false, ImGuiWindowFlags_HorizontalScrollbar);
+
+        f32 const rowHeight = ImGui::GetTextLineHeightWithSpacing();
+        f32 const width = ImGui::GetContentRegionAvail().x * zoom;
+        f64 const pxPerTick = (frameMs > 0.0) ? width / (f64)(profilerCapturedFrameEnd - profilerCapturedFrameBegin) : 0.0;
+
+        ImDrawList* drawList = ImGui::GetWindowDrawList();
+        ImVec2 origin = ImGui::GetCursorScreenPos();
+        ImVec2 mousePos = ImGui::GetMousePos();
+
+        // Each thread gets a band of rows, one row per depth
+        u32 threadCount = eastl::min(profilerThreadCount.load(std::memory_order_acquire), kProfilerMaxThreads);
+        f32 bandY = origin.y;
+        for(u32 threadIndex = 0; threadIndex < threadCount; ++threadIndex)
+        {
+            ProfilerThreadData* t = profilerThreads[threadIndex].load(std::memory_order_acquire);
+            if(t == nullptr)
+            {
+                continue;
+            }
+
+            u16 maxDepth = 0;
+            for(ProfilerZone const& z : profilerCapturedZones)
+            {
+                if(z.threadIndex == threadIndex)
+                {
+                    maxDepth = eastl::max(maxDepth, (u16)(z.depth + 1));
+                }
+            }
+            if(maxDepth == 0)
+            {
+                continue;
+            }
+
+            drawList->AddText(ImVec2(origin.x, bandY), ImGui::GetColorU32(ImGuiCol_Text), t->name);
+            bandY += rowHeight;
+
+            for(ProfilerZone const& z : profilerCapturedZones)
+            {
+                if(z.threadIndex != threadIndex)
+                {
+                    continue;
+                }
+
+                u64 zoneBegin = eastl::max(z.begin, profilerCapturedFrameBegin);
+                f32 x0 = origin.x + (f32)((zoneBegin - profilerCapturedFrameBegin) * pxPerTick);
+                f32 x1 = origin.x + (f32)((z.end - profilerCapturedFrameBegin) * pxPerTick);
+                f32 y0 = bandY + z.depth * rowHeight;
+                f32 y1 = y0 + rowHeight - 1.0f;
+                x1 = eastl::max(x1, x0 + 1.0f);
+
+                // Color from name pointer, so a zone keeps its color across frames
+                u32 hash = (u32)(((rgUPtr)z.name >> 3) * 2654435761u);
+                ImU32 color = IM_COL32(80 + (hash & 0x7F), 80 + ((hash >> 8) & 0x7F), 80 + ((hash >> 16) & 0x7F), 255);
+
+                drawList->AddRectFilled(ImVec2(x0, y0), ImVec2(x1, y1), color);
+                if(x1 - x0 > 20.0f)
+                {
+                    ImVec4 clipRect(x0, y0, x1, y1);
+                    drawList->AddText(nullptr, 0.0f, ImVec2(x0 + 2.0f, y0), IM_COL32_BLACK, z.name, nullptr, 0.0f, &clipRect);
+                }
+
+                if(mousePos.x >= x0 && mousePos.x < x1 && mousePos.y >= y0 && mousePos.y < y1 && ImGui::IsWindowHovered())
+                {
+                    ImGui::SetTooltip("%s\n%0.3f ms", z.name, (z.end - zoneBegin) * ticksToMs);
+                }
+            }
+            bandY += maxDepth * rowHeight + rowHeight * 0.5f;
+        }
+
+        ImGui::Dummy(ImVec2(width, bandY - origin.y));
+        ImGui::EndChild();
+    }
+    ImGui::End();
+}
+
+rgBool profilerDumpChromeTrace(char const* filepath)
+{
+    f64 ticksToUs = 1000000.0 / (f64)SDL_GetPerformanceFrequency();
+    u32 threadCount = eastl::min(profilerThreadCount.load(std::memory_order_acquire), kProfilerMaxThreads);
+
+    auto appendEscaped = [](eastl::string& str, char const* s)
+    {
+        for(; *s != '\0'; ++s)
+        {
+            if(*s == '"' || *s == '\\')
+            {
+                str.push_back('\\');
+            }
+            str.push_back(*s);
+        }
+    };
+
+    // Make the timestamps relative to the oldest event in the trace
+    u64 baseTimestamp = UINT64_MAX;
+    for(u32 threadIndex = 0; threadIndex < threadCount; ++threadIndex)
+    {
+        ProfilerThreadData* t = profilerThreads[threadIndex].load(std::memory_order_acquire);
+        if(t != nullptr)
+        {
+            u32 endIndex = t->writeIndex.load(std::memory_order_acquire);
+            u32 startIndex = (endIndex > kProfilerMaxEventsPerThread) ? endIndex - kProfilerMaxEventsPerThread : 0;
+            if(startIndex != endIndex)
+            {
+                baseTimestamp = eastl::min(baseTimestamp, t->events[startIndex & (kProfilerMaxEventsPerThread - 1)].timestamp);
+            }
+        }
+    }
+
+    eastl::string json;
+    json.reserve(rgMegabyte(1));
+    json.append("{\"traceEvents\":[\n");
+
+    rgBool firstEvent = true;
+    for(u32 threadIndex = 0; threadIndex < threadCount; ++threadIndex)
+    {
+        ProfilerThreadData* t = profilerThreads[threadIndex].load(std::memory_order_acquire);
+        if(t == nullptr)
+        {
+            continue;
+        }
+
+        json.append_sprintf("%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"", firstEvent ? "" : ",\n", threadIndex);
+        appendEscaped(json, t->name);
+        json.append("\"}}");
+        firstEvent = false;
+
+        u32 endIndex = t->writeIndex.load(std::memory_order_acquire);
+        u32 startIndex = (endIndex > kProfilerMaxEventsPerThread) ? endIndex - kProfilerMaxEventsPerThread : 0;
+
+        // Skip the end events of zones which are already overwritten
+        i32 depth = 0;
+        for(u32 i = startIndex; i != endIndex; ++i)
+        {
+            ProfilerEvent const& e = t->events[i & (kProfilerMaxEventsPerThread - 1)];
+            if(e.name == nullptr && depth == 0)
+            {
+                continue;
+            }
+            depth += (e.name != nullptr) ? 1 : -1;
+
+            f64 ts = (e.timestamp - baseTimestamp) * ticksToUs;
+            if(e.name != nullptr)
+            {
+                json.append(",\n{\"name\":\"");
+                appendEscaped(json, e.name);
+                json.append_sprintf("\",\"ph\":\"B\",\"pid\":0,\"tid\":%u,\"ts\":%.3f}", threadIndex, ts);
+            }
+            else
+            {
+                json.append_sprintf(",\n{\"ph\":\"E\",\"pid\":0,\"tid\":%u,\"ts\":%.3f}", threadIndex, ts);
+            }
+        }
+    }
+    json.append("\n]}\n");
+
+    rgBool result = fileWrite(filepath, (void*)json.data(), json.size());
+    if(result)
+    {
+        rgLog("Profiler trace written to %s", filepath);
+    }
+    return result;
+}
+
+#else
+
+void profilerSetThreadName(char const* name)
+{
 }
 
-int TheApp::beginApp()
+void profilerBeginFrame()
 {
-    g_FrameIndex = -1;
+}
 
-    if(createSDLWindow() != 0)
+void profilerShowImGuiWindow(bool* open)
+{
+    if(ImGui::Begin("Profiler", open))
     {
-        return -1; // error;
+        ImGui::Text("Profiler is compiled out, see RG_ENABLE_PROFILER in core.h");
     }
+    ImGui::End();
+}
 
-    i32 gfxPreInitResult = gfxPreInit();
-    i32 gfxInitResult = gfxInit();
-    i32 gfxCommonInitResult = gfxPostInit();
+rgBool profilerDumpChromeTrace(char const* filepath)
+{
+    return false;
+}
 
-    if(gfxInitResult || gfxCommonInitResult)
-    {
-        return gfxInitResult | gfxCommonInitResult;
-    }
+#endif
 
-    //setup();
+// JOB SYSTEM
+// ----------
 
-    g_ShouldAppQuit = false;
-    
-    currentPerfCounter = SDL_GetPerformanceCounter();
-    previousPerfCounter = currentPerfCounter;
-    
-    oldAppInput = &inputs[0];
-    newAppInput = &inputs[1];
+static const i64 kJobDequeCapacity = 4096; // Must be power of 2
+static const u32 kJobMaxParallelForBatches = 256;
+static const u32 kJobMaxThreads = 64;
 
-    return 1;
-}
+struct JobEntry
+{
+    Job         job;
+    JobCounter* counter;
+};
 
-void TheApp::beforeUpdateAndDraw()
+// Chase-Lev work-stealing deque, see "Correct and Efficient Work-Stealing for
+// Weak Memory Models" (Le et al. 2013). Only the owner thread calls push() and
+// pop(), any thread can call steal(). Fixed capacity, push() fails when full.
+struct alignas(64) JobDeque
 {
-    ++g_FrameNumber;
-    
-    // Copy old input state to new input state
-    *newAppInput = {};
-    GameControllerInput* oldController1 = &oldAppInput->controllers[0];
-    GameControllerInput* newController1 = &newAppInput->controllers[0];
-    for(i32 buttonIdx = 0; buttonIdx < rgArrayCount(GameControllerInput::buttons); ++buttonIdx)
-    {
-        newController1->buttons[buttonIdx].endedDown = oldController1->buttons[buttonIdx].endedDown;
-    }
-    
-    // Copy old mouse input state to new mouse input state
-    newAppInput->mouse.x = oldAppInput->mouse.x;
-    newAppInput->mouse.y = oldAppInput->mouse.y;
-    for(i32 buttonIdx = 0; buttonIdx < rgArrayCount(GameControllerInput::buttons); ++buttonIdx)
+    alignas(64) std::atomic<i64> top;
+    alignas(64) std::atomic<i64> bottom;
+    JobEntry entries[kJobDequeCapacity];
+
+    rgBool push(JobEntry const& entry)
     {
-        newAppInput->mouse.buttons[buttonIdx].endedDown = oldAppInput->mouse.buttons[buttonIdx].endedDown;
+        i64 b = bottom.load(std::memory_order_relaxed);
+        i64 t = top.load(std::memory_order_acquire);
+        if(b - t >= kJobDequeCapacity)
+        {
+            return false;
+        }
+        entries[b & (kJobDequeCapacity - 1)] = entry;
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return true;
     }
-    
-    theAppInput = newAppInput;
 
-    // Copy timing information
-    Uint64 counterFrequency = SDL_GetPerformanceFrequency();
-    previousPerfCounter = currentPerfCounter;
-    currentPerfCounter = SDL_GetPerformanceCounter();
-    theAppInput->deltaTime = ((currentPerfCounter - previousPerfCounter) / (1.0 * SDL_GetPerformanceFrequency()));
-    theAppInput->time = currentPerfCounter / (1.0 * counterFrequency);
-    
-    // Process events
-    SDL_Event event;
-    while(SDL_PollEvent(&event) != 0)
+    rgBool pop(JobEntry* entry)
     {
-        ImGui_ImplSDL2_ProcessEvent(&event); // TODO: Is this the right to place this here?
-        
-        if(event.type == SDL_QUIT)
+        i64 b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        i64 t = top.load(std::memory_order_relaxed);
+
+        rgBool result = true;
+        if(t <= b)
         {
-            g_ShouldAppQuit = true;
+            *entry = entries[b & (kJobDequeCapacity - 1)];
+            if(t == b)
+            {
+                // Last entry, race against the thieves
+                if(!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                {
+                    result = false;
+                }
+                bottom.store(b + 1, std::memory_order_relaxed);
+            }
         }
-        else if(event.type == SDL_WINDOWEVENT_SIZE_CHANGED)
+        else
         {
-            g_WindowInfo.width = event.window.data1;
-            g_WindowInfo.height = event.window.data2;
-            gfxOnSizeChanged();
+            result = false;
+            bottom.store(b + 1, std::memory_order_relaxed);
         }
-        else
+        return result;
+    }
+
+    rgBool steal(JobEntry* entry)
+    {
+        i64 t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        i64 b = bottom.load(std::memory_order_acquire);
+        if(t < b)
         {
-            // process event
-            processGameInputs(&event, newAppInput);
+            *entry = entries[t & (kJobDequeCapacity - 1)];
+            return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
         }
+        return false;
     }
-    
-    gfxStartNextFrame();
-    gfxRunOnFrameBeginJob();
-    
-    gfxRendererImGuiNewFrame();
-    ImGui_ImplSDL2_NewFrame();
-    ImGui::NewFrame();
-}
+};
 
-void TheApp::afterUpdateAndDraw()
+struct JobSystem
 {
-    ImGui::Render();
-    gfxRendererImGuiRenderDrawData();
-    gfxEndFrame();
-    
-    *oldAppInput = *newAppInput;
-}
+    u32                 threadCount; // Main thread + worker threads
+    JobDeque*           deques[kJobMaxThreads]; // One per thread, main thread owns deques[0]
+    SDL_Thread*         workerThreads[kJobMaxThreads];
+    SDL_sem*            wakeSemaphore;
+    std::atomic<rgBool> shouldQuit;
 
-void TheApp::endApp()
+    // Jobs submitted from threads which don't own a deque
+    SDL_SpinLock            foreignJobsLock;
+    eastl::vector<JobEntry> foreignJobs;
+};
+
+static JobSystem* jobSystem;
+static thread_local i32 jobThreadIndex = -1;
+static thread_local u32 jobThreadRandomState;
+
+static void jobExecute(JobEntry const& entry)
 {
-    
+    if(entry.job.tag != nullptr)
+    {
+        rgProfileScope(entry.job.tag);
+        entry.job.func(entry.job.data);
+    }
+    else
+    {
+        entry.job.func(entry.job.data);
+    }
+
+    if(entry.counter != nullptr)
+    {
+        SDL_AtomicAdd(&entry.counter->value, -1);
+    }
 }
 
-void TheApp::setTitle(const char *_title)
+static rgBool jobTryExecuteOne()
 {
-}
+    JobEntry entry;
+    i32 threadIndex = jobThreadIndex;
 
-// FILE IO
-// -------
+    if(threadIndex >= 0 && jobSystem->deques[threadIndex]->pop(&entry))
+    {
+        jobExecute(entry);
+        return true;
+    }
 
-FileData fileRead(const char* filepath)
+    // Steal, starting from a random victim to spread the contention
+    u32 x = jobThreadRandomState;
+    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+    jobThreadRandomState = x;
+
+    u32 threadCount = jobSystem->threadCount;
+    for(u32 i = 0; i < threadCount; ++i)
+    {
+        u32 victimIndex = (x + i) % threadCount;
+        if((i32)victimIndex != threadIndex && jobSystem->deques[victimIndex]->steal(&entry))
+        {
+            jobExecute(entry);
+            return true;
+        }
+    }
+
+    rgBool foundForeignJob = false;
+    SDL_AtomicLock(&jobSystem->foreignJobsLock);
+    if(!jobSystem->foreignJobs.empty())
+    {
+        entry = jobSystem->foreignJobs.back();
+        jobSystem->foreignJobs.pop_back();
+        foundForeignJob = true;
+    }
+    SDL_AtomicUnlock(&jobSystem->foreignJobsLock);
+
+    if(foundForeignJob)
+    {
+        jobExecute(entry);
+    }
+    return foundForeignJob;
+}
+
+static int jobWorkerThreadMain(void* data)
 {
-	FileData result = {};
+    jobThreadIndex = (i32)(rgIPtr)data;
+    jobThreadRandomState = 0x9E3779B9u * (u32)(jobThreadIndex + 1);
 
-	SDL_RWops* fp = SDL_RWFromFile(filepath, "rb");
+    rgChar threadName[32];
+    SDL_snprintf(threadName, rgArrayCount(threadName), "Job Worker %d", jobThreadIndex);
+    profilerSetThreadName(threadName);
 
-	if (fp != NULL)
-	{
-		SDL_RWseek(fp, 0, RW_SEEK_END);
-		Sint64 size = (rgSize)SDL_RWtell(fp);
+    while(!jobSystem->shouldQuit.load(std::memory_order_acquire))
+    {
+        if(jobTryExecuteOne())
+        {
+            continue;
+        }
 
-		if (size == -1 || size <= 0)
-		{
-			SDL_RWclose(fp);
-			result.isValid = false;
-			return result;
-		}
-		else
-		{
-			result.dataSize = (rgSize)size;
-		}
+        // Spin a little before going to sleep, jobs tend to come in bursts
+        rgBool foundJob = false;
+        for(u32 i = 0; i < 64 && !foundJob; ++i)
+        {
+            SDL_CPUPauseInstruction();
+            foundJob = jobTryExecuteOne();
+        }
 
-		SDL_RWseek(fp, 0, RW_SEEK_SET);
+        if(!foundJob)
+        {
+            SDL_SemWait(jobSystem->wakeSemaphore);
+        }
+    }
+    return 0;
+}
 
-		result.data = (u8*)rgMalloc(sizeof(u8) * size);
-		if (result.data == NULL)
-		{
-			rgLog("Cannot allocate memory(%dbytes) for reading file %s", size, filepath);
-			SDL_RWclose(fp);
-			result.isValid = false;
-			return result;
-		}
+void jobSystemInit(i32 workerThreadCount)
+{
+    rgAssert(jobSystem == nullptr);
 
-		rgSize sizeRead = SDL_RWread(fp, result.data, sizeof(u8), size);
-		if (sizeRead != size)
-		{
-			result.isValid = false;
-			rgFree(result.data);
-		}
+    if(workerThreadCount < 0)
+    {
+        workerThreadCount = eastl::max(SDL_GetCPUCount() - 1, 1);
+    }
+    workerThreadCount = eastl::min(workerThreadCount, (i32)kJobMaxThreads - 1);
 
-		SDL_RWclose(fp);
+    jobSystem = rgNew(JobSystem);
+    jobSystem->threadCount = (u32)workerThreadCount + 1;
+    for(u32 i = 0; i < jobSystem->threadCount; ++i)
+    {
+        jobSystem->deques[i] = rgNew(JobDeque);
+        jobSystem->deques[i]->top.store(0, std::memory_order_relaxed);
+        jobSystem->deques[i]->bottom.store(0, std::memory_order_relaxed);
+    }
+    jobSystem->wakeSemaphore = SDL_CreateSemaphore(0);
+    jobSystem->shouldQuit.store(false, std::memory_order_relaxed);
+    jobSystem->foreignJobsLock = 0;
 
-		result.isValid = true;
-	}
-	else
-	{
-		rgLog("Cannot open/read file %s", filepath);
-		result.isValid = false;
-	}
+    jobThreadIndex = 0;
+    jobThreadRandomState = 0x9E3779B9u;
 
-	return result;
+    for(i32 i = 0; i < workerThreadCount; ++i)
+    {
+        jobSystem->workerThreads[i] = SDL_CreateThread(jobWorkerThreadMain, "JobWorker", (void*)(rgIPtr)(i + 1));
+        rgAssert(jobSystem->workerThreads[i] != nullptr);
+    }
+
+    rgLog("Job system started with %d worker threads", workerThreadCount);
 }
 
-rgBool fileWrite(char const* filepath, void* bufferPtr, rgSize bufferSizeInBytes)
+void jobSystemShutdown()
 {
-	// Open file for writing
-	SDL_RWops* fp = SDL_RWFromFile(filepath, "wb");
+    if(jobSystem == nullptr)
+    {
+        return;
+    }
 
-	// If file is opened
-	if (fp != 0)
-	{
-		size_t bytesWritten = SDL_RWwrite(fp, bufferPtr, sizeof(u8), bufferSizeInBytes);
-		if (bytesWritten != (size_t)bufferSizeInBytes)
-		{
-			rgLogError("Can't write file %s completely\n", filepath);
-			return false;
-		}
+    u32 workerThreadCount = jobSystem->threadCount - 1;
+    jobSystem->shouldQuit.store(true, std::memory_order_release);
+    for(u32 i = 0; i < workerThreadCount; ++i)
+    {
+        SDL_SemPost(jobSystem->wakeSemaphore);
+    }
+    for(u32 i = 0; i < workerThreadCount; ++i)
+    {
+        SDL_WaitThread(jobSystem->workerThreads[i], nullptr);
+    }
 
-		SDL_RWclose(fp);
-	}
-	// If file can't be opened
-	else
-	{
-		rgLogError("Can't open file %s for writing\n", filepath);
-		return false;
-	}
-	return true;
+    SDL_DestroySemaphore(jobSystem->wakeSemaphore);
+    for(u32 i = 0; i < jobSystem->threadCount; ++i)
+    {
+        rgDelete(jobSystem->deques[i]);
+    }
+    rgDelete(jobSystem);
+    jobSystem = nullptr;
+    jobThreadIndex = -1;
 }
 
-void fileFree(FileData* fd)
+u32 jobGetWorkerThreadCount()
 {
-    rgFree(fd->data);
+    return (jobSystem != nullptr) ? jobSystem->threadCount - 1 : 0;
 }
 
-// UTILS
-// -----
+i32 jobGetCurrentThreadIndex()
+{
+    return jobThreadIndex;
+}
+
+void jobRun(Job const* jobs, u32 jobCount, JobCounter* counter)
+{
+    if(counter != nullptr)
+    {
+        SDL_AtomicAdd(&counter->value, (int)jobCount);
+    }
+
+    // Without the job system, run everything on the calling thread
+    if(jobSystem == nullptr)
+    {
+        for(u32 i = 0; i < jobCount; ++i)
+        {
+            jobExecute({ jobs[i], counter });
+        }
+        return;
+    }
+
+    i32 threadIndex = jobThreadIndex;
+    if(threadIndex >= 0)
+    {
+        for(u32 i = 0; i < jobCount; ++i)
+        {
+            if(!jobSystem->deques[threadIndex]->push({ jobs[i], counter }))
+            {
+                // Deque is full, no point in queueing more work
+                jobExecute({ jobs[i], counter });
+            }
+        }
+    }
+    else
+    {
+        SDL_AtomicLock(&jobSystem->foreignJobsLock);
+        for(u32 i = 0; i < jobCount; ++i)
+        {
+            jobSystem->foreignJobs.push_back({ jobs[i], counter });
+        }
+        SDL_AtomicUnlock(&jobSystem->foreignJobsLock);
+    }
+
+    u32 wakeCount = eastl::min(jobCount, jobSystem->threadCount - 1);
+    for(u32 i = 0; i < wakeCount; ++i)
+    {
+        SDL_SemPost(jobSystem->wakeSemaphore);
+    }
+}
 
-void engineLogfImpl(char const* fmt, ...)
+void jobWaitForCounter(JobCounter* counter)
 {
-    va_list argList;
-    va_start(argList, fmt);
-    SDL_LogMessageV(SDL_LOG_CATEGORY_TEST, SDL_LOG_PRIORITY_DEBUG, fmt, argList);
-    va_end(argList);
+    while(SDL_AtomicGet(&counter->value) > 0)
+    {
+        if(jobSystem == nullptr || !jobTryExecuteOne())
+        {
+            SDL_CPUPauseInstruction();
+        }
+    }
 }
 
-char* getSaveDataPath()
+struct JobParallelForBatch
 {
-    return SDL_GetPrefPath("rg", "gamelib");
+    JobParallelForFunc  func;
+    void*               data;
+    u32                 begin;
+    u32                 end;
+};
+
+void jobParallelFor(u32 count, u32 minBatchSize, JobParallelForFunc func, void* data)
+{
+    minBatchSize = eastl::max(minBatchSize, 1u);
+    if(count <= minBatchSize || jobGetWorkerThreadCount() == 0)
+    {
+        func(0, count, data);
+        return;
+    }
+
+    // A few batches per thread, so that the stealing can balance uneven batches
+    u32 batchCount = (count + minBatchSize - 1) / minBatchSize;
+    batchCount = eastl::min(batchCount, eastl::min(jobSystem->threadCount * 4, kJobMaxParallelForBatches));
+    u32 batchSize = (count + batchCount - 1) / batchCount;
+    batchCount = (count + batchSize - 1) / batchSize;
+
+    JobParallelForBatch batches[kJobMaxParallelForBatches];
+    Job jobs[kJobMaxParallelForBatches];
+    for(u32 i = 0; i < batchCount; ++i)
+    {
+        batches[i] = { func, data, i * batchSize, eastl::min((i + 1) * batchSize, count) };
+        jobs[i].func = [](void* batchData)
+        {
+            JobParallelForBatch* batch = (JobParallelForBatch*)batchData;
+            batch->func(batch->begin, batch->end, batch->data);
+        };
+        jobs[i].data = &batches[i];
+        jobs[i].tag = "parallelFor";
+    }
+
+    JobCounter counter = {};
+    jobRun(jobs, batchCount, &counter);
+    jobWaitForCounter(&counter);
 }
@@ -2,6 +2,9 @@
 #define __CORE_H__
 
 #include <stdint.h>
+#include <atomic>
+#include <new>
+#include <type_traits>
 
 #include <SDL2/SDL.h>
 #include <tiny_imageformat/tinyimageformat.h>
@@ -38,8 +41,6 @@ typedef uint32_t    rgHash;
 
 static_assert(sizeof(rgHash) == sizeof(uint32_t), "sizeof(u32) != sizeof(uint32_t)");
 
-void  engineLogfImpl(char const* fmt, ...);
-
 // MACROS
 // ------
 
@@ -58,16 +59,171 @@ void  engineLogfImpl(char const* fmt, ...);
 
 #define INVALID_DEFAULT_CASE default: rgAssert(!"Not implemented"); break;
 
-#define rgMalloc(s) malloc((s))
-#define rgFree(p) free((p))
-#define rgNew(objectType) new objectType
+// Allocations are tagged with the source file, see MEMORY below
+#define rgMalloc(s) memAlloc((s), kMemoryDefaultAlignment, __FILE__)
+#define rgMallocAligned(s, alignment) memAlloc((s), (alignment), __FILE__)
+#define rgFree(p) memFree((p))
+#define rgNew(objectType) new(MemoryTag{__FILE__}) objectType
 #define rgPlacementNew(objectType, placementAddress) new(placementAddress) objectType
 #define rgDelete(object) delete object
 
-#define rgLog(...) engineLogfImpl(__VA_ARGS__)
+// Logging is asynchronous, see LOGGING below
+#define rgLog(...) rgLogCategory(LogCategory_General, LogLevel_Info, __VA_ARGS__)
+#define rgLogDebug(...) rgLogCategory(LogCategory_General, LogLevel_Debug, __VA_ARGS__)
+#define rgLogWarn(...) rgLogCategory(LogCategory_General, LogLevel_Warn, __VA_ARGS__)
+#define rgLogError(...) rgLogCategory(LogCategory_General, LogLevel_Error, __VA_ARGS__)
+#define rgLogCategory(category, level, ...) do { if(logIsEnabled((category), (level))) { logWrite((category), (level), __VA_ARGS__); } } while(0)
+
+// MEMORY
+// ------
+
+// Comment this out to compile out the per-tag accounting. Alignment is
+// honoured regardless, as every allocation goes through memAlloc()
+#define RG_ENABLE_MEMORY_TRACKING
+
+// NOTE: Tags are stored as pointers, so they must be string literals
+static const rgSize kMemoryDefaultAlignment = 16;
+
+void*   memAlloc(rgSize size, rgSize alignment, char const* tag);
+void*   memAllocOffset(rgSize size, rgSize alignment, rgSize alignmentOffset, char const* tag);
+void    memFree(void* ptr);
+void    memShowImGuiWindow(bool* open);
+void    memReportLeaks();
+
+struct MemoryTag
+{
+    char const* name;
+};
+
+// Tagged global new/delete, the untagged global operators are replaced too
+void*   operator new(size_t size, MemoryTag tag);
+void*   operator new[](size_t size, MemoryTag tag);
+void    operator delete(void* ptr, MemoryTag tag);
+void    operator delete[](void* ptr, MemoryTag tag);
+#if defined(__cpp_aligned_new)
+void*   operator new(size_t size, std::align_val_t alignment, MemoryTag tag);
+void*   operator new[](size_t size, std::align_val_t alignment, MemoryTag tag);
+void    operator delete(void* ptr, std::align_val_t alignment, MemoryTag tag);
+void    operator delete[](void* ptr, std::align_val_t alignment, MemoryTag tag);
+#endif
+
+// LOGGING
+// -------
+
+// The caller only copies the format pointer and the raw arguments into a
+// lock-free ring, a background thread formats them and writes to the sinks
+// (console and a memory mapped log file).
+// NOTE: The format string is stored as a pointer, so it must be a string
+// literal. char* arguments are copied, they can be transient.
+
+enum LogLevel : u8
+{
+    LogLevel_Debug,
+    LogLevel_Info,
+    LogLevel_Warn,
+    LogLevel_Error,
+    LogLevel_Count,
+};
+
+enum LogCategory : u8
+{
+    LogCategory_General,
+    LogCategory_Core,
+    LogCategory_Gfx,
+    LogCategory_Asset,
+    LogCategory_Physics,
+    LogCategory_Game,
+    LogCategory_Count,
+};
+
+void        logInit(char const* logFilepath); // logFilepath can be nullptr, logs before logInit() are written synchronously
+void        logShutdown(); // Writes out everything pending
+void        logFlush(); // Blocks until everything logged so far is written
+void        logSetCategoryLevel(LogCategory category, LogLevel minLevel);
+u32         logGetDroppedCount(); // Messages dropped because the ring was full
 
-#define rgLogWarn(...) SDL_LogWarn(SDL_LOG_CATEGORY_TEST, __VA_ARGS__)
-#define rgLogError(...) SDL_LogError(SDL_LOG_CATEGORY_TEST, __VA_ARGS__)
+// Written only from the main thread, read racily by the callers
+extern LogLevel g_LogCategoryLevels[LogCategory_Count];
+
+RG_INLINE rgBool logIsEnabled(LogCategory category, LogLevel level)
+{
+    return level >= g_LogCategoryLevels[category];
+}
+
+enum LogArgType : u8
+{
+    LogArgType_Int,
+    LogArgType_UInt,
+    LogArgType_Float,
+    LogArgType_Pointer,
+    LogArgType_String,
+};
+
+static const u32 kLogMaxRecordSize = 4096; // Longer string arguments are truncated
+
+struct LogRecordHeader
+{
+    char const* fmt;
+    u64         timestamp;
+    u64         threadId;
+    u16         size; // Including the header
+    LogCategory category;
+    LogLevel    level;
+    u8          argCount;
+};
+
+struct LogRecordWriter
+{
+    u8*         record;
+    u8*         cursor;
+    u8          argCount;
+};
+
+void    logWriteValueArg(LogRecordWriter* writer, LogArgType type, u8 size, u64 value);
+void    logWriteStringArg(LogRecordWriter* writer, char const* str);
+void    logSubmitRecord(LogRecordWriter* writer, LogCategory category, LogLevel level, char const* fmt);
+
+template<typename T>
+RG_INLINE void logWriteArg(LogRecordWriter* writer, T arg)
+{
+    if constexpr(std::is_same<T, char*>::value || std::is_same<T, char const*>::value)
+    {
+        logWriteStringArg(writer, arg);
+    }
+    else if constexpr(std::is_floating_point<T>::value)
+    {
+        f64 value = (f64)arg;
+        u64 bits;
+        SDL_memcpy(&bits, &value, sizeof(bits));
+        logWriteValueArg(writer, LogArgType_Float, sizeof(f64), bits);
+    }
+    else if constexpr(std::is_integral<T>::value || std::is_enum<T>::value)
+    {
+        LogArgType type = std::is_signed<T>::value ? LogArgType_Int : LogArgType_UInt;
+        logWriteValueArg(writer, type, sizeof(T), (u64)(i64)arg);
+    }
+    else if constexpr(std::is_pointer<T>::value)
+    {
+        logWriteValueArg(writer, LogArgType_Pointer, sizeof(void*), (u64)(rgUPtr)arg);
+    }
+    else if constexpr(std::is_null_pointer<T>::value)
+    {
+        logWriteValueArg(writer, LogArgType_Pointer, sizeof(void*), 0);
+    }
+    else
+    {
+        static_assert(sizeof(T) == 0, "Unsupported log argument type, only printf compatible types can be logged");
+    }
+}
+
+template<typename... Args>
+void logWrite(LogCategory category, LogLevel level, char const* fmt, Args... args)
+{
+    u8 record[kLogMaxRecordSize];
+    LogRecordWriter writer = { record, record + sizeof(LogRecordHeader), 0 };
+    (logWriteArg(&writer, args), ...);
+    logSubmitRecord(&writer, category, level, fmt);
+}
 
 #define RG_DEFINE_ENUM_FLAGS_OPERATOR(T) \
 inline T operator~ (T a) { return static_cast<T>( ~static_cast<std::underlying_type<T>::type>(a) ); } \
@@ -79,6 +235,93 @@ inline T& operator&= (T& a, T b) { return reinterpret_cast<T&>( reinterpret_cast
 inline T& operator^= (T& a, T b) { return reinterpret_cast<T&>( reinterpret_cast<std::underlying_type<T>::type&>(a) ^= static_cast<std::underlying_type<T>::type>(b) ); }
 
 
+// SIMD
+// ----
+// Thin 4-wide float wrapper, SSE2 is the x64 baseline and NEON the arm64 one.
+// The build doesn't enable AVX, so there is no 8-wide path.
+// Batch kernels that use it are in rg_math.h
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define RG_SIMD_SSE2 1
+    #include <emmintrin.h>
+    typedef __m128 rgSimd4;
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+    #define RG_SIMD_NEON 1
+    #include <arm_neon.h>
+    typedef float32x4_t rgSimd4;
+#else
+    #define RG_SIMD_SCALAR 1
+    struct rgSimd4 { f32 v[4]; };
+#endif
+
+#if defined(RG_SIMD_SSE2)
+RG_INLINE rgSimd4 simdLoad(f32 const* p) { return _mm_loadu_ps(p); }
+RG_INLINE void    simdStore(f32* p, rgSimd4 a) { _mm_storeu_ps(p, a); }
+RG_INLINE rgSimd4 simdSet1(f32 a) { return _mm_set1_ps(a); }
+RG_INLINE rgSimd4 simdSet(f32 x, f32 y, f32 z, f32 w) { return _mm_setr_ps(x, y, z, w); }
+RG_INLINE rgSimd4 simdAdd(rgSimd4 a, rgSimd4 b) { return _mm_add_ps(a, b); }
+RG_INLINE rgSimd4 simdSub(rgSimd4 a, rgSimd4 b) { return _mm_sub_ps(a, b); }
+RG_INLINE rgSimd4 simdMul(rgSimd4 a, rgSimd4 b) { return _mm_mul_ps(a, b); }
+RG_INLINE rgSimd4 simdDiv(rgSimd4 a, rgSimd4 b) { return _mm_div_ps(a, b); }
+RG_INLINE rgSimd4 simdMin(rgSimd4 a, rgSimd4 b) { return _mm_min_ps(a, b); }
+RG_INLINE rgSimd4 simdMax(rgSimd4 a, rgSimd4 b) { return _mm_max_ps(a, b); }
+RG_INLINE rgSimd4 simdNeg(rgSimd4 a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+RG_INLINE rgSimd4 simdAbs(rgSimd4 a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+RG_INLINE rgSimd4 simdCmpGt(rgSimd4 a, rgSimd4 b) { return _mm_cmpgt_ps(a, b); }
+// mask ? a : b, mask lanes must be all ones or all zeros
+RG_INLINE rgSimd4 simdSelect(rgSimd4 mask, rgSimd4 a, rgSimd4 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+// Only valid for |a| < 2^31
+RG_INLINE rgSimd4 simdFloor(rgSimd4 a)
+{
+    rgSimd4 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a));
+    return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a), _mm_set1_ps(1.0f)));
+}
+#elif defined(RG_SIMD_NEON)
+RG_INLINE rgSimd4 simdLoad(f32 const* p) { return vld1q_f32(p); }
+RG_INLINE void    simdStore(f32* p, rgSimd4 a) { vst1q_f32(p, a); }
+RG_INLINE rgSimd4 simdSet1(f32 a) { return vdupq_n_f32(a); }
+RG_INLINE rgSimd4 simdSet(f32 x, f32 y, f32 z, f32 w) { f32 v[4] = {x, y, z, w}; return vld1q_f32(v); }
+RG_INLINE rgSimd4 simdAdd(rgSimd4 a, rgSimd4 b) { return vaddq_f32(a, b); }
+RG_INLINE rgSimd4 simdSub(rgSimd4 a, rgSimd4 b) { return vsubq_f32(a, b); }
+RG_INLINE rgSimd4 simdMul(rgSimd4 a, rgSimd4 b) { return vmulq_f32(a, b); }
+RG_INLINE rgSimd4 simdDiv(rgSimd4 a, rgSimd4 b) { return vdivq_f32(a, b); }
+RG_INLINE rgSimd4 simdMin(rgSimd4 a, rgSimd4 b) { return vminq_f32(a, b); }
+RG_INLINE rgSimd4 simdMax(rgSimd4 a, rgSimd4 b) { return vmaxq_f32(a, b); }
+RG_INLINE rgSimd4 simdNeg(rgSimd4 a) { return vnegq_f32(a); }
+RG_INLINE rgSimd4 simdAbs(rgSimd4 a) { return vabsq_f32(a); }
+RG_INLINE rgSimd4 simdCmpGt(rgSimd4 a, rgSimd4 b) { return vreinterpretq_f32_u32(vcgtq_f32(a, b)); }
+RG_INLINE rgSimd4 simdSelect(rgSimd4 mask, rgSimd4 a, rgSimd4 b) { return vbslq_f32(vreinterpretq_u32_f32(mask), a, b); }
+RG_INLINE rgSimd4 simdFloor(rgSimd4 a) { return vrndmq_f32(a); }
+#else
+RG_INLINE rgSimd4 simdLoad(f32 const* p) { return rgSimd4{{p[0], p[1], p[2], p[3]}}; }
+RG_INLINE void    simdStore(f32* p, rgSimd4 a) { p[0] = a.v[0]; p[1] = a.v[1]; p[2] = a.v[2]; p[3] = a.v[3]; }
+RG_INLINE rgSimd4 simdSet1(f32 a) { return rgSimd4{{a, a, a, a}}; }
+RG_INLINE rgSimd4 simdSet(f32 x, f32 y, f32 z, f32 w) { return rgSimd4{{x, y, z, w}}; }
+#define RG_SIMD_SCALAR_OP(name, expr) \
+RG_INLINE rgSimd4 name(rgSimd4 a, rgSimd4 b) { rgSimd4 r; for(i32 i = 0; i < 4; ++i) { f32 x = a.v[i], y = b.v[i]; r.v[i] = (expr); } return r; }
+RG_SIMD_SCALAR_OP(simdAdd, x + y)
+RG_SIMD_SCALAR_OP(simdSub, x - y)
+RG_SIMD_SCALAR_OP(simdMul, x * y)
+RG_SIMD_SCALAR_OP(simdDiv, x / y)
+RG_SIMD_SCALAR_OP(simdMin, x < y ? x : y)
+RG_SIMD_SCALAR_OP(simdMax, x > y ? x : y)
+#undef RG_SIMD_SCALAR_OP
+RG_INLINE rgSimd4 simdNeg(rgSimd4 a) { return rgSimd4{{-a.v[0], -a.v[1], -a.v[2], -a.v[3]}}; }
+RG_INLINE rgSimd4 simdAbs(rgSimd4 a) { return rgSimd4{{fabsf(a.v[0]), fabsf(a.v[1]), fabsf(a.v[2]), fabsf(a.v[3])}}; }
+RG_INLINE rgSimd4 simdFloor(rgSimd4 a) { return rgSimd4{{floorf(a.v[0]), floorf(a.v[1]), floorf(a.v[2]), floorf(a.v[3])}}; }
+// Masks are stored as 0.0 or 1.0 in the scalar fallback
+RG_INLINE rgSimd4 simdCmpGt(rgSimd4 a, rgSimd4 b) { rgSimd4 r; for(i32 i = 0; i < 4; ++i) { r.v[i] = a.v[i] > b.v[i] ? 1.0f : 0.0f; } return r; }
+RG_INLINE rgSimd4 simdSelect(rgSimd4 mask, rgSimd4 a, rgSimd4 b) { rgSimd4 r; for(i32 i = 0; i < 4; ++i) { r.v[i] = mask.v[i] != 0.0f ? a.v[i] : b.v[i]; } return r; }
+#endif
+
+// a * b + c
+RG_INLINE rgSimd4 simdMadd(rgSimd4 a, rgSimd4 b, rgSimd4 c) { return simdAdd(simdMul(a, b), c); }
+
+// VECTOR TYPES
+// ------------
+// rgFloat2 and rgFloat3 keep their packed layout as they are used in vertex
+// and particle arrays, use the batch kernels in rg_math.h for hot loops.
+
 union rgFloat2
 {
     f32 v[2];
@@ -187,6 +430,68 @@ union rgFloat4
     };
 };
 
+RG_INLINE rgSimd4 simdLoad(rgFloat4 const& a) { return simdLoad(a.v); }
+
+RG_INLINE rgFloat4 simdStoreFloat4(rgSimd4 a)
+{
+    rgFloat4 r;
+    simdStore(r.v, a);
+    return r;
+}
+
+RG_INLINE rgFloat4 operator+(rgFloat4 const& a, rgFloat4 const& b)
+{
+    return simdStoreFloat4(simdAdd(simdLoad(a), simdLoad(b)));
+}
+
+RG_INLINE rgFloat4 operator-(rgFloat4 const& a, rgFloat4 const& b)
+{
+    return simdStoreFloat4(simdSub(simdLoad(a), simdLoad(b)));
+}
+
+RG_INLINE rgFloat4 operator*(rgFloat4 const& a, rgFloat4 const& b)
+{
+    return simdStoreFloat4(simdMul(simdLoad(a), simdLoad(b)));
+}
+
+RG_INLINE rgFloat4 operator/(rgFloat4 const& a, rgFloat4 const& b)
+{
+    return simdStoreFloat4(simdDiv(simdLoad(a), simdLoad(b)));
+}
+
+RG_INLINE rgFloat4 operator*(rgFloat4 const& a, f32 b)
+{
+    return simdStoreFloat4(simdMul(simdLoad(a), simdSet1(b)));
+}
+
+RG_INLINE rgFloat4 operator/(rgFloat4 const& a, f32 b)
+{
+    return simdStoreFloat4(simdDiv(simdLoad(a), simdSet1(b)));
+}
+
+RG_INLINE rgFloat4& operator+=(rgFloat4& a, rgFloat4 const& b)
+{
+    a = a + b;
+    return a;
+}
+
+RG_INLINE rgFloat4& operator-=(rgFloat4& a, rgFloat4 const& b)
+{
+    a = a - b;
+    return a;
+}
+
+RG_INLINE rgFloat4& operator*=(rgFloat4& a, rgFloat4 const& b)
+{
+    a = a * b;
+    return a;
+}
+
+RG_INLINE rgFloat4 operator-(rgFloat4 const& a)
+{
+    return simdStoreFloat4(simdNeg(simdLoad(a)));
+}
+
 union rgFloat3
 {
     f32 v[3];
@@ -209,11 +514,17 @@ RG_INLINE rgFloat3 operator+(const rgFloat3& a, const rgFloat3& b)
     return rgFloat3{a.x + b.x, a.y + b.y, a.z + b.z};
 }
 
-RG_INLINE rgFloat3 operator-(rgFloat3& a, rgFloat3& b)
+RG_INLINE rgFloat3 operator-(rgFloat3 const& a, rgFloat3 const& b)
 {
     return rgFloat3{ a.x - b.x, a.y - b.y, a.z - b.z };
 }
 
+RG_INLINE rgFloat3& operator-=(rgFloat3& a, rgFloat3 const& b)
+{
+    a = a - b;
+    return a;
+}
+
 RG_INLINE rgFloat3& operator+=(rgFloat3& a, const rgFloat3& b)
 {
     a = a + b;
@@ -288,10 +599,31 @@ struct AppInput
 
     double deltaTime;
     double time;
+
+    // Fixed-step simulation of this frame, see TheApp::fixedUpdate()
+    double fixedDeltaTime;
+    double interpolationAlpha; // [0, 1) between the previous and the last tick, to interpolate the rendered state
+    u32    fixedStepCount;     // fixedUpdate() calls this frame
 };
 
 extern AppInput* theAppInput;
 
+// TIMEDEMO
+// --------
+
+// Record the input of every frame, then replay it to compare builds:
+//   --timedemo-record <file>   Records AppInput and deltaTime of every frame, written at exit
+//   --timedemo-play <file>     Replays the recorded input, then logs the CPU frame time
+//                              percentiles and writes a per-frame CSV
+//   --timedemo-frames <N>      Stops the replay after N frames, default is all the recorded frames
+//   --timedemo-warmup <N>      Leaves the first N frames out of the statistics
+//   --timedemo-dt <seconds>    Replays with a fixed timestep instead of the recorded one
+//   --timedemo-csv <file>      Default is timedemo.csv
+// Combine with the null renderer (RG_NULL_RNDR) for headless runs, and with
+// --pipelined to compare the pipelined mode against the single threaded one.
+
+rgBool      timedemoIsReplaying();
+
 
 // FILE IO
 // -------
@@ -307,11 +639,159 @@ FileData    fileRead(const char* filepath);
 rgBool      fileWrite(char const* filepath, void* bufferPtr, rgSize bufferSizeInBytes);
 void        fileFree(FileData* fd);
 
+// Read-only view of a file, prefer this over fileRead() when the data
+// is only read, as the OS pages it in without an intermediate copy
+enum FileMapAccess : u8
+{
+    FileMapAccess_Sequential,   // Read once front to back, read-ahead aggressively
+    FileMapAccess_Random,       // Accessed in no particular order, don't read-ahead
+};
+
+struct FileMapping
+{
+    rgBool      isValid;
+    rgBool      isMapped; // false if the file had to be read in memory instead
+    rgBool      isInPack; // Points into a mounted pack, there is nothing to release
+    u8 const*   data;
+    rgSize      dataSize;
+#if defined(_WIN32)
+    void*       fileHandle;
+    void*       mappingHandle;
+#endif
+};
+
+FileMapping fileMap(char const* filepath, FileMapAccess access = FileMapAccess_Sequential);
+void        fileUnmap(FileMapping* fm);
+
+// VFS
+// ---
+
+// fileRead() and fileMap() look in the mounted packs first, then on disk.
+// Packs are built with `assetgen --pack <dir> <output>`, paths are relative to <dir>.
+rgBool      vfsMountPack(char const* packFilepath);
+void        vfsUnmountAll();
+
+// LINEAR ALLOCATOR
+// ----------------
+
+// Thread-safe bump allocator, individual allocations can't be freed, reset()
+// frees everything at once. Allocations which don't fit go to overflow blocks
+// on the heap, and the next reset() grows the capacity to fit them.
+class LinearAllocator
+{
+public:
+    LinearAllocator(char const* name, rgSize capacity);
+    ~LinearAllocator();
+
+    void*       allocate(rgSize size, rgSize alignment = 16);
+    void        reset();
+
+    char const* getName() const { return name; }
+    rgSize      getCapacity() const { return capacity; }
+    rgSize      getUsedSize() const { return offset + overflowSize; }
+    u32         getResetCount() const { return resetCount; } // Frame number of the arena, bumped by reset()
+
+protected:
+    struct OverflowBlock
+    {
+        OverflowBlock* next;
+    };
+
+    char const*     name;
+    u8*             memory;
+    rgSize          capacity;
+    rgSize          offset;
+    rgSize          overflowSize; // Bytes allocated in overflow blocks since the last reset()
+    OverflowBlock*  overflowBlocks;
+    u32             resetCount;
+    SDL_SpinLock    lock;
+};
+
 // UTILS
 // -----
 
 char*       getSaveDataPath();
 
+// PROFILER
+// --------
+
+// Comment this out to compile out all the profile zones
+#define RG_ENABLE_PROFILER
+
+// NOTE: Zone names are stored as pointers, so they must be string literals
+// or strings which outlive the profiler capture (e.g. GfxObject tags)
+
+#if defined(RG_ENABLE_PROFILER)
+void    profilerBeginZone(char const* name);
+void    profilerEndZone();
+
+struct ProfilerScopedZone
+{
+    ProfilerScopedZone(char const* name) { profilerBeginZone(name); }
+    ~ProfilerScopedZone() { profilerEndZone(); }
+};
+
+#define RG_PROFILER_CONCAT_IMPL(a, b) a##b
+#define RG_PROFILER_CONCAT(a, b) RG_PROFILER_CONCAT_IMPL(a, b)
+
+#define rgProfileScope(name) ProfilerScopedZone RG_PROFILER_CONCAT(profilerScopedZone, __LINE__)(name)
+#define rgProfileFunction() rgProfileScope(__FUNCTION__)
+#define rgProfileBegin(name) profilerBeginZone(name)
+#define rgProfileEnd() profilerEndZone()
+#else
+#define rgProfileScope(name)
+#define rgProfileFunction()
+#define rgProfileBegin(name)
+#define rgProfileEnd()
+#endif
+
+void        profilerSetThreadName(char const* name);
+void        profilerBeginFrame(); // Call once per frame from the main thread
+void        profilerShowImGuiWindow(bool* open);
+rgBool      profilerDumpChromeTrace(char const* filepath);
+
+// JOB SYSTEM
+// ----------
+
+// Jobs are pushed on the calling thread's work-stealing deque, idle worker
+// threads steal from the other deques. A job must not block on anything
+// except jobWaitForCounter(), which keeps executing jobs while it waits.
+
+typedef void (*JobFunc)(void* data);
+
+struct JobCounter
+{
+    SDL_atomic_t value; // Number of jobs yet to finish
+};
+
+struct Job
+{
+    JobFunc     func;
+    void*       data;
+    char const* tag; // Profile zone name, can be nullptr
+};
+
+void        jobSystemInit(i32 workerThreadCount = -1); // -1 spawns a worker per core except one
+void        jobSystemShutdown();
+u32         jobGetWorkerThreadCount();
+i32         jobGetCurrentThreadIndex(); // 0 is the main thread, -1 if called from an unknown thread
+
+void        jobRun(Job const* jobs, u32 jobCount, JobCounter* counter); // counter can be nullptr
+void        jobWaitForCounter(JobCounter* counter);
+
+typedef void (*JobParallelForFunc)(u32 begin, u32 end, void* data);
+// Splits [0, count) in batches of at least minBatchSize and waits for all of them to finish
+void        jobParallelFor(u32 count, u32 minBatchSize, JobParallelForFunc func, void* data);
+
+template<typename F>
+void jobParallelFor(u32 count, u32 minBatchSize, F const& func)
+{
+    jobParallelFor(count, minBatchSize, [](u32 begin, u32 end, void* data)
+    {
+        (*(F const*)data)(begin, end);
+    }, (void*)&func);
+}
+
 
 //
 // ---
@@ -329,16 +809,31 @@ extern u32 g_FrameNumber; // Frame number since app started
 struct PhysicSystem;
 extern PhysicSystem* g_PhysicSystem;
 
-extern rgBool g_ShouldAppQuit;
+extern std::atomic<rgBool> g_ShouldAppQuit; // The render thread sets it too in the pipelined mode
 extern SDL_Window* g_AppMainWindow;
 
 // APP
 // ---
 
+struct ImDrawData;
+
+// Hands a frame from update() to render() in the pipelined mode
+struct AppFramePacket
+{
+    AppInput            input;          // The frame's input, render() must use this instead of theAppInput
+    LinearAllocator*    arena;          // Reset when the packet is reused, it's also the frame arena on the update thread
+    void*               userData;       // Set by update(), usually allocated from arena
+    ImDrawData*         imguiDrawData;  // Copy of the frame's ImGui draw data
+    u32                 frameNumber;
+    rgBool              isQuit;         // Sent after the last frame, not rendered
+};
+
 class TheApp
 {
 public:
+    void parseCommandLine(int argc, char* argv[]);
     int  beginApp();
+    void run(); // Runs the frame loop till g_ShouldAppQuit is set
     void beforeUpdateAndDraw();
     void afterUpdateAndDraw();
     void endApp();
@@ -347,6 +842,21 @@ public:
     virtual void onCreateApp() {}
     virtual void setup() {}
     virtual void updateAndDraw() {}
+    virtual void shutdown() {} // Release what setup() made, called before the gfx teardown
+
+    // Pipelined mode, opt-in by setting pipelined = true in onCreateApp() or with --pipelined.
+    // update() of frame N+1 runs on the main thread while render() of frame N
+    // runs on the render thread. update() handles input, simulation and ImGui,
+    // it must not call the gfx API, everything render() needs goes in the
+    // packet. render() records the passes, it must not touch the game state.
+    virtual void update(AppFramePacket* packet) {}
+    virtual void render(AppFramePacket const* packet) {}
+
+    // Called fixedTickRate times per second of game time, before
+    // updateAndDraw() or update(), so the simulation cost doesn't depend on
+    // the frame rate. Long frames run at most maxFixedStepsPerFrame ticks, the
+    // rest of the time is dropped and the game slows down instead of spiraling.
+    virtual void fixedUpdate(f64 fixedDeltaTime) {}
     
 protected:
     void setTitle(const char * _title);
@@ -355,19 +865,30 @@ protected:
     bool fullscreen = false;
     char title[64] = "SdlApp";
     bool vsync = true;
+    bool pipelined = false;
+    f64  fixedTickRate = 60.0; // 0 disables fixedUpdate()
+    u32  maxFixedStepsPerFrame = 4;
     
     AppInput inputs[2];
 
     Uint64 currentPerfCounter;
     Uint64 previousPerfCounter;
+    f64    fixedTimeAccumulator = 0.0;
+
+private:
+    void processInput();
+    void runFixedUpdates();
+    void runPipelined();
+    friend int appRenderThreadMain(void* data);
 };
 
+// The app is on the stack, so it isn't reported by memReportLeaks() in endApp()
 #define THE_APP_MAIN(x) int main(int argc, char *argv[]) {          \
-    TheApp *app = new x();                                          \
-    app->onCreateApp(); app->beginApp(); app->setup();              \
-    while(!g_ShouldAppQuit)                                         \
-    { app->beforeUpdateAndDraw(); app->updateAndDraw(); app->afterUpdateAndDraw(); }  \
-    app->endApp();              \
-    delete app; return 0; }
+    x appInstance; TheApp *app = &appInstance;                      \
+    app->onCreateApp(); app->parseCommandLine(argc, argv);          \
+    app->beginApp(); app->setup();                                  \
+    app->run();                                                     \
+    app->endApp();                                                  \
+    return 0; }
 
 #endif // __CORE_H__
@@ -4,10 +4,8 @@
 
 struct GameState
 {
-    TexturedQuads characterPortraits;
-    TexturedQuads terrainAndOcean;
     GfxTexture* oceanTileTexture;
-    GfxTexture* flowerTexture;
+    TextureRef  flowerTexture;
 
     ModelRef shaderballModel;
     
@@ -20,10 +18,6 @@ struct GameState
     f32 tonemapperExposureKey;
     
     rgBool  debugShowGrid;
-    
-    GfxTexture* baseColor2DRT;
-    GfxTexture* baseColorRT;
-    GfxTexture* depthStencilRT;
 
     b2World* phyWorld;
 };
@@ -17,6 +17,8 @@ struct Smygel : TheApp
     GfxTexture *flower, *ocean, *arrow;
     GfxGraphicsPSO *texturedQuadPSO;
     
+    TexturedQuadGrid* worldGround;
+    
     Smygel()
     : depthStencilFormat(TinyImageFormat_D32_SFLOAT_S8_UINT)
     {
@@ -90,6 +92,18 @@ struct Smygel : TheApp
         testFont = loadFont("fonts/inconsolata_26.fnt");
         
         viewport = rgNew(Viewport);
+        
+        // The ground doesn't move, only the cells in view get pushed each frame
+        worldGround = rgNew(TexturedQuadGrid)(4.0f);
+        for(i32 x = -8; x < 8; ++x)
+        {
+            worldGround->add(defaultQuadUV, { (f32)x, 0, 1.0f, 1.0f }, 0x00FF00FF, { 0, 0, 0, 1 }, flower);
+        }
+    }
+    
+    void shutdown() override
+    {
+        rgDelete(worldGround);
     }
     
     void updateAndDraw() override
@@ -102,9 +116,9 @@ struct Smygel : TheApp
         GfxFrameResource cameraParamsBuffer = gfxGetFrameAllocator()->newBuffer("cameraParams", sizeof(CameraParamsGPU), cameraParams);
 
         TexturedQuads testQuads;
-        pushTexturedQuad(&testQuads, SpriteLayer_1, defaultQuadUV, {100.0f, 75.0f, 200.f, 200.f}, 0xFFFFFFFF, {0, 0, 0, 0}, flower);
-        pushTexturedQuad(&testQuads, SpriteLayer_0, defaultQuadUV, {110.0f, 85.0f, 200.f, 200.f}, 0xFF0000FF, {0, 0, 0, 0}, flower);
-        pushTexturedQuad(&testQuads, SpriteLayer_0, defaultQuadUV, {120.0f, 95.0f, 200.f, 200.f}, 0x00FF00FF, {0, 0, 0, 0}, flower);
+        pushTexturedQuad(&testQuads, SpriteLayer_1, defaultQuadUV, {100.0f, 75.0f, 200.f, 200.f}, 0xFFFFFFFF, {0, 0, 0, 1}, flower);
+        pushTexturedQuad(&testQuads, SpriteLayer_0, defaultQuadUV, {110.0f, 85.0f, 200.f, 200.f}, 0xFF0000FF, {0, 0, 0, 1}, flower);
+        pushTexturedQuad(&testQuads, SpriteLayer_0, defaultQuadUV, {120.0f, 95.0f, 200.f, 200.f}, 0x00FF00FF, {0, 0, 0, 1}, flower);
         
         char const* splashIntroText = "It is not our part to master all the tides of the world,\nbut to do what is in us for the succour of those years wherein we are set,\nuprooting the evil in the fields that we know,\nso that those who live after may have clean earth to till.\nWhat weather they shall have is not ours to rule.";
         
@@ -118,13 +132,13 @@ struct Smygel : TheApp
         TexturedQuads worldTexturedQuads;
         static f32 ang;
         ang += (float)theAppInput->deltaTime;
-        pushTexturedQuad(&worldTexturedQuads, SpriteLayer_0, defaultQuadUV, {5.0f, 5.0f, 1.0f, 1.0f}, 0xFFFFFFFF, {0, 0, 0, 0}, ocean);
-        pushTexturedQuad(&worldTexturedQuads, SpriteLayer_0, defaultQuadUV, {5.0f, 5.0f, -1.0f, 1.0f}, 0xFFFFFFFF, {0, 0, 0, 0}, ocean);
-        pushTexturedQuad(&worldTexturedQuads, SpriteLayer_0, defaultQuadUV, {5.0f, 5.0f, -1.0f, -1.0f}, 0xFFFFFFFF, {0, 0, 0, 0}, ocean);
-        pushTexturedQuad(&worldTexturedQuads, SpriteLayer_0, defaultQuadUV, {7.0f, 5.0f, 1.0f, 1.0f}, 0x00FF00FF, {0, 0, ang, 0}, ocean);
-        pushTexturedQuad(&worldTexturedQuads, SpriteLayer_0, defaultQuadUV, {9.0f, 5.0f, 1.0f, 1.0f}, 0xFF0000FF, {0.5f, 0.5f, ang, 0}, ocean);
+        pushTexturedQuad(&worldTexturedQuads, SpriteLayer_0, defaultQuadUV, {5.0f, 5.0f, 1.0f, 1.0f}, 0xFFFFFFFF, {0, 0, 0, 1}, ocean);
+        pushTexturedQuad(&worldTexturedQuads, SpriteLayer_0, defaultQuadUV, {5.0f, 5.0f, -1.0f, 1.0f}, 0xFFFFFFFF, {0, 0, 0, 1}, ocean);
+        pushTexturedQuad(&worldTexturedQuads, SpriteLayer_0, defaultQuadUV, {5.0f, 5.0f, -1.0f, -1.0f}, 0xFFFFFFFF, {0, 0, 0, 1}, ocean);
+        pushTexturedQuad(&worldTexturedQuads, SpriteLayer_0, defaultQuadUV, {7.0f, 5.0f, 1.0f, 1.0f}, 0x00FF00FF, {0, 0, ang, 1}, ocean);
+        pushTexturedQuad(&worldTexturedQuads, SpriteLayer_0, defaultQuadUV, {9.0f, 5.0f, 1.0f, 1.0f}, 0xFF0000FF, {0.5f, 0.5f, ang, 1}, ocean);
         
-        pushTexturedQuad(&worldTexturedQuads, SpriteLayer_0, defaultQuadUV, {9.0f, 5.0f, 1.0f, 1.0f}, 0xFF0000FF, {-0.5f, -0.5f, ang, 0}, ocean);
+        pushTexturedQuad(&worldTexturedQuads, SpriteLayer_0, defaultQuadUV, {9.0f, 5.0f, 1.0f, 1.0f}, 0xFF0000FF, {-0.5f, -0.5f, ang, 1}, ocean);
         
         {
             f32 s = sinf(ang);
@@ -141,10 +155,7 @@ struct Smygel : TheApp
             pushTexturedLine(&testQuads, SpriteLayer_1, repeatQuadUV({repeatU, 1.0f}), p, m, 16.0f, 0x331de2ff, arrow);
         }
 
-        for(i32 x = -8; x < 8; ++x)
-        {
-            pushTexturedQuad(&worldTexturedQuads, SpriteLayer_0, defaultQuadUV, { (f32)x, 0, 1.0f, 1.0f }, 0x00FF00FF, { 0, 0, 0, 0 }, flower);
-        }
+        worldGround->pushVisibleQuads(&worldTexturedQuads, SpriteLayer_0, &worldViewMatrix, &worldProjMatrix);
 
         //
         GfxRenderPass simple2dRenderPass = {};
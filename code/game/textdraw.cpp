@@ -3,7 +3,7 @@
 
 FontRef loadFont(char const* fontFilename)
 {
-    FileData xmlFile = fileRead(fontFilename);
+    FileMapping xmlFile = fileMap(fontFilename);
     rgAssert(xmlFile.isValid);
     
     pugi::xml_document xmlDoc;
@@ -66,7 +66,7 @@ FontRef loadFont(char const* fontFilename)
         charNode = charNode.next_sibling();
     }
 
-    fileFree(&xmlFile);
+    fileUnmap(&xmlFile);
     
     return fontRef;
 }
@@ -94,7 +94,7 @@ void pushText(TexturedQuads* quadList, u32 x, u32 y, FontRef font, float fontSiz
         
         Glyph& g = font->glyphs[*t];
         
-        pushTexturedQuad(quadList, SpriteLayer_0, g.uv, {cursorPos.x + g.xOffset, cursorPos.y + g.yOffset, (float)g.width, (float)g.height}, 0xffffffff, {0, 0, 0, 0}, font->texture);
+        pushTexturedQuad(quadList, SpriteLayer_0, g.uv, {cursorPos.x + g.xOffset, cursorPos.y + g.yOffset, (float)g.width, (float)g.height}, 0xffffffff, {0, 0, 0, 1}, font->texture);
         
         ++t;
         cursorPos.x = cursorPos.x + g.xAdvance;
@@ -1,6 +1,8 @@
 //#include <mmgr/mmgr.cpp>
 #include "gfx.h"
 #include <utils.h>
+#include "rg_math.h"
+#include "pack.h"
 
 #include <string.h>
 #include <EASTL/string.h>
@@ -14,6 +16,7 @@
 #include "DirectXTex.h"
 
 i32   g_FrameIndex;
+GfxFrameStats g_FrameStats;
 GfxBindlessResourceManager<GfxTexture>* g_BindlessTextureManager;
 QuadUV  defaultQuadUV = { 0.0f, 0.0f, 1.0f, 1.0f };
 
@@ -30,6 +33,7 @@ GfxSamplerState*    GfxState::samplerTrilinearRepeatAniso;
 GfxSamplerState*    GfxState::samplerTrilinearClampEdgeAniso;
 GfxSamplerState*    GfxState::samplerNearestRepeat;
 GfxSamplerState*    GfxState::samplerNearestClampEdge;
+GfxBuffer*          GfxState::quadIndexBuffer;
 
 
 //-----------------------------------------------------------------------------
@@ -37,10 +41,27 @@ GfxSamplerState*    GfxState::samplerNearestClampEdge;
 //-----------------------------------------------------------------------------
 
 static GfxFrameAllocator*       frameAllocators[RG_MAX_FRAMES_IN_FLIGHT];
+static GfxFrameAllocator*       ringAllocator;
+static LinearAllocator*         frameArenas[RG_MAX_FRAMES_IN_FLIGHT];
 static GfxRenderPass*           currentRenderPass;
 static GfxRenderCmdEncoder*     currentRenderCmdEncoder;
 static GfxComputeCmdEncoder*    currentComputeCmdEncoder;
 static GfxBlitCmdEncoder*       currentBlitCmdEncoder;
+static thread_local LinearAllocator* threadFrameArena;
+static GfxFrameStats            lastFrameStats;
+
+// Cmd encoders live for a single pass, so they are allocated from the frame arena
+template<typename T>
+static T* newCmdEncoder()
+{
+    return rgPlacementNew(T, gfxGetFrameArena()->allocate(sizeof(T), alignof(T)));
+}
+
+template<typename T>
+static void deleteCmdEncoder(T* encoder)
+{
+    encoder->~T();
+}
 
 static void styleImGui()
 {
@@ -107,6 +128,242 @@ static void styleImGui()
     style.TabRounding = 0.0f;
 }
 
+// Transient Textures
+// ------------------
+
+struct TransientTexture
+{
+    GfxTexture* texture;
+    rgSize      sizeInBytes;
+    rgSize      heapOffset; // Placed textures only
+    u32         lastUsedFrameNumber;
+    rgBool      isPlaced;
+    rgBool      inUse;
+    rgBool      usedThisFrame;
+};
+
+static eastl::vector<TransientTexture> transientTextures;
+static GfxTransientTextureStats transientTextureStats;
+static rgSize transientRequestedBytes;
+static rgBool transientTextureHeapCreated;
+static rgBool transientTextureHeapChecked; // gfxCreateTransientTextureHeap() is only tried once
+
+// Frames a texture can sit idle in the pool before it is destroyed
+static const u32 kTransientTextureMaxIdleFrames = 60;
+// Shared by the placed textures, one that doesn't fit is committed instead
+static const rgSize kTransientTextureHeapSize = 64 * 1024 * 1024;
+
+static rgBool doHeapRangesOverlap(rgSize offsetA, rgSize sizeA, rgSize offsetB, rgSize sizeB)
+{
+    return offsetA < offsetB + sizeB && offsetB < offsetA + sizeA;
+}
+
+static rgBool doTransientTexturesOverlap(TransientTexture const& a, TransientTexture const& b)
+{
+    return a.isPlaced && b.isPlaced && &a != &b && doHeapRangesOverlap(a.heapOffset, a.sizeInBytes, b.heapOffset, b.sizeInBytes);
+}
+
+static rgBool isTransientTextureAliased(TransientTexture const& t, rgBool inUseOnly)
+{
+    for(TransientTexture const& other : transientTextures)
+    {
+        if((!inUseOnly || other.inUse) && doTransientTexturesOverlap(t, other))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Lowest offset no texture in use overlaps, released and idle ones can be aliased.
+// NOTE: inUse is cleared at every frame start, so this also hands out memory the
+// frames still in flight use. That relies on every frame going to the one direct
+// queue in order: the GPU finishes with the memory in older frames before this
+// frame's aliasing barrier, see gfxBeginTransientTextureAliasing(). Textures used
+// from another queue would need the memory of the last RG_MAX_FRAMES_IN_FLIGHT
+// frames kept out of new placements.
+static rgBool findTransientTextureHeapOffset(rgSize sizeInBytes, rgSize alignment, rgSize* outHeapOffset)
+{
+    rgSize heapOffset = 0;
+    rgBool moved = true;
+    while(moved)
+    {
+        moved = false;
+        for(TransientTexture const& other : transientTextures)
+        {
+            if(other.inUse && other.isPlaced && doHeapRangesOverlap(heapOffset, sizeInBytes, other.heapOffset, other.sizeInBytes))
+            {
+                heapOffset = (other.heapOffset + other.sizeInBytes + alignment - 1) / alignment * alignment;
+                moved = true;
+            }
+        }
+    }
+    *outHeapOffset = heapOffset;
+    return (heapOffset + sizeInBytes) <= kTransientTextureHeapSize;
+}
+
+// Memory of the pool's textures, the heap ranges of the placed ones are counted once
+static rgSize calcTransientTextureBytes(rgBool usedThisFrameOnly)
+{
+    rgSize bytes = 0;
+    eastl::vector<eastl::pair<rgSize, rgSize>> placedRanges;
+    for(TransientTexture const& t : transientTextures)
+    {
+        if(usedThisFrameOnly && !t.usedThisFrame)
+        {
+            continue;
+        }
+        if(t.isPlaced)
+        {
+            placedRanges.push_back(eastl::make_pair(t.heapOffset, t.heapOffset + t.sizeInBytes));
+        }
+        else
+        {
+            bytes += t.sizeInBytes;
+        }
+    }
+
+    eastl::sort(placedRanges.begin(), placedRanges.end());
+    rgSize coveredEnd = 0;
+    for(eastl::pair<rgSize, rgSize> const& range : placedRanges)
+    {
+        rgSize begin = eastl::max(range.first, coveredEnd);
+        if(range.second > begin)
+        {
+            bytes += range.second - begin;
+            coveredEnd = range.second;
+        }
+    }
+    return bytes;
+}
+
+GfxTexture* gfxAcquireTransientTexture(char const* tag, u32 width, u32 height, TinyImageFormat format, GfxTextureUsage usage)
+{
+    if(!transientTextureHeapChecked)
+    {
+        transientTextureHeapChecked = true;
+        transientTextureHeapCreated = gfxCreateTransientTextureHeap(kTransientTextureHeapSize);
+    }
+
+    TransientTexture* entry = nullptr;
+    rgBool isNewEntry = false;
+    for(TransientTexture& t : transientTextures)
+    {
+        GfxTexture* texture = t.texture;
+        if(!t.inUse && texture->width == width && texture->height == height && texture->format == format && texture->usage == usage
+           && !isTransientTextureAliased(t, true))
+        {
+            entry = &t;
+            break;
+        }
+    }
+
+    if(entry == nullptr)
+    {
+        TransientTexture t = {};
+        rgSize alignment = 0;
+        if(transientTextureHeapCreated && gfxGetTransientTexturePlacement(width, height, format, usage, &t.sizeInBytes, &alignment))
+        {
+            rgSize heapOffset = 0;
+            if(findTransientTextureHeapOffset(t.sizeInBytes, alignment, &heapOffset))
+            {
+                t.texture = gfxCreatePlacedTransientTexture(tag, width, height, format, usage, heapOffset);
+                t.heapOffset = heapOffset;
+                t.isPlaced = (t.texture != nullptr);
+            }
+            else
+            {
+                rgLogWarn("Transient texture heap is full, '%s' is a committed texture", tag);
+            }
+        }
+
+        if(!t.isPlaced)
+        {
+            t.texture = GfxTexture::create(tag, GfxTextureDim_2D, width, height, format, GfxTextureMipFlag_1Mip, usage, nullptr);
+            t.sizeInBytes = calcTextureSurfaceSizeInBytes(format, width, height);
+        }
+        transientTextures.push_back(t);
+        entry = &transientTextures.back();
+        isNewEntry = true;
+    }
+
+    entry->inUse = true;
+    entry->usedThisFrame = true;
+    entry->lastUsedFrameNumber = g_FrameNumber;
+    transientRequestedBytes += entry->sizeInBytes;
+
+    // A new placed texture needs a discard before its first use, later ones only when the
+    // textures sharing its memory may have used it since, in this frame or one still in flight
+    if(entry->isPlaced && (isNewEntry || isTransientTextureAliased(*entry, false)))
+    {
+        gfxBeginTransientTextureAliasing(entry->texture);
+    }
+    return entry->texture;
+}
+
+void gfxReleaseTransientTexture(GfxTexture* texture)
+{
+    for(TransientTexture& t : transientTextures)
+    {
+        if(t.texture == texture)
+        {
+            rgAssert(t.inUse);
+            t.inUse = false;
+            return;
+        }
+    }
+    rgAssert(!"Texture is not from the transient pool");
+}
+
+GfxTransientTextureStats gfxGetTransientTextureStats()
+{
+    return transientTextureStats;
+}
+
+static void recycleTransientTextures()
+{
+    GfxTransientTextureStats stats = {};
+    stats.requestedBytes = transientRequestedBytes;
+    stats.usedBytes = calcTransientTextureBytes(true);
+
+    for(rgSize i = 0; i < transientTextures.size();)
+    {
+        TransientTexture& t = transientTextures[i];
+        t.inUse = false;
+        if(t.usedThisFrame)
+        {
+            t.usedThisFrame = false;
+        }
+        else if(g_FrameNumber - t.lastUsedFrameNumber > kTransientTextureMaxIdleFrames)
+        {
+            // Deferred by the registry till the frames in flight are done with it
+            GfxTexture::destroy(t.texture);
+            transientTextures[i] = transientTextures.back();
+            transientTextures.pop_back();
+            continue;
+        }
+        ++stats.textureCount;
+        ++i;
+    }
+
+    stats.allocatedBytes = calcTransientTextureBytes(false);
+    stats.savedBytes = stats.requestedBytes - stats.usedBytes;
+    transientTextureStats = stats;
+    transientRequestedBytes = 0;
+}
+
+// Before GfxTexture::destroyAllObjectsNow(), the heap goes after it
+static void destroyTransientTextures()
+{
+    for(TransientTexture& t : transientTextures)
+    {
+        GfxTexture::destroy(t.texture);
+    }
+    transientTextures.set_capacity(0);
+    transientTextureStats = {};
+    transientRequestedBytes = 0;
+}
+
 i32 gfxPreInit()
 {
     g_BindlessTextureManager = rgNew(GfxBindlessResourceManager<GfxTexture>);
@@ -118,11 +375,16 @@ i32 gfxPostInit()
     // Initialize frame buffer allocators
     for(i32 i = 0; i < RG_MAX_FRAMES_IN_FLIGHT; ++i)
     {
-        frameAllocators[i] = rgNew(GfxFrameAllocator)(rgMegabyte(8), rgMegabyte(64), rgMegabyte(64));
+        // Starting sizes, they grow to the heaviest frame. See the stats overlay for the peaks.
+        // D3D12's texture heaps don't grow, frame textures that don't fit get their own memory
+        frameAllocators[i] = rgNew(GfxFrameAllocator)(rgMegabyte(8), rgMegabyte(16), rgMegabyte(16));
+        frameArenas[i] = rgNew(LinearAllocator)("FrameArena", rgMegabyte(4));
     }
     
     // Initialize IMGUI
     IMGUI_CHECKVERSION();
+    ImGui::SetAllocatorFunctions([](size_t size, void* userData) { return memAlloc(size, kMemoryDefaultAlignment, "ImGui"); },
+                                 [](void* ptr, void* userData) { memFree(ptr); });
     ImGui::CreateContext();
     ImGuiIO& imguiIO = ImGui::GetIO();
     imguiIO.Fonts->AddFontFromFileTTF("fonts/Noto_Sans/NotoSans-Regular.ttf", 18);
@@ -138,29 +400,105 @@ i32 gfxPostInit()
     GfxState::samplerNearestRepeat = GfxSamplerState::create("samplerNearestRepeat", GfxSamplerAddressMode_Repeat, GfxSamplerMinMagFilter_Nearest, GfxSamplerMinMagFilter_Nearest, GfxSamplerMipFilter_Nearest, false);
     GfxState::samplerNearestClampEdge = GfxSamplerState::create("samplerNearestClampEdge", GfxSamplerAddressMode_ClampToEdge, GfxSamplerMinMagFilter_Nearest, GfxSamplerMinMagFilter_Nearest, GfxSamplerMipFilter_Nearest, false);
 
+    // Every quad batch starts its vertices at 0, so one index buffer serves them all
+    static_assert(kMaxTexturedQuadsPerDraw * 4 <= UINT16_MAX + 1, "Quad indices don't fit in 16 bit anymore");
+    eastl::vector<u16> quadIndices(kMaxTexturedQuadsPerDraw * 6);
+    for(u32 i = 0; i < kMaxTexturedQuadsPerDraw; ++i)
+    {
+        // 0 - 1
+        // 3 - 2
+        u16 const v = (u16)(i * 4);
+        quadIndices[i * 6 + 0] = v + 0;
+        quadIndices[i * 6 + 1] = v + 3;
+        quadIndices[i * 6 + 2] = v + 1;
+        quadIndices[i * 6 + 3] = v + 1;
+        quadIndices[i * 6 + 4] = v + 3;
+        quadIndices[i * 6 + 5] = v + 2;
+    }
+    GfxState::quadIndexBuffer = GfxBuffer::create("quadIndexBuffer", GfxMemoryType_Default, quadIndices.data(), quadIndices.size() * sizeof(u16), GfxBufferUsage_IndexBuffer);
+
     return 0;
 }
 
+void gfxPostDestroy()
+{
+    // App references are gone by now, this empties the cache
+    evictUnusedTextures();
+    clearTextureCache();
+
+    GfxSamplerState::destroy(GfxState::samplerBilinearRepeat);
+    GfxSamplerState::destroy(GfxState::samplerBilinearClampEdge);
+    GfxSamplerState::destroy(GfxState::samplerTrilinearRepeatAniso);
+    GfxSamplerState::destroy(GfxState::samplerTrilinearClampEdgeAniso);
+    GfxSamplerState::destroy(GfxState::samplerNearestRepeat);
+    GfxSamplerState::destroy(GfxState::samplerNearestClampEdge);
+    GfxBuffer::destroy(GfxState::quadIndexBuffer);
+
+    ImGui::DestroyContext();
+
+    destroyTransientTextures();
+
+    GfxBuffer::destroyAllObjectsNow();
+    GfxTexture::destroyAllObjectsNow();
+    GfxSamplerState::destroyAllObjectsNow();
+    GfxGraphicsPSO::destroyAllObjectsNow();
+    GfxComputePSO::destroyAllObjectsNow();
+
+    // The placed transient textures are gone with the objects above
+    if(transientTextureHeapCreated)
+    {
+        gfxDestroyTransientTextureHeap();
+    }
+    transientTextureHeapCreated = false;
+    transientTextureHeapChecked = false;
+
+    for(i32 i = 0; i < RG_MAX_FRAMES_IN_FLIGHT; ++i)
+    {
+        rgDelete(frameAllocators[i]);
+        rgDelete(frameArenas[i]);
+        frameAllocators[i] = nullptr;
+        frameArenas[i] = nullptr;
+    }
+    rgDelete(ringAllocator);
+    ringAllocator = nullptr;
+
+    rgDelete(g_BindlessTextureManager);
+    g_BindlessTextureManager = nullptr;
+}
+
 // TODO: refactor
 void gfxAtFrameStart()
 {
+    evictUnusedTextures();
+    recycleTransientTextures();
+
     GfxBuffer::destroyMarkedObjects();
     GfxTexture::destroyMarkedObjects();
     GfxSamplerState::destroyMarkedObjects();
     GfxGraphicsPSO::destroyMarkedObjects();
     GfxComputePSO::destroyMarkedObjects();
+
+    g_BindlessTextureManager->recycleRetiredSlots(g_FrameIndex);
     
     // Reset render pass
     // TODO: replace with endEncoder()
     currentRenderPass = nullptr;
     if(currentRenderCmdEncoder != nullptr)
     {
-        rgDelete(currentRenderCmdEncoder);
+        deleteCmdEncoder(currentRenderCmdEncoder);
         currentRenderCmdEncoder = nullptr;
     }
     
     // reset this frame's allocations
     frameAllocators[g_FrameIndex]->reset();
+    if(ringAllocator != nullptr)
+    {
+        ringAllocator->reset();
+    }
+    frameArenas[g_FrameIndex]->reset();
+
+    lastFrameStats = g_FrameStats;
+    g_FrameStats = {};
 }
 
 i32 gfxGetFrameIndex()
@@ -187,15 +525,97 @@ GfxFrameAllocator* gfxGetFrameAllocator()
     return frameAllocators[g_FrameIndex];
 }
 
+GfxFrameAllocator* gfxGetRingAllocator()
+{
+    // Most apps never use it, so its heap is only made on the first request
+    if(ringAllocator == nullptr)
+    {
+        ringAllocator = rgNew(GfxFrameAllocator)(rgMegabyte(16), 0, 0, GfxFrameAllocator::Mode_Ring);
+    }
+    return ringAllocator;
+}
+
+GfxFrameAllocator* gfxFindRingAllocator()
+{
+    return ringAllocator;
+}
+
+GfxFrameAllocatorStats gfxGetFrameAllocatorStats()
+{
+    // lastFrameSize is of the allocator reset most recently
+    GfxFrameAllocatorStats result = frameAllocators[gfxGetFrameIndex()]->getStats();
+    for(i32 i = 0; i < RG_MAX_FRAMES_IN_FLIGHT; ++i)
+    {
+        GfxFrameAllocatorStats const& stats = frameAllocators[i]->getStats();
+        result.capacity = eastl::max(result.capacity, stats.capacity);
+        result.highWaterMark = eastl::max(result.highWaterMark, stats.highWaterMark);
+        if(i != gfxGetFrameIndex())
+        {
+            result.overflowFrameCount += stats.overflowFrameCount;
+            result.growCount += stats.growCount;
+        }
+    }
+    return result;
+}
+
+GfxFrameStats const* gfxGetLastFrameStats()
+{
+    return &lastFrameStats;
+}
+
+LinearAllocator* gfxGetFrameArena()
+{
+    if(threadFrameArena != nullptr)
+    {
+        return threadFrameArena;
+    }
+    return frameArenas[gfxGetFrameIndex()];
+}
+
+void gfxSetThreadFrameArena(LinearAllocator* arena)
+{
+    threadFrameArena = arena;
+}
+
+// Sampleable 2D textures keep their bindless slot for their whole lifetime, so
+// texID is a field load instead of a lookup
+void GfxTexture::onCreate(GfxTexture* obj)
+{
+    obj->texID = kInvalidValue;
+    rgBool isSampleable = (obj->usage & (GfxTextureUsage_DepthStencil | GfxTextureUsage_MemorylessRenderTarget)) == 0;
+    if(obj->dim == GfxTextureDim_2D && isSampleable)
+    {
+        obj->texID = g_BindlessTextureManager->store(obj);
+    }
+}
+
+void GfxTexture::onDestroy(GfxTexture* obj)
+{
+    if(obj->texID != kInvalidValue)
+    {
+        g_BindlessTextureManager->release(obj->texID);
+        obj->texID = kInvalidValue;
+    }
+}
+
+// Each pass gets a profile zone which spans till the next pass is set
+static rgBool passProfileZoneOpen;
+
 static void endCurrentCmdEncoder()
 {
+    if(passProfileZoneOpen)
+    {
+        rgProfileEnd();
+        passProfileZoneOpen = false;
+    }
+
     if(currentRenderCmdEncoder != nullptr)
     {
         if(!currentRenderCmdEncoder->hasEnded)
         {
             currentRenderCmdEncoder->end();
         }
-        rgDelete(currentRenderCmdEncoder);
+        deleteCmdEncoder(currentRenderCmdEncoder);
         currentRenderCmdEncoder = nullptr;
     }
     
@@ -205,7 +625,7 @@ static void endCurrentCmdEncoder()
         {
             currentComputeCmdEncoder->end();
         }
-        rgDelete(currentComputeCmdEncoder);
+        deleteCmdEncoder(currentComputeCmdEncoder);
         currentComputeCmdEncoder = nullptr;
     }
     
@@ -215,7 +635,7 @@ static void endCurrentCmdEncoder()
         {
             currentBlitCmdEncoder->end();
         }
-        rgDelete(currentBlitCmdEncoder);
+        deleteCmdEncoder(currentBlitCmdEncoder);
         currentBlitCmdEncoder = nullptr;
     }
 }
@@ -223,8 +643,10 @@ static void endCurrentCmdEncoder()
 GfxRenderCmdEncoder* gfxSetRenderPass(char const* tag, GfxRenderPass* renderPass)
 {
     endCurrentCmdEncoder();
+    rgProfileBegin(tag);
+    passProfileZoneOpen = true;
 
-    currentRenderCmdEncoder = rgNew(GfxRenderCmdEncoder);
+    currentRenderCmdEncoder = newCmdEncoder<GfxRenderCmdEncoder>();
     currentRenderCmdEncoder->begin(tag, renderPass);
 
     currentRenderPass = renderPass;
@@ -235,8 +657,10 @@ GfxRenderCmdEncoder* gfxSetRenderPass(char const* tag, GfxRenderPass* renderPass
 GfxComputeCmdEncoder* gfxSetComputePass(char const* tag)
 {
     endCurrentCmdEncoder();
+    rgProfileBegin(tag);
+    passProfileZoneOpen = true;
     
-    currentComputeCmdEncoder = rgNew(GfxComputeCmdEncoder);
+    currentComputeCmdEncoder = newCmdEncoder<GfxComputeCmdEncoder>();
     currentComputeCmdEncoder->begin(tag);
     
     return currentComputeCmdEncoder;
@@ -245,14 +669,21 @@ GfxComputeCmdEncoder* gfxSetComputePass(char const* tag)
 GfxBlitCmdEncoder* gfxSetBlitPass(char const* tag)
 {
     endCurrentCmdEncoder();
+    rgProfileBegin(tag);
+    passProfileZoneOpen = true;
     
-    currentBlitCmdEncoder = rgNew(GfxBlitCmdEncoder);
+    currentBlitCmdEncoder = newCmdEncoder<GfxBlitCmdEncoder>();
     currentBlitCmdEncoder->begin(tag);
     currentBlitCmdEncoder->pushDebugTag(tag);
     
     return currentBlitCmdEncoder;
 }
 
+void gfxAtFrameEnd()
+{
+    endCurrentCmdEncoder();
+}
+
 
 //-----------------------------------------------------------------------------
 // IMAGE/BITMAP AND MODEL/MESH
@@ -260,21 +691,23 @@ GfxBlitCmdEncoder* gfxSetBlitPass(char const* tag)
 
 ImageRef loadImage(char const* filename, bool srgbFormat/* = true*/)
 {
+    rgProfileFunction();
+
     rgSize nullTerminatedPathLength = strlen(filename) + 1;
     char const* extStr = filename + nullTerminatedPathLength - 4;
     
     i32 width, height, texChnl;
-    ImageRef output = eastl::shared_ptr<Image>(rgNew(Image), unloadImage);
+    ImageRef output = eastl::shared_ptr<Image>(rgNew(Image)(), unloadImage); // Zeroed, memory stays nullptr if loading fails
     
     if(strcmp(extStr, "dds") == 0 || strcmp(extStr, "DDS") == 0)
     {
-        FileData file = fileRead(filename);
+        FileMapping file = fileMap(filename);
         rgAssert(file.isValid);
         
         DirectX::TexMetadata metadata;
         DirectX::ScratchImage scratchImage;
         HRESULT result = DirectX::LoadFromDDSMemory(file.data, file.dataSize, DirectX::DDS_FLAGS_NONE, &metadata, scratchImage);
-        fileFree(&file);
+        fileUnmap(&file);
         
         if(FAILED(result))
         {
@@ -312,10 +745,16 @@ ImageRef loadImage(char const* filename, bool srgbFormat/* = true*/)
     }
     else
     {
-        unsigned char* texData = stbi_load(filename, &width, &height, &texChnl, 4);
-        if(texData == NULL)
+        FileMapping file = fileMap(filename);
+        unsigned char* texData = nullptr;
+        if(file.isValid)
+        {
+            texData = stbi_load_from_memory(file.data, (int)file.dataSize, &width, &height, &texChnl, 4);
+            fileUnmap(&file);
+        }
+        if(texData == nullptr)
         {
-            rgLogError("Can't load image file %s", filename);
+            rgLogCategory(LogCategory_Asset, LogLevel_Error, "Can't load image file %s", filename);
             return output;
         }
         
@@ -353,30 +792,126 @@ void unloadImage(Image* ptr)
     rgDelete(ptr);
 }
 
+// Texture Cache
+// -------------
+
+static eastl::hash_map<rgHash, TextureRef> textureCache;
+static SDL_SpinLock textureCacheLock;
+static TextureCacheStats textureCacheStats;
+
+// The cache holds one reference, the texture is destroyed when the last holder lets go
+// of it, either evictUnusedTextures() dropping the cache's or the app's after that
+static void releaseCachedTexture(GfxTexture* ptr)
+{
+    GfxTexture::destroy(ptr);
+}
+
+TextureRef loadTexture(char const* filename, TextureLoadFlags flags/* = TextureLoadFlags_SRGB | TextureLoadFlags_GenMips*/)
+{
+    rgProfileFunction();
+
+    // "./a/b.png" and "a\\c/../b.png" are the same file
+    char normalizedPath[512];
+    if(!packNormalizePath(filename, normalizedPath, rgArrayCount(normalizedPath)))
+    {
+        rgLogCategory(LogCategory_Asset, LogLevel_Error, "Texture path too long %s", filename);
+        return nullptr;
+    }
+    rgHash key = rgCRC32(normalizedPath);
+    key = rgCRC32((char const*)&flags, sizeof(flags), key);
+
+    SDL_AtomicLock(&textureCacheLock);
+    auto itr = textureCache.find(key);
+    if(itr != textureCache.end())
+    {
+        TextureRef cached = itr->second;
+        ++textureCacheStats.hits;
+        SDL_AtomicUnlock(&textureCacheLock);
+        return cached;
+    }
+    ++textureCacheStats.misses;
+    SDL_AtomicUnlock(&textureCacheLock);
+
+    // Decode and upload without the lock, other files keep loading meanwhile
+    ImageRef image = loadImage(filename, (flags & TextureLoadFlags_SRGB) != 0);
+    if(image->memory == nullptr)
+    {
+        return nullptr;
+    }
+    GfxTextureMipFlag mipFlag = (flags & TextureLoadFlags_GenMips) ? image->mipFlag : GfxTextureMipFlag_1Mip;
+    GfxTexture* texture = GfxTexture::create(normalizedPath, GfxTextureDim_2D, image->width, image->height, image->format, mipFlag, GfxTextureUsage_ShaderRead, image->slices);
+    TextureRef loaded = eastl::shared_ptr<GfxTexture>(texture, releaseCachedTexture);
+
+    SDL_AtomicLock(&textureCacheLock);
+    auto inserted = textureCache.insert(key);
+    if(inserted.second)
+    {
+        inserted.first->second = loaded;
+        ++textureCacheStats.entryCount;
+    }
+    TextureRef result = inserted.first->second;
+    SDL_AtomicUnlock(&textureCacheLock);
+
+    // If another thread loaded the same file first, loaded is the last reference to
+    // this copy and destroys it
+    return result;
+}
+
+void evictUnusedTextures()
+{
+    SDL_AtomicLock(&textureCacheLock);
+    for(auto itr = textureCache.begin(); itr != textureCache.end();)
+    {
+        if(itr->second.use_count() == 1)
+        {
+            // Drops the last reference, destroy() defers the release until the GPU is done with the texture
+            itr = textureCache.erase(itr);
+            ++textureCacheStats.evictions;
+            --textureCacheStats.entryCount;
+        }
+        else
+        {
+            ++itr;
+        }
+    }
+    SDL_AtomicUnlock(&textureCacheLock);
+}
+
+// Textures still referenced by the app at exit are leaks, the registry reports them
+void clearTextureCache()
+{
+    SDL_AtomicLock(&textureCacheLock);
+    eastl::hash_map<rgHash, TextureRef>().swap(textureCache);
+    textureCacheStats.entryCount = 0;
+    SDL_AtomicUnlock(&textureCacheLock);
+}
+
+TextureCacheStats getTextureCacheStats()
+{
+    SDL_AtomicLock(&textureCacheLock);
+    TextureCacheStats stats = textureCacheStats;
+    SDL_AtomicUnlock(&textureCacheLock);
+    return stats;
+}
+
 
 static DefaultMaterialRef loadMaterial(eastl::string basePath, pugi::xml_node* matNode)
 {
     DefaultMaterial* material = rgNew(DefaultMaterial);
     strncpy(material->tag, matNode->attribute("name").as_string(), sizeof(DefaultMaterial::tag));
     
-    eastl::string rootWd = getCurrentWorkingDir();
-    changeWorkingDir(basePath);
-    
-    ImageRef difalphaImg = loadImage(matNode->child("difalpha").attribute("path").as_string());
-    ImageRef normImg = loadImage(matNode->child("norm").attribute("path").as_string());
-    ImageRef propImg = loadImage(matNode->child("prop").attribute("path").as_string());
-    
-    changeWorkingDir(rootWd);
-    
-    material->diffuseAlpha = GfxTexture::create(nullptr, GfxTextureDim_2D, difalphaImg->width, difalphaImg->height, difalphaImg->format, difalphaImg->mipFlag, GfxTextureUsage_ShaderRead, difalphaImg->slices);
-    material->normal = GfxTexture::create(nullptr, GfxTextureDim_2D, normImg->width, normImg->height, normImg->format, normImg->mipFlag, GfxTextureUsage_ShaderRead, normImg->slices);
-    material->properties = GfxTexture::create(nullptr, GfxTextureDim_2D, propImg->width, propImg->height, propImg->format, propImg->mipFlag, GfxTextureUsage_ShaderRead, propImg->slices);
-    
+    // Materials share maps, the cache loads each file once
+    material->diffuseAlpha = loadTexture(joinPath(basePath, matNode->child("difalpha").attribute("path").as_string()).c_str());
+    material->normal = loadTexture(joinPath(basePath, matNode->child("norm").attribute("path").as_string()).c_str());
+    material->properties = loadTexture(joinPath(basePath, matNode->child("prop").attribute("path").as_string()).c_str());
     
+    return DefaultMaterialRef(material);
 }
 
 ModelRef loadModel(char const* filename)
 {
+    rgProfileFunction();
+
     auto fetchMatrixArray = [](pugi::xml_node& matrixNode, float* arr) -> void
     {
         pugi::xml_node matrixMNode = matrixNode.first_child();
@@ -387,22 +922,21 @@ ModelRef loadModel(char const* filename)
         }
     };
 
-    FileData xmlFileData = fileRead(filename);
+    FileMapping xmlFileData = fileMap(filename);
     if(!xmlFileData.isValid)
     {
         return nullptr;
     }
     
-    eastl::string wd = getCurrentWorkingDir();
+    // Paths in the model are relative to it
     eastl::string basePath = extractBasePath(filename);
-    changeWorkingDir(basePath);
     
     pugi::xml_document modelDoc;
     pugi::xml_parse_result parseResult = modelDoc.load_buffer(xmlFileData.data, xmlFileData.dataSize);
     
     rgAssert(parseResult.status == pugi::xml_parse_status::status_ok);
     
-    fileFree(&xmlFileData);
+    fileUnmap(&xmlFileData);
     
     ModelRef outModel = eastl::shared_ptr<Model>(rgNew(Model), unloadModel);
     
@@ -411,12 +945,12 @@ ModelRef loadModel(char const* filename)
     strncpy(outModel->tag, modelNode.attribute("name").as_string(), sizeof(Model::tag));
     
     const char* binFilename = modelNode.attribute("bufferName").as_string();
-    FileData binFileData = fileRead(binFilename);
+    FileMapping binFileData = fileMap(joinPath(basePath, binFilename).c_str());
     rgAssert(binFileData.isValid);
     
     outModel->vertexIndexBuffer = GfxBuffer::create(binFilename, GfxMemoryType_Default, binFileData.data, binFileData.dataSize, GfxBufferUsage_VertexBuffer | GfxBufferUsage_IndexBuffer);
     
-    fileFree(&binFileData);
+    fileUnmap(&binFileData);
     
     outModel->vertexBufferOffset = modelNode.attribute("vertexBufferOffset").as_uint();
     outModel->index32BufferOffset = modelNode.attribute("index32BufferOffset").as_uint();
@@ -454,10 +988,14 @@ ModelRef loadModel(char const* filename)
         {
             m.properties |= MeshProperties_HasTangent;
         }
+
+        pugi::xml_node matNode = meshNode.child("material");
+        if(matNode)
+        {
+            m.material = loadMaterial(basePath, &matNode);
+        }
         outModel->meshes.push_back(m);
     }
-    
-    changeWorkingDir(wd);
 
     return outModel;
 }
@@ -498,16 +1036,35 @@ QuadUV repeatQuadUV(rgFloat2 repeatXY)
     return r;
 }
 
+// Scales the quad by offsetOrientation.w about its pivot, pos + offset, which stays in place
+static void applyTexturedQuadScale(rgFloat4* posSize, rgFloat4* offsetOrientation)
+{
+    f32 const scale = offsetOrientation->w;
+    rgAssert(scale > 0.0f && "offsetOrientation.w is the scale, 1 keeps the size");
+    posSize->x += offsetOrientation->x * (1.0f - scale);
+    posSize->y += offsetOrientation->y * (1.0f - scale);
+    posSize->z *= scale;
+    posSize->w *= scale;
+    offsetOrientation->x *= scale;
+    offsetOrientation->y *= scale;
+    offsetOrientation->w = 1.0f;
+}
+
 void pushTexturedQuad(TexturedQuads* quadList, SpriteLayer layer, QuadUV uv, rgFloat4 posSize, u32 color, rgFloat4 offsetOrientation, GfxTexture* tex)
 {
-    TexturedQuad q;
-    q.uv = uv;
-    q.pos = { posSize.x, posSize.y, 1.0f };
-    q.color = color;
-    q.size = posSize.zw;
-    q.offsetOrientation = offsetOrientation;
-    q.texID = g_BindlessTextureManager->storeIfNotPresent(tex);
-    quadList->insert(eastl::pair<SpriteLayer, TexturedQuad>(layer, q));
+    applyTexturedQuadScale(&posSize, &offsetOrientation);
+
+    rgAssert(layer < SpriteLayer_Count);
+    TexturedQuadBucket& bucket = quadList->layers[layer];
+    bucket.pos.push_back({posSize.x, posSize.y, 1.0f});
+    bucket.size.push_back(posSize.zw);
+    bucket.uv.push_back(uv);
+    bucket.color.push_back(color);
+    rgAssert(tex->texID != kInvalidValue); // Also catches destroyed textures, onDestroy() resets it
+    bucket.texID.push_back(tex->texID);
+    bucket.offset.push_back(offsetOrientation.xy);
+    bucket.orientation.push_back(offsetOrientation.z);
+    ++quadList->count;
 }
 
 void pushTexturedLine(TexturedQuads* quadList, SpriteLayer layer, QuadUV uv, rgFloat2 pointA, rgFloat2 pointB, f32 thickness, u32 color, GfxTexture* tex)
@@ -542,135 +1099,946 @@ void pushTexturedLine(TexturedQuads* quadList, SpriteLayer layer, QuadUV uv, rgF
     pushTexturedQuad(quadList, layer, uv, {a.x, a.y, l, thickness}, color, {0, tHalf, ang, 1 }, tex);
 }
 
-void genTexturedQuadVertices(TexturedQuads* quadList, eastl::vector<SimpleVertexFormat>* vertices, SimpleInstanceParams* instanceParams)
+// Maps the float bits to an unsigned int with the same ordering
+static u32 sortableFloatBits(f32 value)
 {
-    auto setColor = [](unsigned char* colorArr, u32 c)
-    {
-        colorArr[0] = (unsigned char)(c >> 24 & 0x000000FF);
-        colorArr[1] = (unsigned char)(c >> 16 & 0x000000FF);
-        colorArr[2] = (unsigned char)(c >> 8 & 0x000000FF);
-        colorArr[3] = (unsigned char)(c >> 0 & 0x000000FF);
-    };
+    u32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return (bits & 0x80000000) ? ~bits : (bits | 0x80000000);
+}
 
-    u32 i = 0;
-    for(TexturedQuads::const_iterator iter = quadList->begin(); iter != quadList->end(); ++iter)
+// LSD radix sort of the indices by 8 bit digits, stable. Digits that are the
+// same for all the keys are skipped, so narrow key ranges only take a few passes
+static void radixSortIndices(u64 const* keys, u32 count, u32* order, u32* scratch)
+{
+    u32 histograms[8][256] = {};
+    for(u32 i = 0; i < count; ++i)
     {
-        TexturedQuad const& t = iter->second;
-        
-        SimpleVertexFormat v[4];
-        // 0 - 1
-        // 3 - 2
-#if 1
-        f32 s, c;
-        s = sinf(t.offsetOrientation.z);
-        c = cosf(t.offsetOrientation.z);
-
-        rgFloat2 translateAfter{t.pos.x + t.offsetOrientation.x, t.pos.y + t.offsetOrientation.y};
-
-        rgFloat2 p0{-t.offsetOrientation.x, -t.offsetOrientation.y};
-        rgFloat2 p1{t.size.x - t.offsetOrientation.x, -t.offsetOrientation.y};
-        rgFloat2 p2{t.size.x - t.offsetOrientation.x, t.size.y - t.offsetOrientation.y};
-        rgFloat2 p3{-t.offsetOrientation.x, t.size.y - t.offsetOrientation.y};
-
-        // TODO: enable to use scale
-        //p0 = p0 * t.offsetOrientation.w;
-        //p1 = p1 * t.offsetOrientation.w;
-        //p2 = p2 * t.offsetOrientation.w;
-        //p3 = p3 * t.offsetOrientation.w;
-
-        v[0].pos[0] = c * p0.x - s * p0.y + translateAfter.x;
-        v[0].pos[1] = s * p0.x + c * p0.y + translateAfter.y;
-        v[0].pos[2] = t.pos.z;
-        v[0].texcoord[0] = t.uv.uvTopLeft.x;
-        v[0].texcoord[1] = t.uv.uvTopLeft.y;
-        setColor(v[0].color, t.color);
-
-        v[1].pos[0] = c * p1.x - s * p1.y + translateAfter.x;
-        v[1].pos[1] = s * p1.x + c * p1.y + translateAfter.y;
-        v[1].pos[2] = t.pos.z;
-        v[1].texcoord[0] = t.uv.uvBottomRight.x;
-        v[1].texcoord[1] = t.uv.uvTopLeft.y;
-        setColor(v[1].color, t.color);
-
-        v[2].pos[0] = c * p2.x - s * p2.y + translateAfter.x;
-        v[2].pos[1] = s * p2.x + c * p2.y + translateAfter.y;
-        v[2].pos[2] = t.pos.z;
-        v[2].texcoord[0] = t.uv.uvBottomRight.x;
-        v[2].texcoord[1] = t.uv.uvBottomRight.y;
-        setColor(v[2].color, t.color);
-
-        v[3].pos[0] = c * p3.x - s * p3.y + translateAfter.x;
-        v[3].pos[1] = s * p3.x + c * p3.y + translateAfter.y;
-        v[3].pos[2] = t.pos.z;
-        v[3].texcoord[0] = t.uv.uvTopLeft.x;
-        v[3].texcoord[1] = t.uv.uvBottomRight.y;
-        setColor(v[3].color, t.color);
-#else
-        v[0].pos[0] = t.pos.x;
-        v[0].pos[1] = t.pos.y;
-        v[0].pos[2] = t.pos.z;
-        v[0].texcoord[0] = t.uv.uvTopLeft[0];
-        v[0].texcoord[1] = t.uv.uvTopLeft[1];
-        setColor(v[0].color, t.color);
-        
-        v[1].pos[0] = t.pos.x + t.size.x;
-        v[1].pos[1] = t.pos.y;
-        v[1].pos[2] = t.pos.z;
-        v[1].texcoord[0] = t.uv.uvBottomRight[0];
-        v[1].texcoord[1] = t.uv.uvTopLeft[1];
-        setColor(v[1].color, t.color);
-        
-        v[2].pos[0] = t.pos.x + t.size.x;
-        v[2].pos[1] = t.pos.y + t.size.y;
-        v[2].pos[2] = t.pos.z;
-        v[2].texcoord[0] = t.uv.uvBottomRight[0];
-        v[2].texcoord[1] = t.uv.uvBottomRight[1];
-        setColor(v[2].color, t.color);
-        
-        v[3].pos[0] = t.pos.x;
-        v[3].pos[1] = t.pos.y + t.size.y;
-        v[3].pos[2] = t.pos.z;
-        v[3].texcoord[0] = t.uv.uvTopLeft[0];
-        v[3].texcoord[1] = t.uv.uvBottomRight[1];
-        setColor(v[3].color, t.color);
-#endif
-        vertices->push_back(v[0]);
-        vertices->push_back(v[3]);
-        vertices->push_back(v[1]);
-        
-        vertices->push_back(v[1]);
-        vertices->push_back(v[3]);
-        vertices->push_back(v[2]);
-
-        rgAssert(i < 1024); // simple2d.hlsl MAX_INSTANCES
-        instanceParams->texParam[i++][0] = t.texID;
+        u64 key = keys[i];
+        for(u32 d = 0; d < 8; ++d)
+        {
+            ++histograms[d][(key >> (d * 8)) & 0xFF];
+        }
+        order[i] = i;
     }
-}
 
+    u32* src = order;
+    u32* dst = scratch;
+    for(u32 d = 0; d < 8; ++d)
+    {
+        u32 const shift = d * 8;
+        u32* histogram = histograms[d];
+        if(histogram[(keys[0] >> shift) & 0xFF] == count)
+        {
+            continue;
+        }
 
-//-----------------------------------------------------------------------------
-// HELPER FUNCTIONS
-//-----------------------------------------------------------------------------
+        u32 offset = 0;
+        for(u32 b = 0; b < 256; ++b)
+        {
+            u32 c = histogram[b];
+            histogram[b] = offset;
+            offset += c;
+        }
 
-void copyMatrix4ToFloatArray(f32* dstArray, Matrix4 const& srcMatrix)
-{
-    f32 const* ptr = toFloatPtr(srcMatrix);
-    for(i32 i = 0; i < 16; ++i)
-    {
-        dstArray[i] = ptr[i];
+        for(u32 i = 0; i < count; ++i)
+        {
+            u32 index = src[i];
+            dst[histogram[(keys[index] >> shift) & 0xFF]++] = index;
+        }
+        eastl::swap(src, dst);
     }
-}
 
-void copyMatrix3ToFloatArray(f32* dstArray, Matrix3 const& srcMatrix)
-{
-    f32 const* ptr = toFloatPtr(srcMatrix);
-    for(i32 i = 0; i < 9; ++i)
+    if(src != order)
     {
-        dstArray[i] = ptr[i];
+        memcpy(order, src, count * sizeof(u32));
     }
 }
 
-Matrix4 makeOrthographicProjectionMatrix(f32 left, f32 right, f32 bottom, f32 top, f32 nearPlane, f32 farPlane)
+void sortTexturedQuads(TexturedQuads* quadList)
+{
+    rgProfileFunction();
+
+    for(u32 l = 0; l < SpriteLayer_Count; ++l)
+    {
+        TexturedQuadBucket& bucket = quadList->layers[l];
+        u32 const count = (u32)bucket.pos.size();
+        if(count < 2)
+        {
+            bucket.order.clear();
+            bucket.useOrder = false;
+            continue;
+        }
+
+        FrameVector<u64> keys(count);
+        FrameVector<u32> scratch(count);
+        for(u32 i = 0; i < count; ++i)
+        {
+            keys[i] = ((u64)sortableFloatBits(bucket.pos[i].z) << 32) | bucket.texID[i];
+        }
+        bucket.order.resize(count);
+        radixSortIndices(keys.data(), count, bucket.order.data(), scratch.data());
+        bucket.useOrder = true;
+    }
+}
+
+// Quads per job when generating the vertices, small lists stay on the calling thread
+static const u32 kTexturedQuadsPerJob = 2048;
+static const u32 kTexturedQuadsSinCosBlock = 256;
+
+// View Culling
+// ------------
+
+// Quads only move in x and y, so the rows of the view-projection that give clip.x
+// and clip.y are all that's needed while it has no perspective divide. Perspective
+// cameras test the corners against the clip planes, which needs all four rows
+struct QuadCullView
+{
+    f32     rows[4][4];
+    rgBool  isAffine;
+};
+
+static Matrix4 getSimpleCameraProjection(Matrix4 const* projectionMatrix)
+{
+    return projectionMatrix != nullptr ? *projectionMatrix : makeOrthographicProjectionMatrix(0.0f, (f32)g_WindowInfo.width, (f32)g_WindowInfo.height, 0.0f, 0.1f, 1000.0f);
+}
+
+static Matrix4 getSimpleCameraView(Matrix4 const* viewMatrix)
+{
+    return viewMatrix != nullptr ? *viewMatrix : Matrix4::lookAt(Point3(0, 0, 0), Point3(0, 0, -1000.0f), Vector3(0, 1.0f, 0));
+}
+
+static QuadCullView makeQuadCullView(Matrix4 const* viewMatrix, Matrix4 const* projectionMatrix)
+{
+    Matrix4 viewProjection = getSimpleCameraProjection(projectionMatrix) * getSimpleCameraView(viewMatrix);
+
+    QuadCullView cullView;
+    for(i32 r = 0; r < 4; ++r)
+    {
+        for(i32 c = 0; c < 4; ++c)
+        {
+            cullView.rows[r][c] = (f32)viewProjection.getElem(c, r);
+        }
+    }
+
+    f32 const* wRow = cullView.rows[3];
+    cullView.isAffine = wRow[0] == 0.0f && wRow[1] == 0.0f && wRow[2] == 0.0f && wRow[3] == 1.0f;
+    return cullView;
+}
+
+// AABB of the quad rotated around pos + offset, same transform as genTexturedQuadVertices()
+static void getTexturedQuadBounds(rgFloat3 const& pos, rgFloat2 const& size, rgFloat2 const& offset, f32 s, f32 c, rgFloat2* outCenter, rgFloat2* outHalfExtent)
+{
+    f32 const localX = size.x * 0.5f - offset.x;
+    f32 const localY = size.y * 0.5f - offset.y;
+    outCenter->x = pos.x + offset.x + c * localX - s * localY;
+    outCenter->y = pos.y + offset.y + s * localX + c * localY;
+    outHalfExtent->x = 0.5f * (fabsf(c) * size.x + fabsf(s) * size.y);
+    outHalfExtent->y = 0.5f * (fabsf(s) * size.x + fabsf(c) * size.y);
+}
+
+static rgBool isQuadBoundsVisible(QuadCullView const& cullView, rgFloat2 const& center, rgFloat2 const& halfExtent, f32 z)
+{
+    for(u32 r = 0; r < 2; ++r)
+    {
+        f32 const* row = cullView.rows[r];
+        f32 clipCenter = row[0] * center.x + row[1] * center.y + row[2] * z + row[3];
+        f32 clipExtent = fabsf(row[0]) * halfExtent.x + fabsf(row[1]) * halfExtent.y;
+        if(clipCenter - clipExtent > 1.0f || clipCenter + clipExtent < -1.0f)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Culled only when all the corners are outside the same clip plane. The test is
+// done before the w divide, so corners behind the camera (w <= 0) can't flip over
+// to the visible side and a quad crossing the camera plane is kept
+static rgBool isQuadBoundsVisiblePerspective(QuadCullView const& cullView, rgFloat2 const& center, rgFloat2 const& halfExtent, f32 z)
+{
+    u32 outsideAll = 0x7F;
+    for(u32 corner = 0; corner < 4; ++corner)
+    {
+        f32 const x = center.x + ((corner & 1) ? halfExtent.x : -halfExtent.x);
+        f32 const y = center.y + ((corner & 2) ? halfExtent.y : -halfExtent.y);
+
+        f32 clip[4];
+        for(u32 r = 0; r < 4; ++r)
+        {
+            f32 const* row = cullView.rows[r];
+            clip[r] = row[0] * x + row[1] * y + row[2] * z + row[3];
+        }
+
+        f32 const w = clip[3];
+        u32 outside = 0;
+        outside |= clip[0] < -w ? 0x01 : 0;
+        outside |= clip[0] > w ? 0x02 : 0;
+        outside |= clip[1] < -w ? 0x04 : 0;
+        outside |= clip[1] > w ? 0x08 : 0;
+        outside |= clip[2] < 0.0f ? 0x10 : 0; // 0 to 1 depth, see makePerspectiveProjectionMatrix()
+        outside |= clip[2] > w ? 0x20 : 0;
+        outside |= w <= 0.0f ? 0x40 : 0;
+
+        outsideAll &= outside;
+        if(outsideAll == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void cullTexturedQuads(TexturedQuads* quadList, Matrix4 const* viewMatrix, Matrix4 const* projectionMatrix)
+{
+    rgProfileFunction();
+
+    QuadCullView cullView = makeQuadCullView(viewMatrix, projectionMatrix);
+
+    f32 angles[kTexturedQuadsSinCosBlock];
+    f32 sines[kTexturedQuadsSinCosBlock];
+    f32 cosines[kTexturedQuadsSinCosBlock];
+    u32 quadIndices[kTexturedQuadsSinCosBlock];
+
+    u32 culledCount = 0;
+    for(u32 l = 0; l < SpriteLayer_Count; ++l)
+    {
+        TexturedQuadBucket& bucket = quadList->layers[l];
+        u32 const drawCount = bucket.drawCount();
+        if(drawCount == 0)
+        {
+            continue;
+        }
+
+        if(!bucket.useOrder)
+        {
+            bucket.order.resize(drawCount);
+            for(u32 i = 0; i < drawCount; ++i)
+            {
+                bucket.order[i] = i;
+            }
+            bucket.useOrder = true;
+        }
+
+        // Compact the draw list in place, the visible quads keep their order
+        u32 visibleCount = 0;
+        for(u32 blockBegin = 0; blockBegin < drawCount; blockBegin += kTexturedQuadsSinCosBlock)
+        {
+            u32 const blockCount = eastl::min(drawCount - blockBegin, kTexturedQuadsSinCosBlock);
+            for(u32 k = 0; k < blockCount; ++k)
+            {
+                u32 const q = bucket.order[blockBegin + k];
+                quadIndices[k] = q;
+                angles[k] = bucket.orientation[q];
+            }
+
+            mathSinCos(angles, sines, cosines, blockCount);
+
+            for(u32 k = 0; k < blockCount; ++k)
+            {
+                u32 const q = quadIndices[k];
+                rgFloat2 center, halfExtent;
+                getTexturedQuadBounds(bucket.pos[q], bucket.size[q], bucket.offset[q], sines[k], cosines[k], &center, &halfExtent);
+                rgBool const isVisible = cullView.isAffine ? isQuadBoundsVisible(cullView, center, halfExtent, bucket.pos[q].z)
+                                                           : isQuadBoundsVisiblePerspective(cullView, center, halfExtent, bucket.pos[q].z);
+                if(isVisible)
+                {
+                    bucket.order[visibleCount++] = q;
+                }
+            }
+        }
+
+        culledCount += drawCount - visibleCount;
+        bucket.order.resize(visibleCount);
+    }
+
+    g_FrameStats.texturedQuadsCulled += culledCount;
+}
+
+u32 prepareTexturedQuads(TexturedQuads* quadList, Matrix4 const* viewMatrix, Matrix4 const* projectionMatrix)
+{
+    // Start from every quad, so a list can be drawn more than once with different cameras
+    for(u32 l = 0; l < SpriteLayer_Count; ++l)
+    {
+        quadList->layers[l].order.clear();
+        quadList->layers[l].useOrder = false;
+    }
+
+#if defined(ENABLE_SLOW_GFX_RESOURCE_VALIDATIONS)
+    // A texture can be destroyed between the push and the draw, checked per layer rather than per pushed quad
+    for(u32 l = 0; l < SpriteLayer_Count; ++l)
+    {
+        FrameVector<u32> const& texIDs = quadList->layers[l].texID;
+        g_BindlessTextureManager->validateSlots((u32)texIDs.size(), [&](u32 i) { return texIDs[i]; }, [](u32 i, GfxTexture* ptr, u32 generation)
+        {
+            rgAssert(ptr != nullptr && "Texture was destroyed");
+        });
+    }
+#endif
+
+    if(quadList->sortByDepthAndTexture)
+    {
+        sortTexturedQuads(quadList);
+    }
+
+    if(quadList->cullToView)
+    {
+        cullTexturedQuads(quadList, viewMatrix, projectionMatrix);
+    }
+
+    return quadList->drawCount();
+}
+
+// Textured Quad Grid
+// ------------------
+
+static u64 packQuadGridCell(i32 x, i32 y)
+{
+    return ((u64)(u32)x << 32) | (u32)y;
+}
+
+void TexturedQuadGrid::add(QuadUV uv, rgFloat4 posSize, u32 color, rgFloat4 offsetOrientation, GfxTexture* tex)
+{
+    u32 const index = (u32)quads.size();
+    quads.push_back({uv, posSize, color, offsetOrientation, tex, pushStamp});
+
+    // The quad is stored unscaled, pushTexturedQuad() scales it again
+    applyTexturedQuadScale(&posSize, &offsetOrientation);
+    rgFloat2 center, halfExtent;
+    getTexturedQuadBounds({posSize.x, posSize.y, 1.0f}, posSize.zw, offsetOrientation.xy, sinf(offsetOrientation.z), cosf(offsetOrientation.z), &center, &halfExtent);
+
+    i32 const minX = (i32)floorf((center.x - halfExtent.x) / cellSize);
+    i32 const minY = (i32)floorf((center.y - halfExtent.y) / cellSize);
+    i32 const maxX = (i32)floorf((center.x + halfExtent.x) / cellSize);
+    i32 const maxY = (i32)floorf((center.y + halfExtent.y) / cellSize);
+    for(i32 y = minY; y <= maxY; ++y)
+    {
+        for(i32 x = minX; x <= maxX; ++x)
+        {
+            cells[packQuadGridCell(x, y)].push_back(index);
+        }
+    }
+}
+
+void TexturedQuadGrid::clear()
+{
+    quads.clear();
+    cells.clear();
+}
+
+void TexturedQuadGrid::pushVisibleQuads(TexturedQuads* quadList, SpriteLayer layer, Matrix4 const* viewMatrix, Matrix4 const* projectionMatrix)
+{
+    rgProfileFunction();
+
+    ++pushStamp;
+    u32 pushedCount = 0;
+    auto pushQuad = [&](u32 index)
+    {
+        Quad& quad = quads[index];
+        if(quad.lastPushStamp != pushStamp)
+        {
+            quad.lastPushStamp = pushStamp;
+            pushTexturedQuad(quadList, layer, quad.uv, quad.posSize, quad.color, quad.offsetOrientation, quad.tex);
+            ++pushedCount;
+        }
+    };
+
+    // World rectangle seen by the camera on the z = 1 plane pushTexturedQuad() uses,
+    // from the inverse of the x/y part of the view-projection
+    QuadCullView cullView = makeQuadCullView(viewMatrix, projectionMatrix);
+    f32 const a = cullView.rows[0][0], b = cullView.rows[0][1];
+    f32 const c = cullView.rows[1][0], d = cullView.rows[1][1];
+    f32 const det = a * d - b * c;
+    if(!cullView.isAffine || fabsf(det) < 1e-12f)
+    {
+        // No rectangle on the plane to walk, cullTexturedQuads() tests these per quad
+        for(u32 i = 0, count = (u32)quads.size(); i < count; ++i)
+        {
+            pushQuad(i);
+        }
+        return;
+    }
+
+    f32 const tx = cullView.rows[0][2] + cullView.rows[0][3];
+    f32 const ty = cullView.rows[1][2] + cullView.rows[1][3];
+    f32 minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+    for(u32 corner = 0; corner < 4; ++corner)
+    {
+        f32 const ndcX = (corner & 1) ? 1.0f : -1.0f;
+        f32 const ndcY = (corner & 2) ? 1.0f : -1.0f;
+        f32 const worldX = ( d * (ndcX - tx) - b * (ndcY - ty)) / det;
+        f32 const worldY = (-c * (ndcX - tx) + a * (ndcY - ty)) / det;
+        minX = eastl::min(minX, worldX);
+        minY = eastl::min(minY, worldY);
+        maxX = eastl::max(maxX, worldX);
+        maxY = eastl::max(maxY, worldY);
+    }
+
+    i32 const cellMinX = (i32)floorf(minX / cellSize);
+    i32 const cellMinY = (i32)floorf(minY / cellSize);
+    i32 const cellMaxX = (i32)floorf(maxX / cellSize);
+    i32 const cellMaxY = (i32)floorf(maxY / cellSize);
+
+    // Zoomed far out the view covers more cells than there are occupied ones
+    u64 const viewCellCount = (u64)(cellMaxX - cellMinX + 1) * (u64)(cellMaxY - cellMinY + 1);
+    if(viewCellCount > cells.size())
+    {
+        for(auto& cell : cells)
+        {
+            i32 const x = (i32)(u32)(cell.first >> 32);
+            i32 const y = (i32)(u32)(cell.first & 0xFFFFFFFF);
+            if(x >= cellMinX && x <= cellMaxX && y >= cellMinY && y <= cellMaxY)
+            {
+                for(u32 index : cell.second)
+                {
+                    pushQuad(index);
+                }
+            }
+        }
+    }
+    else
+    {
+        for(i32 y = cellMinY; y <= cellMaxY; ++y)
+        {
+            for(i32 x = cellMinX; x <= cellMaxX; ++x)
+            {
+                auto cellItr = cells.find(packQuadGridCell(x, y));
+                if(cellItr != cells.end())
+                {
+                    for(u32 index : cellItr->second)
+                    {
+                        pushQuad(index);
+                    }
+                }
+            }
+        }
+    }
+
+    g_FrameStats.texturedQuadsCulled += (u32)quads.size() - pushedCount;
+}
+
+// Calls func(bucket, q, i, sin, cos) for the draw order indices [begin, end), q is the
+// quad index in the bucket and i the draw order index over all the layers
+template<typename F>
+static void forEachTexturedQuadInRange(TexturedQuads const* quadList, u32 begin, u32 end, F const& func)
+{
+    f32 angles[kTexturedQuadsSinCosBlock];
+    f32 sines[kTexturedQuadsSinCosBlock];
+    f32 cosines[kTexturedQuadsSinCosBlock];
+    u32 quadIndices[kTexturedQuadsSinCosBlock];
+
+    u32 layerBegin = 0;
+    for(u32 l = 0; l < SpriteLayer_Count && layerBegin < end; ++l)
+    {
+        TexturedQuadBucket const& bucket = quadList->layers[l];
+        u32 const layerEnd = layerBegin + bucket.drawCount();
+        u32 const first = eastl::max(begin, layerBegin);
+        u32 const last = eastl::min(end, layerEnd);
+
+        bool const useOrder = bucket.useOrder;
+        for(u32 blockBegin = first; blockBegin < last; blockBegin += kTexturedQuadsSinCosBlock)
+        {
+            u32 const blockCount = eastl::min(last - blockBegin, kTexturedQuadsSinCosBlock);
+            for(u32 k = 0; k < blockCount; ++k)
+            {
+                u32 const j = blockBegin + k - layerBegin;
+                u32 const q = useOrder ? bucket.order[j] : j;
+                quadIndices[k] = q;
+                angles[k] = bucket.orientation[q];
+            }
+
+            // Batched sin/cos, they dominate the per quad cost
+            mathSinCos(angles, sines, cosines, blockCount);
+
+            for(u32 k = 0; k < blockCount; ++k)
+            {
+                func(bucket, quadIndices[k], blockBegin + k, sines[k], cosines[k]);
+            }
+        }
+        layerBegin = layerEnd;
+    }
+}
+
+void genTexturedQuadVertices(TexturedQuads* quadList, SimpleVertexFormat* const* batchVertices, SimpleInstanceParams* const* batchInstanceParams)
+{
+    rgProfileFunction();
+
+    auto setColor = [](unsigned char* colorArr, u32 c)
+    {
+        colorArr[0] = (unsigned char)(c >> 24 & 0x000000FF);
+        colorArr[1] = (unsigned char)(c >> 16 & 0x000000FF);
+        colorArr[2] = (unsigned char)(c >> 8 & 0x000000FF);
+        colorArr[3] = (unsigned char)(c >> 0 & 0x000000FF);
+    };
+
+    // Every job writes a disjoint range of the outputs, nothing is shared but the read-only quad list
+    jobParallelFor(quadList->drawCount(), kTexturedQuadsPerJob, [&](u32 begin, u32 end)
+    {
+        forEachTexturedQuadInRange(quadList, begin, end, [&](TexturedQuadBucket const& bucket, u32 q, u32 i, f32 s, f32 c)
+        {
+            rgFloat3 const& pos = bucket.pos[q];
+            rgFloat2 const& size = bucket.size[q];
+            rgFloat2 const& offset = bucket.offset[q];
+            QuadUV const& uv = bucket.uv[q];
+            u32 const color = bucket.color[q];
+
+            SimpleVertexFormat v[4];
+            // 0 - 1
+            // 3 - 2
+            rgFloat2 translateAfter{pos.x + offset.x, pos.y + offset.y};
+
+            rgFloat2 p0{-offset.x, -offset.y};
+            rgFloat2 p1{size.x - offset.x, -offset.y};
+            rgFloat2 p2{size.x - offset.x, size.y - offset.y};
+            rgFloat2 p3{-offset.x, size.y - offset.y};
+
+            v[0].pos[0] = c * p0.x - s * p0.y + translateAfter.x;
+            v[0].pos[1] = s * p0.x + c * p0.y + translateAfter.y;
+            v[0].pos[2] = pos.z;
+            v[0].texcoord[0] = uv.uvTopLeft.x;
+            v[0].texcoord[1] = uv.uvTopLeft.y;
+            setColor(v[0].color, color);
+
+            v[1].pos[0] = c * p1.x - s * p1.y + translateAfter.x;
+            v[1].pos[1] = s * p1.x + c * p1.y + translateAfter.y;
+            v[1].pos[2] = pos.z;
+            v[1].texcoord[0] = uv.uvBottomRight.x;
+            v[1].texcoord[1] = uv.uvTopLeft.y;
+            setColor(v[1].color, color);
+
+            v[2].pos[0] = c * p2.x - s * p2.y + translateAfter.x;
+            v[2].pos[1] = s * p2.x + c * p2.y + translateAfter.y;
+            v[2].pos[2] = pos.z;
+            v[2].texcoord[0] = uv.uvBottomRight.x;
+            v[2].texcoord[1] = uv.uvBottomRight.y;
+            setColor(v[2].color, color);
+
+            v[3].pos[0] = c * p3.x - s * p3.y + translateAfter.x;
+            v[3].pos[1] = s * p3.x + c * p3.y + translateAfter.y;
+            v[3].pos[2] = pos.z;
+            v[3].texcoord[0] = uv.uvTopLeft.x;
+            v[3].texcoord[1] = uv.uvBottomRight.y;
+            setColor(v[3].color, color);
+
+            u32 const batch = i / kMaxTexturedQuadsPerDraw;
+            u32 const local = i % kMaxTexturedQuadsPerDraw;
+
+            // Whole vertices in order, the destination can be write-combined memory.
+            // GfxState::quadIndexBuffer makes the two triangles
+            SimpleVertexFormat* out = batchVertices[batch] + local * 4;
+            out[0] = v[0];
+            out[1] = v[1];
+            out[2] = v[2];
+            out[3] = v[3];
+
+            u32* texParam = batchInstanceParams[batch]->texParam[local];
+            texParam[0] = bucket.texID[q];
+            texParam[1] = 0;
+            texParam[2] = 0;
+            texParam[3] = 0;
+        });
+    });
+}
+
+// The quad rotates around pos + offset, so
+// corner' = R * (corner - offset) + pos + offset = R * corner + (pos + offset - R * offset)
+static void fillTexturedQuadInstance(TexturedQuadInstance* outInstance, rgFloat3 const& pos, rgFloat2 const& size, rgFloat2 const& offset, QuadUV const& uv, u32 color, f32 s, f32 c, u32 texID)
+{
+    TexturedQuadInstance inst;
+    inst.pos[0] = pos.x + offset.x - (c * offset.x - s * offset.y);
+    inst.pos[1] = pos.y + offset.y - (s * offset.x + c * offset.y);
+    inst.pos[2] = pos.z;
+    inst.size[0] = size.x;
+    inst.size[1] = size.y;
+    inst.uvRect[0] = uv.uvTopLeft.x;
+    inst.uvRect[1] = uv.uvTopLeft.y;
+    inst.uvRect[2] = uv.uvBottomRight.x;
+    inst.uvRect[3] = uv.uvBottomRight.y;
+    inst.color[0] = (unsigned char)(color >> 24 & 0x000000FF);
+    inst.color[1] = (unsigned char)(color >> 16 & 0x000000FF);
+    inst.color[2] = (unsigned char)(color >> 8 & 0x000000FF);
+    inst.color[3] = (unsigned char)(color >> 0 & 0x000000FF);
+    inst.rotation[0] = (i16)lrintf(s * 32767.0f);
+    inst.rotation[1] = (i16)lrintf(c * 32767.0f);
+    inst.texID = texID;
+    *outInstance = inst;
+}
+
+void genTexturedQuadInstances(TexturedQuads* quadList, TexturedQuadInstance* instances)
+{
+    rgProfileFunction();
+
+    jobParallelFor(quadList->drawCount(), kTexturedQuadsPerJob, [&](u32 begin, u32 end)
+    {
+        forEachTexturedQuadInRange(quadList, begin, end, [&](TexturedQuadBucket const& bucket, u32 q, u32 i, f32 s, f32 c)
+        {
+            fillTexturedQuadInstance(&instances[i], bucket.pos[q], bucket.size[q], bucket.offset[q], bucket.uv[q], bucket.color[q], s, c, bucket.texID[q]);
+        });
+    });
+}
+
+void genSimpleCameraParams(Matrix4 const* viewMatrix, Matrix4 const* projectionMatrix, SimpleCameraParams* cameraParams)
+{
+    copyMatrix4ToFloatArray(cameraParams->projection2d, getSimpleCameraProjection(projectionMatrix));
+    copyMatrix4ToFloatArray(cameraParams->view2d, getSimpleCameraView(viewMatrix));
+}
+
+GfxVertexInputDesc makeTexturedQuadInstanceInputDesc()
+{
+    struct Element
+    {
+        char const* semanticName;
+        u32 semanticIndex;
+        u32 offset;
+        TinyImageFormat format;
+    };
+    Element const elements[] =
+    {
+        { "POSITION", 0, offsetof(TexturedQuadInstance, pos), TinyImageFormat_R32G32B32_SFLOAT },
+        { "TEXCOORD", 0, offsetof(TexturedQuadInstance, size), TinyImageFormat_R32G32_SFLOAT },
+        { "TEXCOORD", 1, offsetof(TexturedQuadInstance, uvRect), TinyImageFormat_R32G32B32A32_SFLOAT },
+        { "COLOR", 0, offsetof(TexturedQuadInstance, color), TinyImageFormat_R8G8B8A8_UNORM },
+        { "TEXCOORD", 2, offsetof(TexturedQuadInstance, rotation), TinyImageFormat_R16G16_SNORM },
+        { "TEXCOORD", 3, offsetof(TexturedQuadInstance, texID), TinyImageFormat_R32_UINT },
+    };
+
+    GfxVertexInputDesc desc = {};
+    desc.elementCount = (i32)rgArrayCount(elements);
+    for(i32 i = 0; i < desc.elementCount; ++i)
+    {
+        desc.elements[i].semanticName = elements[i].semanticName;
+        desc.elements[i].semanticIndex = elements[i].semanticIndex;
+        desc.elements[i].offset = elements[i].offset;
+        desc.elements[i].format = elements[i].format;
+        desc.elements[i].bufferIndex = 0;
+        desc.elements[i].stepFunc = GfxVertexStepFunc_PerInstance;
+    }
+    return desc;
+}
+
+SpriteBatch::SpriteBatch(char const* tag, u32 initialCapacity)
+: count(0)
+, capacity(0)
+{
+    strncpy(this->tag, tag, rgArrayCount(this->tag));
+    for(u32 f = 0; f < RG_MAX_FRAMES_IN_FLIGHT; ++f)
+    {
+        frameBuffers[f].buffer = nullptr;
+        frameBuffers[f].mappedMemory = nullptr;
+        frameBuffers[f].capacity = 0;
+        frameBuffers[f].dirtyBegin = UINT32_MAX;
+        frameBuffers[f].dirtyEnd = 0;
+    }
+    growTo(initialCapacity > 0 ? initialCapacity : 1);
+}
+
+SpriteBatch::~SpriteBatch()
+{
+    for(u32 f = 0; f < RG_MAX_FRAMES_IN_FLIGHT; ++f)
+    {
+        if(frameBuffers[f].buffer != nullptr)
+        {
+            GfxBuffer::destroy(frameBuffers[f].buffer);
+        }
+    }
+}
+
+SpriteHandle SpriteBatch::add(QuadUV uv, rgFloat4 posSize, u32 color, rgFloat4 offsetOrientation, GfxTexture* tex)
+{
+    if(count == capacity)
+    {
+        growTo(count + 1);
+    }
+
+    SpriteHandle handle;
+    if(!freeHandles.empty())
+    {
+        handle = freeHandles.back();
+        freeHandles.pop_back();
+    }
+    else
+    {
+        handle = (SpriteHandle)handleToInstance.size();
+        handleToInstance.push_back(kInvalidSpriteHandle);
+    }
+
+    u32 const index = count++;
+    handleToInstance[handle] = index;
+    instanceToHandle[index] = handle;
+
+    update(handle, uv, posSize, color, offsetOrientation, tex);
+    return handle;
+}
+
+SpriteHandle SpriteBatch::add(QuadUV uv, rgFloat4 posSize, u32 color, rgFloat4 offsetOrientation, TextureRef const& tex)
+{
+    SpriteHandle handle = add(uv, posSize, color, offsetOrientation, tex.get());
+    instanceTextures[handleToInstance[handle]] = tex;
+    return handle;
+}
+
+void SpriteBatch::update(SpriteHandle handle, QuadUV uv, rgFloat4 posSize, u32 color, rgFloat4 offsetOrientation, GfxTexture* tex)
+{
+    rgAssert(handle < handleToInstance.size() && handleToInstance[handle] != kInvalidSpriteHandle);
+    u32 const index = handleToInstance[handle];
+
+    applyTexturedQuadScale(&posSize, &offsetOrientation);
+    rgFloat3 pos = {posSize.x, posSize.y, 1.0f};
+    f32 s = sinf(offsetOrientation.z);
+    f32 c = cosf(offsetOrientation.z);
+    rgAssert(tex->texID != kInvalidValue);
+    fillTexturedQuadInstance(&instances[index], pos, posSize.zw, offsetOrientation.xy, uv, color, s, c, tex->texID);
+#if defined(ENABLE_SLOW_GFX_RESOURCE_VALIDATIONS)
+    instanceTexGenerations[index] = kInvalidValue; // Recorded by prepareForDraw(), which takes the bindless lock once
+#endif
+    instanceTextures[index] = nullptr;
+    markDirty(index, index + 1);
+}
+
+void SpriteBatch::update(SpriteHandle handle, QuadUV uv, rgFloat4 posSize, u32 color, rgFloat4 offsetOrientation, TextureRef const& tex)
+{
+    update(handle, uv, posSize, color, offsetOrientation, tex.get());
+    instanceTextures[handleToInstance[handle]] = tex;
+}
+
+void SpriteBatch::remove(SpriteHandle handle)
+{
+    rgAssert(handle < handleToInstance.size() && handleToInstance[handle] != kInvalidSpriteHandle);
+    u32 const index = handleToInstance[handle];
+    u32 const last = count - 1;
+
+    // Keep the instances packed, move the last one into the hole
+    if(index != last)
+    {
+        SpriteHandle movedHandle = instanceToHandle[last];
+        instances[index] = instances[last];
+        instanceTextures[index] = eastl::move(instanceTextures[last]);
+#if defined(ENABLE_SLOW_GFX_RESOURCE_VALIDATIONS)
+        instanceTexGenerations[index] = instanceTexGenerations[last];
+#endif
+        instanceToHandle[index] = movedHandle;
+        handleToInstance[movedHandle] = index;
+        markDirty(index, index + 1);
+    }
+
+    // The draws that used it are already recorded, destroy() waits for the GPU
+    instanceTextures[last] = nullptr;
+    handleToInstance[handle] = kInvalidSpriteHandle;
+    freeHandles.push_back(handle);
+    --count;
+}
+
+void SpriteBatch::clear()
+{
+    // Every handle becomes invalid, the buffers keep their capacity
+    for(u32 i = 0; i < count; ++i)
+    {
+        instanceTextures[i] = nullptr;
+    }
+    count = 0;
+    handleToInstance.clear();
+    freeHandles.clear();
+}
+
+GfxBuffer* SpriteBatch::prepareForDraw()
+{
+    rgAssert(count > 0);
+
+#if defined(ENABLE_SLOW_GFX_RESOURCE_VALIDATIONS)
+    // The texIDs are kept across frames, a released slot may now hold another texture
+    g_BindlessTextureManager->validateSlots(count, [&](u32 i) { return instances[i].texID; }, [&](u32 i, GfxTexture* ptr, u32 generation)
+    {
+        rgAssert(ptr != nullptr && "Sprite texture was destroyed while in the batch");
+        if(instanceTexGenerations[i] == kInvalidValue)
+        {
+            instanceTexGenerations[i] = generation;
+        }
+        rgAssert(instanceTexGenerations[i] == generation && "Sprite texture was destroyed while in the batch");
+    });
+#endif
+
+    // The GPU is done with this frame index, so its buffer can be written
+    FrameBuffer& fb = frameBuffers[gfxGetFrameIndex()];
+    if(fb.capacity < count)
+    {
+        if(fb.buffer != nullptr)
+        {
+            GfxBuffer::destroy(fb.buffer);
+        }
+
+        // A new buffer starts with all the instances, nothing left to write
+        fb.buffer = GfxBuffer::create(tag, GfxMemoryType_Upload, instances.data(), capacity * sizeof(TexturedQuadInstance), GfxBufferUsage_VertexBuffer);
+        fb.mappedMemory = fb.buffer->map(0, 0);
+        fb.capacity = capacity;
+    }
+    else if(fb.dirtyBegin < fb.dirtyEnd)
+    {
+        u32 const end = eastl::min(fb.dirtyEnd, count);
+        if(fb.dirtyBegin < end)
+        {
+            memcpy((TexturedQuadInstance*)fb.mappedMemory + fb.dirtyBegin, instances.data() + fb.dirtyBegin, (end - fb.dirtyBegin) * sizeof(TexturedQuadInstance));
+            g_FrameStats.spriteBatchUploads += end - fb.dirtyBegin;
+        }
+    }
+
+    fb.dirtyBegin = UINT32_MAX;
+    fb.dirtyEnd = 0;
+    return fb.buffer;
+}
+
+void SpriteBatch::markDirty(u32 begin, u32 end)
+{
+    for(u32 f = 0; f < RG_MAX_FRAMES_IN_FLIGHT; ++f)
+    {
+        frameBuffers[f].dirtyBegin = eastl::min(frameBuffers[f].dirtyBegin, begin);
+        frameBuffers[f].dirtyEnd = eastl::max(frameBuffers[f].dirtyEnd, end);
+    }
+}
+
+void SpriteBatch::growTo(u32 minCapacity)
+{
+    // The GPU buffers are recreated lazily by prepareForDraw()
+    capacity = eastl::max(minCapacity, capacity * 2);
+    instances.resize(capacity);
+    instanceTextures.resize(capacity);
+    instanceToHandle.resize(capacity);
+#if defined(ENABLE_SLOW_GFX_RESOURCE_VALIDATIONS)
+    instanceTexGenerations.resize(capacity);
+#endif
+}
+
+// The draw helpers only record through the encoder API, the backends implement
+// the bind and draw calls
+static void bindSimple2dCamera(GfxRenderCmdEncoder* encoder, Matrix4 const* viewMatrix, Matrix4 const* projectionMatrix)
+{
+    SimpleCameraParams cameraParams;
+    genSimpleCameraParams(viewMatrix, projectionMatrix, &cameraParams);
+    GfxFrameResource cameraBuffer = gfxGetFrameAllocator()->newBuffer("cameraCBuffer", sizeof(cameraParams), (void*)&cameraParams);
+
+    encoder->bindBuffer("camera", &cameraBuffer);
+    encoder->bindSamplerState("simpleSampler", GfxState::samplerBilinearRepeat);
+}
+
+void GfxRenderCmdEncoder::drawTexturedQuads(TexturedQuads* quads, Matrix4 const* viewMatrix, Matrix4 const* projectionMatrix)
+{
+    if(quads->size() < 1)
+    {
+        return;
+    }
+
+    u32 const quadCount = prepareTexturedQuads(quads, viewMatrix, projectionMatrix);
+    if(quadCount < 1)
+    {
+        return;
+    }
+
+    // One vertex buffer and one instanceParams cbuffer per batch, the texIDs are in a fixed size cbuffer
+    u32 const batchCount = (quadCount + kMaxTexturedQuadsPerDraw - 1) / kMaxTexturedQuadsPerDraw;
+
+    FrameVector<GfxFrameResource> vertexBuffers(batchCount);
+    FrameVector<GfxFrameResource> instanceParamsBuffers(batchCount);
+    FrameVector<SimpleVertexFormat*> batchVertices(batchCount);
+    FrameVector<SimpleInstanceParams*> batchInstanceParams(batchCount);
+    for(u32 b = 0; b < batchCount; ++b)
+    {
+        u32 const batchQuadCount = eastl::min(quadCount - b * kMaxTexturedQuadsPerDraw, kMaxTexturedQuadsPerDraw);
+
+        void* mappedVertices = nullptr;
+        void* mappedInstanceParams = nullptr;
+        vertexBuffers[b] = gfxGetFrameAllocator()->newBufferMapped("drawTexturedQuadsVertexBuf", batchQuadCount * 4 * sizeof(SimpleVertexFormat), &mappedVertices);
+        instanceParamsBuffers[b] = gfxGetFrameAllocator()->newBufferMapped("instanceParamsCBuffer", sizeof(SimpleInstanceParams), &mappedInstanceParams);
+        batchVertices[b] = (SimpleVertexFormat*)mappedVertices;
+        batchInstanceParams[b] = (SimpleInstanceParams*)mappedInstanceParams;
+    }
+
+    // Writes straight into the mapped buffers, no staging copy
+    genTexturedQuadVertices(quads, batchVertices.data(), batchInstanceParams.data());
+
+    bindSimple2dCamera(this, viewMatrix, projectionMatrix);
+
+    for(u32 b = 0; b < batchCount; ++b)
+    {
+        u32 const batchQuadCount = eastl::min(quadCount - b * kMaxTexturedQuadsPerDraw, kMaxTexturedQuadsPerDraw);
+
+        bindBuffer("instanceParams", &instanceParamsBuffers[b]);
+        setVertexBuffer(&vertexBuffers[b], 0);
+
+        drawIndexedTriangles(batchQuadCount * 6, false, GfxState::quadIndexBuffer, 0, 1);
+        ++g_FrameStats.texturedQuadDraws;
+    }
+    g_FrameStats.texturedQuads += quadCount;
+}
+
+
+void GfxRenderCmdEncoder::drawTexturedQuadsInstanced(TexturedQuads* quads, Matrix4 const* viewMatrix, Matrix4 const* projectionMatrix)
+{
+    if(quads->size() < 1)
+    {
+        return;
+    }
+
+    u32 const quadCount = prepareTexturedQuads(quads, viewMatrix, projectionMatrix);
+    if(quadCount < 1)
+    {
+        return;
+    }
+
+    void* mappedInstances = nullptr;
+    GfxFrameResource instanceBufAllocation = gfxGetFrameAllocator()->newBufferMapped("drawTexturedQuadsInstanceBuf", quadCount * sizeof(TexturedQuadInstance), &mappedInstances);
+    genTexturedQuadInstances(quads, (TexturedQuadInstance*)mappedInstances);
+
+    bindSimple2dCamera(this, viewMatrix, projectionMatrix);
+
+    setVertexBuffer(&instanceBufAllocation, 0);
+
+    drawTriangles(0, 6, quadCount);
+    ++g_FrameStats.texturedQuadDraws;
+    g_FrameStats.texturedQuads += quadCount;
+}
+
+
+void GfxRenderCmdEncoder::drawSpriteBatch(SpriteBatch* batch, Matrix4 const* viewMatrix, Matrix4 const* projectionMatrix)
+{
+    if(batch->size() < 1)
+    {
+        return;
+    }
+
+    GfxBuffer* instanceBuffer = batch->prepareForDraw();
+
+    bindSimple2dCamera(this, viewMatrix, projectionMatrix);
+
+    setVertexBuffer(instanceBuffer, 0, 0);
+
+    drawTriangles(0, 6, batch->size());
+    ++g_FrameStats.texturedQuadDraws;
+    g_FrameStats.texturedQuads += batch->size();
+}
+
+
+//-----------------------------------------------------------------------------
+// HELPER FUNCTIONS
+//-----------------------------------------------------------------------------
+
+void copyMatrix4ToFloatArray(f32* dstArray, Matrix4 const& srcMatrix)
+{
+    f32 const* ptr = toFloatPtr(srcMatrix);
+    for(i32 i = 0; i < 16; ++i)
+    {
+        dstArray[i] = ptr[i];
+    }
+}
+
+void copyMatrix3ToFloatArray(f32* dstArray, Matrix3 const& srcMatrix)
+{
+    f32 const* ptr = toFloatPtr(srcMatrix);
+    for(i32 i = 0; i < 9; ++i)
+    {
+        dstArray[i] = ptr[i];
+    }
+}
+
+Matrix4 makeOrthographicProjectionMatrix(f32 left, f32 right, f32 bottom, f32 top, f32 nearPlane, f32 farPlane)
 {
     f32 length = 1.0f / (right - left);
     f32 height = 1.0f / (top - bottom);
@@ -756,3 +2124,15 @@ TinyImageFormat convertLinearToSRGBFormat(TinyImageFormat linearFormat)
     
     return newFormat;
 }
+
+rgSize calcTextureSurfaceSizeInBytes(TinyImageFormat format, u32 width, u32 height)
+{
+    u32 blockWidth = TinyImageFormat_WidthOfBlock(format);
+    u32 blockHeight = TinyImageFormat_HeightOfBlock(format);
+    u32 blockSizeInBytes = TinyImageFormat_BitSizeOfBlock(format) / 8;
+
+    rgSize widthInBlocks = eastl::max(1u, (width + blockWidth - 1) / blockWidth);
+    rgSize heightInBlocks = eastl::max(1u, (height + blockHeight - 1) / blockHeight);
+
+    return widthInBlocks * heightInBlocks * blockSizeInBytes;
+}
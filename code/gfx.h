@@ -43,7 +43,7 @@
 #include <EASTL/string.h>
 #include <EASTL/vector.h>
 #include <EASTL/fixed_vector.h>
-#include <EASTL/vector_multimap.h>
+#include <EASTL/sort.h>
 #include <EASTL/hash_map.h>
 
 #define RG_MAX_FRAMES_IN_FLIGHT 3
@@ -61,59 +61,350 @@ static const u32 kUninitializedValue = 0;
 struct  GfxTexture;
 struct  GfxFrameResource;
 class   GfxFrameAllocator;
-struct  TexturedQuad;
+struct  GfxFrameAllocatorStats;
+struct  TexturedQuads;
+class   SpriteBatch;
 enum    SpriteLayer : u8;
 
-// PERF: check performance with normal multimap
-typedef eastl::vector_multimap<SpriteLayer, TexturedQuad> TexturedQuads;
+i32                 gfxGetFrameIndex();
+LinearAllocator*    gfxGetFrameArena(); // CPU memory for this frame, valid for RG_MAX_FRAMES_IN_FLIGHT frames
+void                gfxSetThreadFrameArena(LinearAllocator* arena); // Overrides gfxGetFrameArena() on the calling thread, nullptr to restore
+
+// Frame Arena Allocator
+// ---------------------
+// NOTE: EASTL allocator for transient per-frame containers, deallocate() is a
+// no-op and the memory is reclaimed when the frame arena is reset. Containers
+// using this must not outlive the frame they were constructed in, allocate()
+// asserts if the arena was reset since the allocator was bound to it.
+class FrameArenaAllocator
+{
+public:
+    FrameArenaAllocator(char const* name = "FrameArenaAllocator") : arena(gfxGetFrameArena()), arenaFrame(arena->getResetCount()) {}
+    FrameArenaAllocator(FrameArenaAllocator const& x) : arena(x.arena), arenaFrame(x.arenaFrame) {}
+    FrameArenaAllocator(FrameArenaAllocator const& x, char const* name) : arena(x.arena), arenaFrame(x.arenaFrame) {}
+
+    FrameArenaAllocator& operator=(FrameArenaAllocator const& x) { arena = x.arena; arenaFrame = x.arenaFrame; return *this; }
+
+    void* allocate(size_t n, int flags = 0) { checkFrame(); return arena->allocate(n, EASTL_ALLOCATOR_MIN_ALIGNMENT > 16 ? EASTL_ALLOCATOR_MIN_ALIGNMENT : 16); }
+    void* allocate(size_t n, size_t alignment, size_t offset, int flags = 0) { rgAssert(offset == 0); checkFrame(); return arena->allocate(n, alignment > 16 ? alignment : 16); }
+    void  deallocate(void* p, size_t n) {}
+
+    char const* get_name() const { return arena->getName(); }
+    void        set_name(char const* name) {}
+
+    void checkFrame() const { rgAssert(arenaFrame == arena->getResetCount() && "Frame container outlived its frame"); }
+
+    LinearAllocator* arena;
+    u32              arenaFrame; // arena->getResetCount() when bound
+};
+
+inline bool operator==(FrameArenaAllocator const& a, FrameArenaAllocator const& b) { return a.arena == b.arena; }
+inline bool operator!=(FrameArenaAllocator const& a, FrameArenaAllocator const& b) { return a.arena != b.arena; }
+
+template<typename T>
+using FrameVector = eastl::vector<T, FrameArenaAllocator>;
 
-i32     gfxGetFrameIndex();
 void    gfxSetBindlessResource(u32 slot, GfxTexture* ptr);
 
+// Threading
+// ---------
+// NOTE: create(), destroy(), isValid(), fromHandle() of every Gfx object type
+// and the bindless texture table can be called from any thread, e.g. loader
+// jobs streaming in textures and meshes. Everything else (encoders, frame
+// allocators, gfxBeginFrame/gfxEndFrame, map()/unmap()) stays on the render thread.
+// - An object is visible to other threads only after create() returned, share
+//   the pointer or handle through your own synchronisation.
+// - destroy() and bindless slot releases are staged, gfxAtFrameStart() merges
+//   them into the current frame's queues. Until then the GPU may still use them.
+// - Backend createGfxObject()/destroyGfxObject() run on the calling thread with no
+//   common lock. The backends lock only their shared bookkeeping (descriptor free
+//   lists, the mip generation queue), uploads from threads other than the render
+//   thread go through a batch of their own, so the render thread never waits on them.
+
 // Gfx Object Registry
 // -------------------
 // NOTE: A base class for every Gfx resource type
-// TODO: Add a destroyAllObjectsNow() function to be
-// called at the last frame of the application, because 
-// there will not be more frames to free and destroy objects.
+// Objects live in fixed size slabs owned by the registry of their type, a
+// destroyed object's slot is reused once destroyMarkedObjects() has run for
+// the frame it was merged into. Every object also has a 32 bit handle, slot
+// index in the low kHandleIndexBits and the slot generation above, that
+// fromHandle() resolves in O(1). poolLock guards the pool and the staged destroys.
+// Slabs are kept until exit on purpose, the slot index in a handle addresses
+// its slab, and a type that peaked once tends to peak again (level loads).
+// destroyAllObjectsNow() is called at app exit, there are no more frames then
+// to retire the pending destroys.
+typedef u32 GfxObjectHandle;
+static const GfxObjectHandle kInvalidGfxObjectHandle = kInvalidValue;
+
 template<typename Type, typename... Args>
 struct GfxObjectRegistry
 {
-    rgChar  tag[RG_GFX_OBJECT_TAG_LENGTH];
+    rgChar          tag[RG_GFX_OBJECT_TAG_LENGTH];
+    GfxObjectHandle handle = kInvalidGfxObjectHandle; // Objects not made by create() have none
+
+    static const u32 kObjectsPerSlab = 64;
+    static const u32 kHandleIndexBits = 20;
+    static const u32 kHandleIndexMask = (1u << kHandleIndexBits) - 1;
+    static const u32 kHandleGenerationMask = (1u << (32 - kHandleIndexBits)) - 1;
+
+    enum SlotState : u8
+    {
+        SlotState_Free,
+        SlotState_Creating, // create() hasn't returned yet
+        SlotState_Live,
+        SlotState_PendingDestroy, // destroy() was called, the memory is still in use by frames in flight
+    };
+
+    struct Slot
+    {
+        u16 generation;
+        u8  state;
+    };
+
+    struct Pool
+    {
+        eastl::vector<Type*>    slabs;
+        eastl::vector<Slot>     slots;
+        eastl::vector<u32>      freeSlots;
+        u32                     liveCount; // Slots in SlotState_Live
+    };
+
+    static Pool pool;
+    static SDL_SpinLock poolLock;
+    static eastl::vector<Type*> stagedDestroys; // destroy() calls since the last frame start
+    static eastl::vector<Type*> objectsToDestroy[RG_MAX_FRAMES_IN_FLIGHT]; // Render thread only
+
+    // Needs poolLock
+    static Type* getSlotObject(u32 slot)
+    {
+        return pool.slabs[slot / kObjectsPerSlab] + (slot % kObjectsPerSlab);
+    }
+
+    // Needs poolLock, nullptr unless the handle's object is live
+    static Type* findLiveObject(GfxObjectHandle h)
+    {
+        u32 slot = h & kHandleIndexMask;
+        if(h == kInvalidGfxObjectHandle || slot >= pool.slots.size()
+           || pool.slots[slot].state != SlotState_Live || pool.slots[slot].generation != (h >> kHandleIndexBits))
+        {
+            return nullptr;
+        }
+        return getSlotObject(slot);
+    }
+
+    static Type* allocateObject()
+    {
+        SDL_AtomicLock(&poolLock);
+        if(pool.freeSlots.empty())
+        {
+            u32 firstSlot = (u32)pool.slots.size();
+            rgAssert(firstSlot + kObjectsPerSlab <= kHandleIndexMask);
+            pool.slabs.push_back((Type*)rgMallocAligned(sizeof(Type) * kObjectsPerSlab, alignof(Type)));
+            pool.slots.resize(firstSlot + kObjectsPerSlab, Slot{0, SlotState_Free});
+            // Reversed, so the lowest slots are handed out first
+            for(u32 i = kObjectsPerSlab; i > 0; --i)
+            {
+                pool.freeSlots.push_back(firstSlot + i - 1);
+            }
+        }
+
+        u32 slot = pool.freeSlots.back();
+        pool.freeSlots.pop_back();
+        pool.slots[slot].state = SlotState_Creating;
+
+        Type* mem = getSlotObject(slot);
+        GfxObjectHandle h = ((u32)pool.slots[slot].generation << kHandleIndexBits) | slot;
+        SDL_AtomicUnlock(&poolLock);
+
+        Type* obj = new(mem) Type;
+        obj->handle = h;
+        return obj;
+    }
+
+    static void freeObject(Type* obj)
+    {
+        u32 slot = obj->handle & kHandleIndexMask;
+        obj->~Type();
+#if defined(ENABLE_SLOW_GFX_RESOURCE_VALIDATIONS)
+        // Poison it, a stale pointer reads garbage instead of a plausible object
+        memset((void*)obj, 0xDD, sizeof(Type));
+#endif
+        SDL_AtomicLock(&poolLock);
+        Slot& s = pool.slots[slot];
+        s.generation = (u16)((s.generation + 1) & kHandleGenerationMask);
+        s.state = SlotState_Free;
+        pool.freeSlots.push_back(slot);
+        SDL_AtomicUnlock(&poolLock);
+    }
 
-    static eastl::vector<Type*> objectsToDestroy[RG_MAX_FRAMES_IN_FLIGHT];
-    
     static Type* create(const char* name, Args... args)
     {
-        Type* obj = rgNew(Type);
+        Type* obj = allocateObject();
         if(name != nullptr)
         {
-            strncpy(obj->tag, name, rgArrayCount(tag));
+            // Texture tags are whole file paths, strncpy() leaves long ones unterminated
+            strncpy(obj->tag, name, rgArrayCount(tag) - 1);
+            obj->tag[rgArrayCount(tag) - 1] = 0;
+        }
+        else
+        {
+            obj->tag[0] = 0;
         }
         
         Type::fillStruct(args..., obj);
         Type::createGfxObject(name, args..., obj);
+        Type::onCreate(obj);
 
+        SDL_AtomicLock(&poolLock);
+        pool.slots[obj->handle & kHandleIndexMask].state = SlotState_Live;
+        ++pool.liveCount;
+        SDL_AtomicUnlock(&poolLock);
         return obj;
     }
     
     static void destroy(Type* obj)
     {
-        objectsToDestroy[gfxGetFrameIndex()].push_back(obj);
+        SDL_AtomicLock(&poolLock);
+        rgAssert(findLiveObject(obj->handle) == obj); // Destroyed twice or not made by create()
+        pool.slots[obj->handle & kHandleIndexMask].state = SlotState_PendingDestroy;
+        --pool.liveCount;
+        SDL_AtomicUnlock(&poolLock);
+
+        Type::onDestroy(obj);
+
+        SDL_AtomicLock(&poolLock);
+        stagedDestroys.push_back(obj);
+        SDL_AtomicUnlock(&poolLock);
     }
 
+    // Backend independent hooks, types that need them declare their own
+    static void onCreate(Type* obj) {}
+    static void onDestroy(Type* obj) {}
+
+    // Render thread, at frame start
     static void destroyMarkedObjects()
     {
         i32 frameIndex = gfxGetFrameIndex();
         for(auto itr : objectsToDestroy[frameIndex])
         {
             Type::destroyGfxObject(itr);
-            rgDelete(&(*itr));
+            freeObject(itr);
         }
         objectsToDestroy[frameIndex].clear();
+
+        // Objects destroyed since the last frame start, possibly used by the previous
+        // frame, are freed when this frame index comes around again
+        SDL_AtomicLock(&poolLock);
+        objectsToDestroy[frameIndex].swap(stagedDestroys);
+        SDL_AtomicUnlock(&poolLock);
+    }
+
+    // Render thread, at app exit after the GPU went idle. Objects that were
+    // never destroyed are leaks of the app, they are logged and destroyed too
+    static void destroyAllObjectsNow()
+    {
+        eastl::vector<Type*> objects;
+        SDL_AtomicLock(&poolLock);
+        for(i32 i = 0; i < RG_MAX_FRAMES_IN_FLIGHT; ++i)
+        {
+            objects.insert(objects.end(), objectsToDestroy[i].begin(), objectsToDestroy[i].end());
+            objectsToDestroy[i].set_capacity(0);
+        }
+        objects.insert(objects.end(), stagedDestroys.begin(), stagedDestroys.end());
+        stagedDestroys.set_capacity(0);
+        u32 pendingCount = (u32)objects.size();
+        for(u32 slot = 0, slotCount = (u32)pool.slots.size(); slot < slotCount; ++slot)
+        {
+            if(pool.slots[slot].state == SlotState_Live)
+            {
+                pool.slots[slot].state = SlotState_PendingDestroy;
+                --pool.liveCount;
+                objects.push_back(getSlotObject(slot));
+            }
+        }
+        rgAssert(pool.liveCount == 0);
+        SDL_AtomicUnlock(&poolLock);
+
+        for(u32 i = 0; i < (u32)objects.size(); ++i)
+        {
+            Type* obj = objects[i];
+            if(i >= pendingCount)
+            {
+                rgLogCategory(LogCategory_Gfx, LogLevel_Warn, "Gfx object '%s' was not destroyed before exit", obj->tag);
+                Type::onDestroy(obj);
+            }
+            Type::destroyGfxObject(obj);
+            freeObject(obj);
+        }
+
+        SDL_AtomicLock(&poolLock);
+        rgAssert(pool.freeSlots.size() == pool.slots.size());
+        for(Type* slab : pool.slabs)
+        {
+            rgFree(slab);
+        }
+        pool.slabs.set_capacity(0);
+        pool.slots.set_capacity(0);
+        pool.freeSlots.set_capacity(0);
+        SDL_AtomicUnlock(&poolLock);
+    }
+
+    // False once destroy() was called on the object
+    static rgBool isValid(GfxObjectHandle h)
+    {
+        SDL_AtomicLock(&poolLock);
+        rgBool valid = findLiveObject(h) != nullptr;
+        SDL_AtomicUnlock(&poolLock);
+        return valid;
+    }
+
+    // nullptr for stale handles, they assert with ENABLE_SLOW_GFX_RESOURCE_VALIDATIONS
+    static Type* fromHandle(GfxObjectHandle h)
+    {
+        SDL_AtomicLock(&poolLock);
+        Type* obj = findLiveObject(h);
+        SDL_AtomicUnlock(&poolLock);
+#if defined(ENABLE_SLOW_GFX_RESOURCE_VALIDATIONS)
+        rgAssert(obj != nullptr && "Stale or invalid GfxObjectHandle");
+#endif
+        return obj;
+    }
+
+    // Visits every object that wasn't destroyed yet, for tooling. Holds poolLock,
+    // so func must not create or destroy objects of this type
+    template<typename F>
+    static void forEachLiveObject(F const& func)
+    {
+        SDL_AtomicLock(&poolLock);
+        for(u32 slot = 0, slotCount = (u32)pool.slots.size(); slot < slotCount; ++slot)
+        {
+            if(pool.slots[slot].state == SlotState_Live)
+            {
+                func(getSlotObject(slot));
+            }
+        }
+        SDL_AtomicUnlock(&poolLock);
+    }
+
+    // The objects forEachLiveObject() visits, not the ones pending destroy or still in create()
+    static u32 getLiveObjectCount()
+    {
+        SDL_AtomicLock(&poolLock);
+        u32 count = pool.liveCount;
+        SDL_AtomicUnlock(&poolLock);
+        return count;
     }
 };
 
+template<typename Type, typename... Args>
+typename GfxObjectRegistry<Type, Args...>::Pool GfxObjectRegistry<Type, Args...>::pool;
+
+template<typename Type, typename... Args>
+SDL_SpinLock GfxObjectRegistry<Type, Args...>::poolLock;
+
+template<typename Type, typename... Args>
+eastl::vector<Type*> GfxObjectRegistry<Type, Args...>::stagedDestroys;
+
 template<typename Type, typename... Args>
 eastl::vector<Type*> GfxObjectRegistry<Type, Args...>::objectsToDestroy[RG_MAX_FRAMES_IN_FLIGHT];
 
@@ -168,7 +459,7 @@ enum GfxMemoryType
 // Note:
 // GfxBuffer will always be for static data or shader writable data,
 // cpu updatable dynamic data can be stored in FrameAllocator
-struct GfxBuffer : GfxObjectRegistry<GfxBuffer, GfxMemoryType, void*, rgSize, GfxBufferUsage>
+struct GfxBuffer : GfxObjectRegistry<GfxBuffer, GfxMemoryType, void const*, rgSize, GfxBufferUsage>
 {
     rgSize          size;
     GfxBufferUsage  usage; // TODO: This doesn't seem to be required in Metal & D3D12 backends.. remove?
@@ -182,9 +473,11 @@ struct GfxBuffer : GfxObjectRegistry<GfxBuffer, GfxMemoryType, void*, rgSize, Gf
 #elif defined(RG_VULKAN_RNDR)
     VkBuffer        vkBuffers[RG_MAX_FRAMES_IN_FLIGHT];
     VmaAllocation   vmaAlloc;
+#elif defined(RG_NULL_RNDR)
+    void*           nullMemory; // CPU memory backing the buffer
 #endif
 
-    static void fillStruct(GfxMemoryType memoryType, void* buf, rgSize size, GfxBufferUsage usage, GfxBuffer* obj)
+    static void fillStruct(GfxMemoryType memoryType, void const* buf, rgSize size, GfxBufferUsage usage, GfxBuffer* obj)
     {
         obj->size = size;
         obj->usage = usage;
@@ -193,7 +486,7 @@ struct GfxBuffer : GfxObjectRegistry<GfxBuffer, GfxMemoryType, void*, rgSize, Gf
     }
     
     // TODO: should change to first size then buffer??
-    static void createGfxObject(const char* tag, GfxMemoryType memoryType, void* buf, rgSize size, GfxBufferUsage usage, GfxBuffer* obj);
+    static void createGfxObject(const char* tag, GfxMemoryType memoryType, void const* buf, rgSize size, GfxBufferUsage usage, GfxBuffer* obj);
     static void destroyGfxObject(GfxBuffer* obj);
     
     void*   mappedMemory;
@@ -255,7 +548,7 @@ struct GfxTexture : GfxObjectRegistry<GfxTexture, GfxTextureDim, u32, u32, TinyI
     TinyImageFormat format;
     u32             mipmapCount;
     GfxTextureUsage usage;
-    u32             texID;
+    u32             texID; // Bindless slot of sampleable 2D textures, kInvalidValue otherwise
 
 #if defined(RG_D3D12_RNDR)
     ComPtr<ID3D12Resource>          d3dResource;
@@ -265,6 +558,8 @@ struct GfxTexture : GfxObjectRegistry<GfxTexture, GfxTextureDim, u32, u32, TinyI
 #elif defined(RG_VULKAN_RNDR)
     VkImage vkTexture;
     VmaAllocation vmaAlloc;
+#elif defined(RG_NULL_RNDR)
+    void*           nullMemory; // CPU memory backing all the slices and mips
 #endif
     
     static u32 calcMipmapCount(GfxTextureMipFlag mipFlag, u32 width, u32 height)
@@ -300,6 +595,8 @@ struct GfxTexture : GfxObjectRegistry<GfxTexture, GfxTextureDim, u32, u32, TinyI
 
     static void createGfxObject(char const* tag, GfxTextureDim dim, u32 width, u32 height, TinyImageFormat format, GfxTextureMipFlag mipFlag, GfxTextureUsage usage, ImageSlice* slices, GfxTexture* obj);
     static void destroyGfxObject(GfxTexture* obj);
+    static void onCreate(GfxTexture* obj); // Stores it in g_BindlessTextureManager
+    static void onDestroy(GfxTexture* obj);
 };
 
 // Sampler
@@ -597,6 +894,8 @@ struct GfxRenderCmdEncoder
     void bindSamplerState(char const* bindingTag, GfxSamplerState* sampler);
     
     void drawTexturedQuads(TexturedQuads* quads, Matrix4 const* viewMatrix, Matrix4 const* projectionMatrix);
+    void drawTexturedQuadsInstanced(TexturedQuads* quads, Matrix4 const* viewMatrix, Matrix4 const* projectionMatrix); // Needs a vsSimple2dInstanced PSO
+    void drawSpriteBatch(SpriteBatch* batch, Matrix4 const* viewMatrix, Matrix4 const* projectionMatrix); // Needs a vsSimple2dInstanced PSO
     void drawTriangles(u32 vertexStart, u32 vertexCount, u32 instanceCount);
     void drawIndexedTriangles(u32 indexCount, rgBool is32bitIndex, GfxBuffer const* indexBuffer, u32 bufferOffset, u32 instanceCount);
     void drawIndexedTriangles(u32 indexCount, rgBool is32bitIndex, GfxFrameResource const* indexBufferResource, u32 instanceCount);
@@ -685,20 +984,71 @@ struct GfxBlitCmdEncoder
 // GFX FUNCTIONS
 //-----------------------------------------------------------------------------
 
+// Frame stats
+// -----------
+
+struct GfxFrameStats
+{
+    u32 drawCalls;          // Every draw issued by the render cmd encoders
+    u32 texturedQuads;
+    u32 texturedQuadDraws;  // Draws issued by drawTexturedQuads*() and drawSpriteBatch()
+    u32 spriteBatchUploads; // Sprite instances re-written by SpriteBatch::prepareForDraw()
+    u32 texturedQuadsCulled;// Quads skipped by cullTexturedQuads() and TexturedQuadGrid, texturedQuads are the visible ones
+};
+
+extern GfxFrameStats g_FrameStats; // Frame being recorded, counted on the render thread
+
 // Common functions
 // ----------------
 
 i32                     gfxPreInit();
 i32                     gfxPostInit();
+void                    gfxPostDestroy(); // After gfxDestroy(), releases what gfxPreInit()/gfxPostInit() made and every Gfx object left
 void                    gfxAtFrameStart();
+void                    gfxAtFrameEnd(); // Ends the open cmd encoder, call before gfxEndFrame()
 i32                     gfxGetFrameIndex(); // Returns 0 if g_FrameIndex is -1
 i32                     gfxGetPrevFrameIndex();
 GfxFrameAllocator*      gfxGetFrameAllocator();
+GfxFrameAllocator*      gfxGetRingAllocator(); // Allocations live for RG_MAX_FRAMES_IN_FLIGHT frames, made on first use
+GfxFrameAllocator*      gfxFindRingAllocator(); // nullptr while nothing asked for the ring allocator
+GfxFrameAllocatorStats  gfxGetFrameAllocatorStats(); // Combined stats of the per frame allocators
+GfxFrameStats const*    gfxGetLastFrameStats(); // Stats of the previous frame, g_FrameStats is reset in gfxAtFrameStart()
 
 GfxRenderCmdEncoder*    gfxSetRenderPass(char const* tag, GfxRenderPass* renderPass);
 GfxComputeCmdEncoder*   gfxSetComputePass(char const* tag);
 GfxBlitCmdEncoder*      gfxSetBlitPass(char const* tag);
 
+// Transient textures
+// ------------------
+
+// NOTE: Pool of 2D render targets which only live within a frame. Acquire
+// returns an idle texture with the same width, height, format and usage, or
+// creates one. A released texture can be handed out again later in the same
+// frame, so passes whose textures don't overlap share them, and the pool's
+// textures carry over to the next frames. Textures still held at frame start
+// go back to the pool, idle ones are destroyed after a while, which also drops
+// the ones left at the old size when the window is resized.
+// Where the backend can place textures in a heap, a new texture is placed at
+// an offset no texture in use overlaps, so it can alias the memory of released
+// ones whatever their format. A texture is only handed out while none of the
+// textures sharing its memory is in use. Elsewhere textures are committed and
+// only same-format reuse saves memory. Release what you acquire as soon as the
+// last pass using it is recorded, later acquires can then alias it.
+// Render thread only.
+
+struct GfxTransientTextureStats
+{
+    rgSize requestedBytes;  // Sum of the sizes of every acquire in the last frame
+    rgSize usedBytes;       // Memory which served them, aliased textures count their shared memory once
+    rgSize savedBytes;      // requestedBytes - usedBytes
+    rgSize allocatedBytes;  // Memory of every texture in the pool, idle ones included
+    u32    textureCount;
+};
+
+GfxTexture*             gfxAcquireTransientTexture(char const* tag, u32 width, u32 height, TinyImageFormat format, GfxTextureUsage usage);
+void                    gfxReleaseTransientTexture(GfxTexture* texture);
+GfxTransientTextureStats gfxGetTransientTextureStats(); // Stats of the previous frame
+
 
 // API specific implementation functions
 // -------------------------------------
@@ -712,7 +1062,7 @@ void            gfxRunOnFrameBeginJob();
 
 void            gfxRendererImGuiInit();
 void            gfxRendererImGuiNewFrame();
-void            gfxRendererImGuiRenderDrawData();
+void            gfxRendererImGuiRenderDrawData(ImDrawData* drawData);
 
 void            gfxOnSizeChanged();
 
@@ -721,6 +1071,15 @@ GfxTexture*     gfxGetBackbufferTextureLinear();
 
 TinyImageFormat gfxGetBackbufferFormat();
 
+// Placed textures of the transient pool. Backends that can't place textures
+// return false from gfxCreateTransientTextureHeap() and never get the others
+// called. gfxGetTransientTexturePlacement() is false for textures the heap can't take.
+rgBool          gfxCreateTransientTextureHeap(rgSize sizeInBytes);
+void            gfxDestroyTransientTextureHeap(); // After every texture placed in it is destroyed
+rgBool          gfxGetTransientTexturePlacement(u32 width, u32 height, TinyImageFormat format, GfxTextureUsage usage, rgSize* outSizeInBytes, rgSize* outAlignment);
+GfxTexture*     gfxCreatePlacedTransientTexture(char const* tag, u32 width, u32 height, TinyImageFormat format, GfxTextureUsage usage, rgSize heapOffset);
+void            gfxBeginTransientTextureAliasing(GfxTexture* texture); // Before a placed texture's first use, and whenever its memory may hold another texture since
+
 
 //-----------------------------------------------------------------------------
 // GFX HELPER CLASSES
@@ -729,110 +1088,155 @@ TinyImageFormat gfxGetBackbufferFormat();
 // Bindless-Resource Manager
 // -------------------------
 
+// NOTE: Dense table of the resources in the shaders' bindless arrays, the slot
+// is the index the shaders use. A released slot is reused only after
+// RG_MAX_FRAMES_IN_FLIGHT frames, so frames in flight never see another resource
+// in it, and every release bumps the slot's generation.
+// Every public function takes the lock, store() also holds it across
+// gfxSetBindlessResource() as the backends' bindless tables aren't thread safe.
 template<typename Type>
 class GfxBindlessResourceManager
 {
-    typedef eastl::vector<Type*> ResourceList;
-    ResourceList resources; // Hold reference to the resources until no longer needed
+    struct Slot
+    {
+        Type*   ptr;
+        u32     generation;
+    };
 
-    typedef eastl::vector<u32> SlotList;
-    SlotList freeSlots; // Indexes in referenceList which are unused
-    
-    typedef eastl::hash_map<Type*, u32> ResourcePtrSlotMapType;
-    ResourcePtrSlotMapType resourcePtrSlotMap;
+    typedef eastl::vector<Slot> SlotList;
+    SlotList slots;
+
+    eastl::vector<u32> freeSlots; // Unused and safe to reuse
+    eastl::vector<u32> releasedSlots; // Released since the last frame start
+    eastl::vector<u32> retiredSlots[RG_MAX_FRAMES_IN_FLIGHT]; // Released before the start of the frame with that index
 
-    u32 getFreeSlot()
+    SDL_SpinLock lock;
+
+    u32 allocateSlots(u32 count)
     {
-        u32 result = kInvalidValue;
+        rgAssert(count > 0);
 
-        if(!freeSlots.empty())
+        if(count == 1 && !freeSlots.empty())
         {
-            result = freeSlots.back();
+            u32 slot = freeSlots.back();
             freeSlots.pop_back();
+            return slot;
         }
-        else
+
+        // Look for a run of count consecutive free slots before growing the table
+        if(count > 1 && freeSlots.size() >= count)
         {
-            rgAssert(resources.size() < UINT32_MAX);
-            result = (u32)resources.size();
-            resources.resize(result + 1); // push_back(nullptr) ?
+            eastl::sort(freeSlots.begin(), freeSlots.end());
+            u32 runLength = 1;
+            for(u32 i = 1; i < (u32)freeSlots.size(); ++i)
+            {
+                runLength = (freeSlots[i] == freeSlots[i - 1] + 1) ? runLength + 1 : 1;
+                if(runLength == count)
+                {
+                    u32 runBegin = i + 1 - count;
+                    u32 firstSlot = freeSlots[runBegin];
+                    freeSlots.erase(freeSlots.begin() + runBegin, freeSlots.begin() + i + 1);
+                    return firstSlot;
+                }
+            }
         }
 
-        rgAssert(result != kInvalidValue);
-        return result;
+        u32 firstSlot = (u32)slots.size();
+        rgAssert(firstSlot + count <= RG_MAX_BINDLESS_TEXTURE_RESOURCES);
+        slots.resize(firstSlot + count, Slot{nullptr, 0});
+        return firstSlot;
     }
 
-    void releaseSlot(u32 slot)
+public:
+    GfxBindlessResourceManager()
+    : lock(0)
     {
-        rgAssert(slot < resources.size());
-
-        resources[slot] = nullptr;
-        freeSlots.push_back(slot);
-        typename ResourcePtrSlotMapType::iterator itr = resourcePtrSlotMap.find(slot);
-        rgAssert(itr != resourcePtrSlotMap.end());
-        resourcePtrSlotMap.erase(itr);
+        slots.reserve(1024);
     }
 
-    void setResourcePtrInSlot(u32 slot, Type* ptr)
+    u32 store(Type* ptr)
     {
-        rgAssert(ptr);
-        rgAssert(slot != UINT32_MAX);
-        resources[slot] = ptr;
-        resourcePtrSlotMap.insert(eastl::make_pair(ptr, slot));
-        gfxSetBindlessResource(slot, ptr);
-        // TODO: make sure we're not updating a resource in flight
-        // this should be implictly handled from _releaseSlot
+        return storeContiguous(&ptr, 1);
     }
 
-    u32 getSlotOfResourcePtr(Type* ptr)
+    // Returns the first of count consecutive slots holding ptrs[0..count), store() is the single slot case
+    u32 storeContiguous(Type* const* ptrs, u32 count)
     {
-        typename ResourcePtrSlotMapType::iterator itr = resourcePtrSlotMap.find(ptr);
-        if(itr != resourcePtrSlotMap.end())
+        SDL_AtomicLock(&lock);
+        u32 firstSlot = allocateSlots(count);
+        for(u32 i = 0; i < count; ++i)
         {
-            return itr->second;
+            rgAssert(ptrs[i] != nullptr);
+            slots[firstSlot + i].ptr = ptrs[i];
+            gfxSetBindlessResource(firstSlot + i, ptrs[i]);
         }
-        return kInvalidValue;
+        SDL_AtomicUnlock(&lock);
+        return firstSlot;
     }
 
-public:
-    typename ResourceList::iterator begin() EA_NOEXCEPT
+    void release(u32 slot)
     {
-        return resources.begin();
+        SDL_AtomicLock(&lock);
+        rgAssert(slot < slots.size() && slots[slot].ptr != nullptr);
+        slots[slot].ptr = nullptr;
+        ++slots[slot].generation;
+        releasedSlots.push_back(slot);
+        SDL_AtomicUnlock(&lock);
     }
 
-    typename ResourceList::iterator end() EA_NOEXCEPT
+    // Called at the start of a frame, once the GPU is done with the last frame that used this index
+    void recycleRetiredSlots(i32 frameIndex)
     {
-        return resources.end();
+        SDL_AtomicLock(&lock);
+        eastl::vector<u32>& retired = retiredSlots[frameIndex];
+        freeSlots.insert(freeSlots.end(), retired.begin(), retired.end());
+        retired.clear();
+        // Slots released since the last frame start may still be read by the previous frame
+        retired.swap(releasedSlots);
+        SDL_AtomicUnlock(&lock);
     }
-    
-    // When it is known that the resource is not already stored
-    u32 store(Type* ptr)
+
+    Type* getPtr(u32 slot)
     {
-        u32 slot = getFreeSlot();
-        setResourcePtrInSlot(slot, ptr);
-        return slot;
+        SDL_AtomicLock(&lock);
+        rgAssert(slot < slots.size());
+        Type* ptr = slots[slot].ptr;
+        SDL_AtomicUnlock(&lock);
+        return ptr;
     }
-    
-    // When it is not known whether the resource is already stored or not
-    u32 storeIfNotPresent(Type* ptr)
+
+    // Bumped on every release, a texID kept across frames is stale once its generation changes
+    u32 getGeneration(u32 slot)
     {
-        u32 slot = getSlotOfResourcePtr(ptr);
-        if(slot == kInvalidValue)
+        SDL_AtomicLock(&lock);
+        rgAssert(slot < slots.size());
+        u32 generation = slots[slot].generation;
+        SDL_AtomicUnlock(&lock);
+        return generation;
+    }
+
+    // Runs check(i, ptr, generation) on the slot slotAt(i) returns, for i in [0, count), with
+    // the lock taken once, so validations over whole lists don't take it per element
+    template<typename SlotAt, typename Check>
+    void validateSlots(u32 count, SlotAt slotAt, Check check)
+    {
+        SDL_AtomicLock(&lock);
+        for(u32 i = 0; i < count; ++i)
         {
-            slot = getFreeSlot();
-            setResourcePtrInSlot(slot, ptr);
+            u32 slot = slotAt(i);
+            rgAssert(slot < slots.size());
+            check(i, slots[slot].ptr, slots[slot].generation);
         }
-        return slot;
+        SDL_AtomicUnlock(&lock);
     }
 
-    Type* getPtr(u32 slot)
+    u32 getSlotCount()
     {
-        rgAssert(slot < resources.size());
-
-        Type* ptr = resources[slot];
-        return ptr;
+        SDL_AtomicLock(&lock);
+        u32 count = (u32)slots.size();
+        SDL_AtomicUnlock(&lock);
+        return count;
     }
-
-    // TODO: u32 getContiguousFreeSlots(int count);
 };
 
 
@@ -856,35 +1260,163 @@ struct GfxFrameResource
     void* mtlTexture; //type: id<MTLTexture>
 #elif defined(RG_D3D12_RNDR)
     ComPtr<ID3D12Resource> d3dResource;
+#elif defined(RG_NULL_RNDR)
+    void* nullMemory; // points inside the frame allocator's heap
 #endif
 };
 
+// NOTE: Bump allocates transient buffers and textures from a heap. A request
+// that doesn't fit goes to an overflow block chained for the rest of the frame
+// instead of failing. Per frame allocators are reset at the start of their frame
+// index, with autoGrow a frame that overflowed recreates the heap big enough
+// for it. Ring allocators keep the allocations of a frame for ringLifetimeInFrames
+// frames, then reuse the space, for streaming data that outlives a frame.
+struct GfxFrameAllocatorStats
+{
+    u32 capacity;           // Size of the main heap
+    u32 lastFrameSize;      // Bytes allocated between the last two resets, overflow and backend texture heaps included
+    u32 highWaterMark;      // Largest lastFrameSize so far
+    u32 overflowFrameCount; // Frames that needed overflow blocks or committed textures
+    u32 growCount;
+};
+
 class GfxFrameAllocator
 {
+public:
+    enum Mode
+    {
+        Mode_PerFrame,
+        Mode_Ring,
+    };
+
 protected:
+    struct Allocation
+    {
+        u32 block; // 0 is the main heap, i is overflow block i - 1
+        u32 offset;
+    };
+
+    struct OverflowBlock
+    {
+        u32 size;
+        u32 offset;
+    };
+
+    // A frame a ring allocator still keeps alive, with what it allocated
+    struct RingSpan
+    {
+        u32 endOffset;
+        u32 resourceCount;
+        u32 overflowBlockCount;
+    };
+
+    Mode    mode;
+    rgBool  autoGrow;
+    u32     ringLifetimeInFrames;
+
     u32 offset;
     u32 capacity;
+    u32 ringTail; // Start of the oldest live allocation, offset < ringTail when the head wrapped around
+    eastl::vector<OverflowBlock> overflowBlocks;
+    eastl::vector<RingSpan> ringSpans; // Oldest first
+
+    u32 frameFirstResource;
+    u32 frameFirstOverflowBlock; // Blocks before it belong to older frames and take no new allocations
+    u32 frameSize;
+    u32 frameOverflowSize;
+    u32 frameTextureSize; // Textures placed outside the main heap by the backend, D3D12 only
+    u32 frameTextureOverflowSize; // Part of frameTextureSize that didn't fit in its heap
+    GfxFrameAllocatorStats stats;
+
 #if defined(RG_METAL_RNDR)
     void* heap; //type: id<MTLHeap>
+    eastl::vector<void*> overflowHeaps; //type: id<MTLHeap>
     eastl::vector<void*> mtlResources;
 #elif defined(RG_D3D12_RNDR)
     ComPtr<ID3D12Heap> d3dBufferHeap;
     ComPtr<ID3D12Heap> d3dNonRTDSTextureHeap;
     ComPtr<ID3D12Heap> d3dRTDSTextureHeap;
+    u32 d3dNonRTDSTextureHeapSize;
+    u32 d3dRTDSTextureHeapSize;
+    u32 d3dNonRTDSTextureHeapOffset; // Bumped by newTexture2D(), back to 0 once all the resources are released
+    u32 d3dRTDSTextureHeapOffset;
+    u32 d3dNonRTDSTextureFrameSize; // Where the offsets would be if the heaps had room for all of the frame
+    u32 d3dRTDSTextureFrameSize;
+    eastl::vector<ComPtr<ID3D12Heap>> d3dOverflowBufferHeaps;
     eastl::vector<ComPtr<ID3D12Resource>> d3dResources;
 #else
     void* heap;
+    eastl::vector<void*> overflowHeaps;
 #endif
     
+    // Implemented by the backends, capacity is the size of the heap bumpStorageAligned() works on
     void create(u32 bufferHeapSize, u32 nonRTDSTextureHeapSize, u32 rtDSTextureHeapSize);
     void destroy();
-    void releaseResources();
+    void recreateHeap(u32 newCapacity); // Only called while the main heap has no resources in it
+    void createOverflowBlock(u32 size);
+    void releaseOverflowBlocks(u32 count); // Oldest count blocks
+    void releaseResources(u32 count); // Oldest count resources
+    u32  getResourceCount();
+    void resetTextureHeaps(rgBool grow); // At every reset(), with grow the texture heaps that overflowed are recreated big enough
+
+    Allocation allocate(u32 size, u32 alignment)
+    {
+        // Padded the way bumpStorageAligned() pads, so in the per frame mode this is where
+        // offset would end if the main heap had room for all of the frame
+        u32 const alignedSize = (size + alignment - 1) & ~(alignment - 1);
+        frameSize = ((frameSize + alignment - 1) & ~(alignment - 1)) + size;
+
+        Allocation result;
+        result.block = 0;
+        result.offset = bumpStorageAligned(size, alignment);
+        if(result.offset != kInvalidValue)
+        {
+            return result;
+        }
+
+        if(frameOverflowSize == 0)
+        {
+            rgLogWarn("GfxFrameAllocator is out of its %u bytes, chaining overflow blocks", capacity);
+        }
+        frameOverflowSize += alignedSize;
+
+        OverflowBlock* block = (overflowBlocks.size() > frameFirstOverflowBlock) ? &overflowBlocks.back() : nullptr;
+        u32 alignedStartOffset = (block != nullptr) ? (block->offset + alignment - 1) & ~(alignment - 1) : 0;
+        if(block == nullptr || (u64)alignedStartOffset + size > block->size)
+        {
+            u32 blockSize = eastl::max(size, capacity / 4);
+            createOverflowBlock(blockSize);
+            overflowBlocks.push_back(OverflowBlock{blockSize, 0});
+            block = &overflowBlocks.back();
+            alignedStartOffset = 0;
+        }
+        block->offset = alignedStartOffset + size;
+
+        result.block = (u32)overflowBlocks.size();
+        result.offset = alignedStartOffset;
+        return result;
+    }
+
 public:
-    GfxFrameAllocator(u32 bufferHeapSize, u32 nonRTDSTextureHeapSize, u32 rtDSTextureHeapSize)
-    : offset(0)
-    , capacity(0) // TODO: Use this to prevent overflow.. // TODO: Use this to prevent overflow
+    GfxFrameAllocator(u32 bufferHeapSize, u32 nonRTDSTextureHeapSize, u32 rtDSTextureHeapSize, Mode mode = Mode_PerFrame, u32 ringLifetimeInFrames = RG_MAX_FRAMES_IN_FLIGHT)
+    : mode(mode)
+    , autoGrow(mode == Mode_PerFrame)
+    , ringLifetimeInFrames(ringLifetimeInFrames)
+    , offset(0)
+    , capacity(0)
+    , ringTail(0)
+    , frameFirstResource(0)
+    , frameFirstOverflowBlock(0)
+    , frameSize(0)
+    , frameOverflowSize(0)
+    , frameTextureSize(0)
+    , frameTextureOverflowSize(0)
+    , stats()
     {
+        // Ring space is reused at a frame start, the GPU must be done with the frame that used it
+        rgAssert(mode != Mode_Ring || ringLifetimeInFrames >= RG_MAX_FRAMES_IN_FLIGHT);
         create(bufferHeapSize, nonRTDSTextureHeapSize, rtDSTextureHeapSize);
+        stats.capacity = capacity;
     }
     
     ~GfxFrameAllocator()
@@ -892,11 +1424,36 @@ public:
         destroy();
     }
     
+    // kInvalidValue if the main heap has no room left
     u32 bumpStorageAligned(u32 s, u32 a)
     {
+        if(mode == Mode_Ring && offset == ringTail)
+        {
+            // Nothing is alive, start over from the beginning. The frames still
+            // kept have no allocations left, their end moves along
+            offset = 0;
+            ringTail = 0;
+            for(RingSpan& span : ringSpans)
+            {
+                span.endOffset = 0;
+            }
+        }
+
         u32 unalignedStartOffset = offset;
         u32 alignedStartOffset = (unalignedStartOffset + a - 1) & ~(a - 1);
-        
+
+        // The head of a wrapped ring stops before ringTail, so offset == ringTail always means empty
+        u64 limit = (mode == Mode_Ring && offset < ringTail) ? ringTail - 1 : capacity;
+        if((u64)alignedStartOffset + s > limit)
+        {
+            if(mode != Mode_Ring || offset < ringTail || s >= ringTail)
+            {
+                return kInvalidValue;
+            }
+            // Wrap around, the rest of the heap is skipped
+            alignedStartOffset = 0;
+        }
+
         // bump 'offset'
         offset = alignedStartOffset + s;
         
@@ -904,12 +1461,86 @@ public:
     }
     
     GfxFrameResource newBuffer(const char* tag, u32 size, void* initialData);
+    // Returns the CPU write pointer in outMappedPtr, valid for this frame. The memory
+    // can be write-combined, write it sequentially and never read it back.
+    GfxFrameResource newBufferMapped(const char* tag, u32 size, void** outMappedPtr);
     GfxFrameResource newTexture2D(const char* tag, void* initialData, u32 width, u32 height, TinyImageFormat format, GfxTextureUsage usage);
 
+    // Called at frame start, after the GPU is done with the frame that last used what is released
     void reset()
     {
-        offset = 0;
-        releaseResources();
+        stats.lastFrameSize = frameSize + frameTextureSize;
+        stats.highWaterMark = eastl::max(stats.highWaterMark, stats.lastFrameSize);
+        stats.overflowFrameCount += (frameOverflowSize > 0 || frameTextureOverflowSize > 0) ? 1 : 0;
+
+        if(mode == Mode_PerFrame)
+        {
+            releaseResources(getResourceCount());
+            releaseOverflowBlocks((u32)overflowBlocks.size());
+            overflowBlocks.clear();
+
+            if(frameOverflowSize > 0 && autoGrow)
+            {
+                // Grow so that the same workload fits next time, frameSize has all the padding
+                u32 newCapacity = eastl::max(capacity, 1u);
+                while(newCapacity < frameSize)
+                {
+                    newCapacity *= 2;
+                }
+                rgLogWarn("GfxFrameAllocator overflowed by %u bytes, growing from %u to %u bytes", frameOverflowSize, capacity, newCapacity);
+                recreateHeap(newCapacity);
+                ++stats.growCount;
+            }
+
+            rgBool growTextureHeaps = frameTextureOverflowSize > 0 && autoGrow;
+            resetTextureHeaps(growTextureHeaps);
+            stats.growCount += growTextureHeaps ? 1 : 0;
+            offset = 0;
+        }
+        else
+        {
+            RingSpan span;
+            span.endOffset = offset;
+            span.resourceCount = getResourceCount() - frameFirstResource;
+            span.overflowBlockCount = (u32)overflowBlocks.size() - frameFirstOverflowBlock;
+            ringSpans.push_back(span);
+
+            while(ringSpans.size() >= ringLifetimeInFrames)
+            {
+                RingSpan const& oldest = ringSpans.front();
+                ringTail = oldest.endOffset;
+                releaseResources(oldest.resourceCount);
+                releaseOverflowBlocks(oldest.overflowBlockCount);
+                overflowBlocks.erase(overflowBlocks.begin(), overflowBlocks.begin() + oldest.overflowBlockCount);
+                ringSpans.erase(ringSpans.begin());
+            }
+
+            // Live data can't move, a ring doesn't grow
+            if(frameOverflowSize > 0)
+            {
+                rgLogWarn("GfxFrameAllocator ring overflowed by %u bytes, make it bigger than %u bytes", frameOverflowSize, capacity);
+            }
+            resetTextureHeaps(false);
+        }
+
+        frameFirstResource = getResourceCount();
+        frameFirstOverflowBlock = (u32)overflowBlocks.size();
+        frameSize = 0;
+        frameOverflowSize = 0;
+        frameTextureSize = 0;
+        frameTextureOverflowSize = 0;
+        stats.capacity = capacity;
+    }
+
+    void setAutoGrow(rgBool enable)
+    {
+        rgAssert(mode == Mode_PerFrame || !enable);
+        autoGrow = enable;
+    }
+
+    GfxFrameAllocatorStats const& getStats() const
+    {
+        return stats;
     }
     
     // TODO: Remove this function. We can directly access the respective heap resource var
@@ -939,6 +1570,8 @@ struct GfxState
     static GfxSamplerState* samplerTrilinearClampEdgeAniso;
     static GfxSamplerState* samplerNearestRepeat;
     static GfxSamplerState* samplerNearestClampEdge;
+
+    static GfxBuffer* quadIndexBuffer; // 16 bit indices for kMaxTexturedQuadsPerDraw quads of 4 vertices
 };
 
 extern GfxBindlessResourceManager<GfxTexture>* g_BindlessTextureManager;
@@ -983,15 +1616,49 @@ ImageRef    loadImage(char const* filename, bool srgbFormat = true);
 void        unloadImage(Image* ptr);
 
 
+// Texture Cache
+// -------------
+// NOTE: 2D textures loaded from image files, shared by every caller asking for
+// the same file with the same flags. Entries are keyed by rgCRC32 of the
+// normalized path and the flags, the cache holds one reference to each and
+// the ones nobody else references are destroyed at frame start. Safe to call
+// from loader threads, two threads missing on the same file at once both
+// decode it and the loser's texture is dropped.
+enum TextureLoadFlags
+{
+    TextureLoadFlags_None = 0,
+    TextureLoadFlags_SRGB = (1 << 0),
+    TextureLoadFlags_GenMips = (1 << 1), // DDS files use the mips they were saved with instead
+};
+
+RG_DEFINE_ENUM_FLAGS_OPERATOR(TextureLoadFlags);
+
+typedef eastl::shared_ptr<GfxTexture> TextureRef;
+
+struct TextureCacheStats
+{
+    u32 hits;
+    u32 misses;
+    u32 evictions;
+    u32 entryCount;
+};
+
+// Returns nullptr if the file can't be loaded
+TextureRef  loadTexture(char const* filename, TextureLoadFlags flags = TextureLoadFlags_SRGB | TextureLoadFlags_GenMips);
+void        evictUnusedTextures();
+void        clearTextureCache(); // At exit, drops the cache's own references
+TextureCacheStats getTextureCacheStats();
+
+
 // Default Material
 // ----------------
 
 struct DefaultMaterial
 {
     rgChar      tag[32];
-    GfxTexture* diffuseAlpha;
-    GfxTexture* normal;
-    GfxTexture* properties;
+    TextureRef  diffuseAlpha;
+    TextureRef  normal;
+    TextureRef  properties;
     
     typedef eastl::hash_map<rgHash, DefaultMaterial*> LoadedMaterialsType;
     static LoadedMaterialsType s_LoadedMaterials;
@@ -1075,18 +1742,48 @@ enum SpriteLayer : u8
     SpriteLayer_7,
     SpriteLayer_8,
     SpriteLayer_9,
+    SpriteLayer_Count,
 };
 
-struct TexturedQuad
+// Append-only SoA storage of the quads pushed to one layer
+struct TexturedQuadBucket
 {
-    QuadUV uv;
-    u32 texID;
-    rgFloat3 pos;
-    u32 color;
-    rgFloat4 offsetOrientation;
-    rgFloat2 size;
+    FrameVector<rgFloat3>   pos;
+    FrameVector<rgFloat2>   size;
+    FrameVector<QuadUV>     uv;
+    FrameVector<u32>        color;
+    FrameVector<u32>        texID;
+    FrameVector<rgFloat2>   offset;
+    FrameVector<f32>        orientation;
+    FrameVector<u32>        order; // Draw list filled by sortTexturedQuads() and cullTexturedQuads()
+    rgBool                  useOrder = false; // Otherwise every quad draws in push order
+
+    u32 drawCount() const { return useOrder ? (u32)order.size() : (u32)pos.size(); }
 };
 
+// NOTE: Allocated from the frame arena, build it every frame
+// Layers are drawn in ascending order, quads of a layer in push order unless
+// sortByDepthAndTexture is set.
+struct TexturedQuads
+{
+    TexturedQuadBucket  layers[SpriteLayer_Count];
+    u32                 count = 0;
+    rgBool              sortByDepthAndTexture = false; // Radix sort each layer by (depth, texID) at submit, less texture switches but breaks the push order
+    rgBool              cullToView = true; // Skip the quads outside the camera rectangle at submit
+
+    u32 size() const { return count; }
+    u32 drawCount() const
+    {
+        u32 result = 0;
+        for(u32 l = 0; l < SpriteLayer_Count; ++l)
+        {
+            result += layers[l].drawCount();
+        }
+        return result;
+    }
+};
+
+// offsetOrientation is the pivot offset from pos, the rotation about it in radians, and the scale about it
 void pushTexturedQuad(TexturedQuads* quadList, SpriteLayer layer, QuadUV uv, rgFloat4 posSize, u32 color, rgFloat4 offsetOrientation, GfxTexture* tex);
 void pushTexturedLine(TexturedQuads* quadList, SpriteLayer layer, QuadUV uv, rgFloat2 pointA, rgFloat2 pointB, f32 thickness, u32 color, GfxTexture* tex);
 
@@ -1097,12 +1794,137 @@ struct SimpleVertexFormat
     unsigned char color[4];
 };
 
+// drawTexturedQuads() splits larger lists in several draws
+static const u32 kMaxTexturedQuadsPerDraw = 1024; // simple2d.hlsl MAX_INSTANCES
+
 struct SimpleInstanceParams
 {
-    u32 texParam[1024][4];
+    u32 texParam[kMaxTexturedQuadsPerDraw][4];
 };
 
-void genTexturedQuadVertices(TexturedQuads* quadList, eastl::vector<SimpleVertexFormat>* vertices, SimpleInstanceParams* instanceParams);
+// One record per quad for drawTexturedQuadsInstanced(), the corners are
+// expanded by vsSimple2dInstanced in simple2d.hlsl
+struct TexturedQuadInstance
+{
+    f32 pos[3];             // Top left corner, the pivot offset is folded in
+    f32 size[2];
+    f32 uvRect[4];          // uvTopLeft, uvBottomRight
+    unsigned char color[4];
+    i16 rotation[2];        // sin, cos as snorm16
+    u32 texID;
+};
+static_assert(sizeof(TexturedQuadInstance) == 48, "Update makeTexturedQuadInstanceInputDesc() and simple2d.hlsl");
+
+struct SimpleCameraParams
+{
+    f32 projection2d[16];
+    f32 view2d[16];
+};
+
+// Resets the draw lists then sorts and culls as flagged on the list, returns the number of quads to draw
+u32  prepareTexturedQuads(TexturedQuads* quadList, Matrix4 const* viewMatrix, Matrix4 const* projectionMatrix);
+void sortTexturedQuads(TexturedQuads* quadList); // Fills TexturedQuadBucket::order, stable within equal keys
+void cullTexturedQuads(TexturedQuads* quadList, Matrix4 const* viewMatrix, Matrix4 const* projectionMatrix); // Drops the quads whose rotated AABB is outside the view, keeps the order
+// The gen functions split the work over the job system and write each quad of the
+// draw lists once, in order, so the outputs can point straight into newBufferMapped() memory.
+// Quad i goes to batch i / kMaxTexturedQuadsPerDraw: 4 vertices at batchVertices[batch] and
+// its texID in batchInstanceParams[batch]->texParam, both at index i % kMaxTexturedQuadsPerDraw
+void genTexturedQuadVertices(TexturedQuads* quadList, SimpleVertexFormat* const* batchVertices, SimpleInstanceParams* const* batchInstanceParams);
+void genTexturedQuadInstances(TexturedQuads* quadList, TexturedQuadInstance* instances); // quadList->drawCount() instances
+void genSimpleCameraParams(Matrix4 const* viewMatrix, Matrix4 const* projectionMatrix, SimpleCameraParams* cameraParams); // nullptr selects the default window sized 2D camera
+
+GfxVertexInputDesc makeTexturedQuadInstanceInputDesc(); // Per instance layout of TexturedQuadInstance in slot 0
+
+// Textured Quad Grid
+// ------------------
+// NOTE: Retained uniform grid for large layers that don't move, e.g. level art.
+// pushVisibleQuads() only visits the cells overlapping the view, the pushed quads
+// still go through the per quad culling at submit. Cells are hashed, so the grid
+// is unbounded.
+class TexturedQuadGrid
+{
+public:
+    TexturedQuadGrid(f32 cellSize) : cellSize(cellSize), pushStamp(0) {}
+
+    void add(QuadUV uv, rgFloat4 posSize, u32 color, rgFloat4 offsetOrientation, GfxTexture* tex);
+    void clear();
+    void pushVisibleQuads(TexturedQuads* quadList, SpriteLayer layer, Matrix4 const* viewMatrix, Matrix4 const* projectionMatrix);
+
+    u32 size() const { return (u32)quads.size(); }
+
+protected:
+    struct Quad
+    {
+        QuadUV      uv;
+        rgFloat4    posSize;
+        u32         color;
+        rgFloat4    offsetOrientation;
+        GfxTexture* tex;
+        u32         lastPushStamp; // Quads spanning several cells are pushed once
+    };
+
+    f32 cellSize;
+    u32 pushStamp;
+    eastl::vector<Quad> quads;
+    eastl::hash_map<u64, eastl::vector<u32>> cells; // Quad indices by packed (x, y) cell coordinates
+};
+
+// Sprite Batch
+// ------------
+// NOTE: Retained quads for content that rarely changes, e.g. UI and level art.
+// Sprites live until removed, the batch keeps one instance buffer per frame in
+// flight and only writes the instances that changed since that buffer was last
+// used. Drawn in one instanced draw with drawSpriteBatch(). remove() moves the
+// last sprite into the hole, so the draw order isn't stable across removals.
+typedef u32 SpriteHandle;
+static const SpriteHandle kInvalidSpriteHandle = UINT32_MAX;
+
+class SpriteBatch
+{
+public:
+    SpriteBatch(char const* tag, u32 initialCapacity = 256);
+    ~SpriteBatch();
+
+    // The GfxTexture* versions don't own tex, it has to outlive the sprite. The TextureRef
+    // versions keep the texture alive while the sprite uses it, so evictUnusedTextures() leaves it
+    SpriteHandle add(QuadUV uv, rgFloat4 posSize, u32 color, rgFloat4 offsetOrientation, GfxTexture* tex);
+    SpriteHandle add(QuadUV uv, rgFloat4 posSize, u32 color, rgFloat4 offsetOrientation, TextureRef const& tex);
+    void update(SpriteHandle handle, QuadUV uv, rgFloat4 posSize, u32 color, rgFloat4 offsetOrientation, GfxTexture* tex);
+    void update(SpriteHandle handle, QuadUV uv, rgFloat4 posSize, u32 color, rgFloat4 offsetOrientation, TextureRef const& tex);
+    void remove(SpriteHandle handle);
+    void clear();
+
+    u32 size() const { return count; }
+
+    // Writes the dirty range to this frame's instance buffer and returns it, called by drawSpriteBatch()
+    GfxBuffer* prepareForDraw();
+
+protected:
+    void markDirty(u32 begin, u32 end);
+    void growTo(u32 minCapacity);
+
+    rgChar tag[RG_GFX_OBJECT_TAG_LENGTH];
+    u32 count;
+    u32 capacity;
+    eastl::vector<TexturedQuadInstance> instances; // CPU copy, capacity long
+    eastl::vector<TextureRef> instanceTextures; // Set for the sprites added with a TextureRef, capacity long
+    eastl::vector<u32> instanceToHandle;
+    eastl::vector<u32> handleToInstance;
+    eastl::vector<u32> freeHandles;
+#if defined(ENABLE_SLOW_GFX_RESOURCE_VALIDATIONS)
+    eastl::vector<u32> instanceTexGenerations; // Bindless slot generation of each instance's texID, kInvalidValue till prepareForDraw() records it
+#endif
+
+    struct FrameBuffer
+    {
+        GfxBuffer* buffer;
+        void* mappedMemory; // Stays mapped for the lifetime of the buffer
+        u32 capacity;
+        u32 dirtyBegin; // Instance range to write before the next draw from this buffer
+        u32 dirtyEnd;
+    };
+    FrameBuffer frameBuffers[RG_MAX_FRAMES_IN_FLIGHT];
+};
 
 
 //-----------------------------------------------------------------------------
@@ -1118,4 +1940,6 @@ Matrix4 makePerspectiveProjectionMatrix(f32 focalLength, f32 aspectRatio, f32 ne
 TinyImageFormat convertSRGBToLinearFormat(TinyImageFormat srgbFormat);
 TinyImageFormat convertLinearToSRGBFormat(TinyImageFormat linearFormat);
 
+rgSize  calcTextureSurfaceSizeInBytes(TinyImageFormat format, u32 width, u32 height); // Size of one mip of one face
+
 #endif
@@ -58,7 +58,10 @@ struct ResourceCopyTask
 eastl::vector<ResourceCopyTask> pendingBufferCopyTasks;
 eastl::vector<ResourceCopyTask> pendingTextureCopyTasks;
 
+// Uploads recorded on the render thread, submitted by gfxEndFrame(). Other threads
+// record and submit their own batch, see ScopedResourceUploader
 ResourceUploadBatch* resourceUploader;
+std::atomic<SDL_threadID> renderThreadID; // The thread running gfxStartNextFrame()
 
 //*****************************************************************************
 // Helper Functions
@@ -300,6 +303,7 @@ public:
         , frameUsedDescriptorCount()
         , cpuDescriptorHandle()
         , gpuDescriptorHandle()
+        , persistentLock(0)
     {
         totalDescriptorCount = persistentCount + (count * RG_MAX_FRAMES_IN_FLIGHT);
         descriptorHeap = createDescriptorHeap(type, totalDescriptorCount, flags);
@@ -318,11 +322,13 @@ public:
         // Free and release unused indices back to allocation pool
         frameUsedDescriptorCount[g_FrameIndex] = 0;
 
+        SDL_AtomicLock(&persistentLock);
         for(i32 i = 0, l = (i32)persistentIndicesToFree[g_FrameIndex].size(); i < l; ++i)
         {
             releasePersistentDescriptorIndex(persistentIndicesToFree[g_FrameIndex][i]);
         }
         persistentIndicesToFree[g_FrameIndex].clear();
+        SDL_AtomicUnlock(&persistentLock);
 
         // 
         tailOffset = persistentDescriptorCount + (maxPerFrameDescriptorCount * g_FrameIndex);
@@ -331,13 +337,16 @@ public:
 
     u32 allocatePersistentDescriptor()
     {
+        SDL_AtomicLock(&persistentLock);
         u32 index = allocatePersistentDescriptorIndex();
+        SDL_AtomicUnlock(&persistentLock);
         return index;
     }
 
     u32 allocatePersistentDescriptorRange(u32 count)
     {
         u32 descriptorStartOffset;
+        SDL_AtomicLock(&persistentLock);
 
         // TODO: We can't free range when count > 1
         // Create a Range(startoffset, count) based allocation system
@@ -355,9 +364,11 @@ public:
             descriptorStartOffset = freePersistentIndices.back();
             freePersistentIndices.pop_back();
         }
+        SDL_AtomicUnlock(&persistentLock);
         return descriptorStartOffset;
     }
 
+    // Render thread only, the per frame range isn't shared
     u32 allocateDescriptorRange(u32 count)
     {
         // TODO: verify these checks don't allow descriptor overwrite
@@ -373,7 +384,9 @@ public:
 
     void releasePersistentDescriptor(u32 index)
     {
+        SDL_AtomicLock(&persistentLock);
         releasePersistentDescriptorIndex(index);
+        SDL_AtomicUnlock(&persistentLock);
     }
 
     D3D12_GPU_DESCRIPTOR_HANDLE getGpuHandle(u32 index)
@@ -407,6 +420,7 @@ public:
 
 protected:
     
+    // Needs persistentLock
     u32 allocatePersistentDescriptorIndex()
     {
         u32 descriptorOffset;
@@ -443,6 +457,8 @@ protected:
     u32                   tailOffset;
     u32                   persistentHead;
 
+    // Loader threads create and destroy views, so the persistent range has a lock
+    SDL_SpinLock          persistentLock;
     eastl::vector<u32>    freePersistentIndices;
     eastl::vector<u32>    persistentIndicesToFree[RG_MAX_FRAMES_IN_FLIGHT];
 
@@ -459,11 +475,44 @@ DescriptorAllocator* stagedSamplerDescriptorAllocator;
 DescriptorAllocator* stagedRtvDescriptorAllocator;
 DescriptorAllocator* stagedDsvDescriptorAllocator;
 
+// The render thread's batch, or a batch of the calling thread's own that is
+// submitted and waited on when this goes out of scope
+class ScopedResourceUploader
+{
+public:
+    ScopedResourceUploader()
+    : ownBatch(nullptr)
+    {
+        batch = resourceUploader;
+        if(SDL_ThreadID() != renderThreadID.load(std::memory_order_relaxed))
+        {
+            ownBatch = rgNew(ResourceUploadBatch)(getDevice().Get());
+            ownBatch->Begin();
+            batch = ownBatch;
+        }
+    }
+
+    ~ScopedResourceUploader()
+    {
+        if(ownBatch != nullptr)
+        {
+            ownBatch->End(commandQueue.Get()).wait();
+            rgDelete(ownBatch);
+        }
+    }
+
+    ResourceUploadBatch* operator->() { return batch; }
+
+protected:
+    ResourceUploadBatch* batch;
+    ResourceUploadBatch* ownBatch;
+};
+
 //*****************************************************************************
 // GfxBuffer Implementation
 //*****************************************************************************
 
-void GfxBuffer::createGfxObject(char const* tag, GfxMemoryType memoryType, void* buf, rgSize size, GfxBufferUsage usage, GfxBuffer* obj)
+void GfxBuffer::createGfxObject(char const* tag, GfxMemoryType memoryType, void const* buf, rgSize size, GfxBufferUsage usage, GfxBuffer* obj)
 {
     rgAssert(size > 0);
 
@@ -515,7 +564,8 @@ void GfxBuffer::createGfxObject(char const* tag, GfxMemoryType memoryType, void*
         else if(memoryType == GfxMemoryType_Default)
         {
             D3D12_SUBRESOURCE_DATA initData = { buf, 0, 0 };
-            resourceUploader->Upload(bufferResource.Get(), 0, &initData, 1);
+            ScopedResourceUploader uploader;
+            uploader->Upload(bufferResource.Get(), 0, &initData, 1);
         }
     }
 
@@ -659,7 +709,52 @@ void GfxSamplerState::destroyGfxObject(GfxSamplerState* obj)
 // GfxTexture Implementation
 //*****************************************************************************
 
-static ComPtr<ID3D12Resource> createTextureResource(char const* tag, GfxTextureDim dim, u32 width, u32 height, TinyImageFormat format, GfxTextureMipFlag mipFlag, GfxTextureUsage usage, ImageSlice* slices)
+// Set by gfxCreatePlacedTransientTexture() around GfxTexture::create(), createGfxObject() places the texture with it
+static thread_local ID3D12Heap* texturePlacementHeap;
+static thread_local u64 texturePlacementOffset;
+
+static CD3DX12_RESOURCE_DESC makeTextureResourceDesc(GfxTextureDim dim, u32 width, u32 height, TinyImageFormat format, GfxTextureMipFlag mipFlag, GfxTextureUsage usage)
+{
+    DXGI_FORMAT textureFormat = (DXGI_FORMAT)TinyImageFormat_ToDXGI_FORMAT(format);
+    u32 mipmapLevelCount = GfxTexture::calcMipmapCount(mipFlag, width, height);
+
+    D3D12_RESOURCE_FLAGS resourceFlags = D3D12_RESOURCE_FLAG_NONE;
+    if(usage & GfxTextureUsage_RenderTarget)
+    {
+        resourceFlags |= D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
+    }
+    if(usage & GfxTextureUsage_DepthStencil)
+    {
+        resourceFlags |= D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
+    }
+    if(usage & GfxTextureUsage_ShaderReadWrite)
+    {
+        resourceFlags |= D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+    }
+
+    CD3DX12_RESOURCE_DESC resourceDesc = {};
+    switch(dim)
+    {
+    case GfxTextureDim_2D:
+    case GfxTextureDim_Cube:
+    {
+        u16 arraySize = (dim == GfxTextureDim_Cube) ? 6 : 1;
+        resourceDesc = CD3DX12_RESOURCE_DESC::Tex2D(textureFormat, width, height, arraySize, mipmapLevelCount, 1, 0, resourceFlags);
+    } break;
+
+    case GfxTextureDim_Buffer:
+    {
+        resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(width, resourceFlags);
+    } break;
+
+    default:
+        rgAssert(!"Unsupported texture dim");
+    }
+    return resourceDesc;
+}
+
+// With a placementHeap the texture is placed at placementOffset in it, instead of getting its own memory
+static ComPtr<ID3D12Resource> createTextureResource(char const* tag, GfxTextureDim dim, u32 width, u32 height, TinyImageFormat format, GfxTextureMipFlag mipFlag, GfxTextureUsage usage, ImageSlice* slices, ID3D12Heap* placementHeap = nullptr, u64 placementOffset = 0)
 {
     DXGI_FORMAT textureFormat = (DXGI_FORMAT)TinyImageFormat_ToDXGI_FORMAT(format);
     u32 mipmapLevelCount = GfxTexture::calcMipmapCount(mipFlag, width, height);
@@ -683,55 +778,47 @@ static ComPtr<ID3D12Resource> createTextureResource(char const* tag, GfxTextureD
     }
 
     rgBool isUAV = (usage & GfxTextureUsage_ShaderReadWrite);
-    D3D12_RESOURCE_FLAGS resourceFlags = D3D12_RESOURCE_FLAG_NONE;
     D3D12_RESOURCE_STATES initialState = (slices == nullptr) ? D3D12_RESOURCE_STATE_COMMON : D3D12_RESOURCE_STATE_COPY_DEST;
 
     if(usage & GfxTextureUsage_RenderTarget)
     {
         rgAssert(slices == nullptr);
-        resourceFlags |= D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
         initialState |= D3D12_RESOURCE_STATE_RENDER_TARGET;
     }
     if(usage & GfxTextureUsage_DepthStencil)
     {
         rgAssert(slices == nullptr);
-        resourceFlags |= D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
         initialState |= D3D12_RESOURCE_STATE_DEPTH_WRITE;
     }
 
     if(usage & GfxTextureUsage_ShaderReadWrite)
     {
-        resourceFlags |= D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
         initialState |= (slices == nullptr) ? D3D12_RESOURCE_STATE_UNORDERED_ACCESS : D3D12_RESOURCE_STATE_COMMON;
     }
 
-    CD3DX12_RESOURCE_DESC resourceDesc = {};
-    switch(dim)
-    {
-    case GfxTextureDim_2D:
-    case GfxTextureDim_Cube:
-    {
-        u16 arraySize = (dim == GfxTextureDim_Cube) ? 6 : 1;
-        resourceDesc = CD3DX12_RESOURCE_DESC::Tex2D(textureFormat, width, height, arraySize, mipmapLevelCount, 1, 0, resourceFlags);
-    } break;
+    CD3DX12_RESOURCE_DESC resourceDesc = makeTextureResourceDesc(dim, width, height, format, mipFlag, usage);
 
-    case GfxTextureDim_Buffer:
+    ComPtr<ID3D12Resource> textureResource;
+    if(placementHeap != nullptr)
     {
-        resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(width, resourceFlags);
-    } break;
-
-    default:
-        rgAssert(!"Unsupported texture dim");
+        BreakIfFail(getDevice()->CreatePlacedResource(
+            placementHeap,
+            placementOffset,
+            &resourceDesc,
+            initialState,
+            clearValue,
+            IID_PPV_ARGS(&textureResource)));
+    }
+    else
+    {
+        BreakIfFail(getDevice()->CreateCommittedResource(
+            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+            D3D12_HEAP_FLAG_NONE,
+            &resourceDesc,
+            initialState,
+            clearValue,
+            IID_PPV_ARGS(&textureResource)));
     }
-
-    ComPtr<ID3D12Resource> textureResource;
-    BreakIfFail(getDevice()->CreateCommittedResource(
-        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-        D3D12_HEAP_FLAG_NONE,
-        &resourceDesc,
-        initialState,
-        clearValue,
-        IID_PPV_ARGS(&textureResource)));
 
     setDebugName(textureResource, tag);
 
@@ -753,12 +840,13 @@ static ComPtr<ID3D12Resource> createTextureResource(char const* tag, GfxTextureD
             subResourceData[s].SlicePitch = slices[s].slicePitch;
         }
 
-        resourceUploader->Upload(textureResource.Get(), 0, subResourceData, sliceCount);
+        ScopedResourceUploader uploader;
+        uploader->Upload(textureResource.Get(), 0, subResourceData, sliceCount);
 
         if(mipFlag == GfxTextureMipFlag_GenMips)
         {
-            resourceUploader->Transition(textureResource.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-            resourceUploader->GenerateMips(textureResource.Get());
+            uploader->Transition(textureResource.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+            uploader->GenerateMips(textureResource.Get());
         }
 
         if(isUAV)
@@ -839,7 +927,7 @@ void GfxTexture::createGfxObject(char const* tag, GfxTextureDim dim, u32 width,
 {
     clearD3DViewsArray(obj->d3dViews);
     
-    obj->d3dResource = createTextureResource(tag, dim, width, height, format, mipFlag, usage, slices);
+    obj->d3dResource = createTextureResource(tag, dim, width, height, format, mipFlag, usage, slices, texturePlacementHeap, texturePlacementOffset);
 
     if(usage & GfxTextureUsage_RenderTarget)
     {
@@ -1102,7 +1190,7 @@ void GfxGraphicsPSO::createGfxObject(char const* tag, GfxVertexInputDesc* vertex
         BreakIfFail(D3D12SerializeVersionedRootSignature(&rootSigDesc, &signature, &error));
         if(error)
         {
-            rgLogError("RootSignature serialization error: %s", error->GetBufferPointer());
+            rgLogCategory(LogCategory_Gfx, LogLevel_Error, "RootSignature serialization error: %s", (char const*)error->GetBufferPointer());
         }
         BreakIfFail(getDevice()->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), __uuidof(rootSig), (void**)&(rootSig)));
         
@@ -1391,7 +1479,7 @@ GfxPipelineArgument* GfxRenderCmdEncoder::getPipelineArgument(char const* bindin
     auto infoIter = GfxState::graphicsPSO->arguments.find(bindingTag);
     if(infoIter == GfxState::graphicsPSO->arguments.end())
     {
-        rgLogError("Can't find the specified bindingTag(%s) in the shaders", bindingTag);
+        rgLogCategory(LogCategory_Gfx, LogLevel_Error, "Can't find the specified bindingTag(%s) in the shaders", bindingTag);
         rgAssert(false);
     }
 
@@ -1399,7 +1487,7 @@ GfxPipelineArgument* GfxRenderCmdEncoder::getPipelineArgument(char const* bindin
 
     if(((info->stages & GfxStage_VS) != GfxStage_VS) && (info->stages & GfxStage_FS) != GfxStage_FS)
     {
-        rgLogError("Resource/Binding(%s) cannot be found in the current pipeline(%s)", bindingTag, GfxState::graphicsPSO->tag);
+        rgLogCategory(LogCategory_Gfx, LogLevel_Error, "Resource/Binding(%s) cannot be found in the current pipeline(%s)", bindingTag, GfxState::graphicsPSO->tag);
         rgAssert(!"TODO: LogError should stop the execution");
     }
 
@@ -1460,62 +1548,6 @@ void GfxRenderCmdEncoder::bindTexture(char const* bindingTag, GfxTexture* textur
     getDevice()->CopyDescriptorsSimple(1, destDescriptorHandle, srcDescriptorHandle, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 }
 
-//-----------------------------------------------------------------------------
-void GfxRenderCmdEncoder::drawTexturedQuads(TexturedQuads* quads, Matrix4 const* viewMatrix, Matrix4 const* projectionMatrix)
-{
-    if(quads->size() < 1)
-    {
-        return;
-        rgAssert("No textured quads to draw");
-    }
-
-    eastl::vector<SimpleVertexFormat> vertices;
-    SimpleInstanceParams instanceParams;
-
-    genTexturedQuadVertices(quads, &vertices, &instanceParams);
-
-    GfxFrameResource vertexBufAllocation = gfxGetFrameAllocator()->newBuffer("drawTexturedQuadsVertexBuf", (u32)vertices.size() * sizeof(SimpleVertexFormat), vertices.data());
-    GfxFrameResource instanceParamsBuffer = gfxGetFrameAllocator()->newBuffer("instanceParamsCBuffer", sizeof(SimpleInstanceParams), &instanceParams);
-
-    //-
-    // camera
-    struct
-    {
-        f32 projection2d[16];
-        f32 view2d[16];
-    } cameraParams;
-
-    if(projectionMatrix != nullptr)
-    {
-        copyMatrix4ToFloatArray(cameraParams.projection2d, *projectionMatrix);
-    }
-    else
-    {
-        copyMatrix4ToFloatArray(cameraParams.projection2d, makeOrthographicProjectionMatrix(0.0f, (f32)g_WindowInfo.width, (f32)g_WindowInfo.height, 0.0f, 0.1f, 1000.0f));
-    }
-
-    if(viewMatrix != nullptr)
-    {
-        copyMatrix4ToFloatArray(cameraParams.view2d, *viewMatrix);
-    }
-    else
-    {
-        copyMatrix4ToFloatArray(cameraParams.view2d, Matrix4::lookAt(Point3(0, 0, 0), Point3(0, 0, -1000.0f), Vector3(0, 1.0f, 0)));
-    }
-
-    GfxFrameResource cameraBuffer = gfxGetFrameAllocator()->newBuffer("cameraCBuffer", sizeof(cameraParams), &cameraParams);
-
-    // --
-
-    bindBuffer("camera", &cameraBuffer);
-    bindBuffer("instanceParams", &instanceParamsBuffer);
-    bindSamplerState("simpleSampler", GfxState::samplerBilinearRepeat);
-
-    setVertexBuffer(&vertexBufAllocation, 0);
-
-    drawTriangles(0, (u32)vertices.size(), 1);
-}
-
 //-----------------------------------------------------------------------------
 void GfxRenderCmdEncoder::drawTriangles(u32 vertexStart, u32 vertexCount, u32 instanceCount)
 {
@@ -1523,6 +1555,7 @@ void GfxRenderCmdEncoder::drawTriangles(u32 vertexStart, u32 vertexCount, u32 in
     currentCommandList->DrawInstanced(vertexCount, instanceCount, vertexStart, 0);
     
     needDescriptorTableBump(true);
+    ++g_FrameStats.drawCalls;
 }
 
 void GfxRenderCmdEncoder::drawIndexedTriangles(u32 indexCount, rgBool is32bitIndex, GfxBuffer const* indexBuffer, u32 bufferOffset, u32 instanceCount)
@@ -1537,10 +1570,24 @@ void GfxRenderCmdEncoder::drawIndexedTriangles(u32 indexCount, rgBool is32bitInd
     currentCommandList->DrawIndexedInstanced(indexCount, instanceCount, 0, 0, 0);
     
     needDescriptorTableBump(true);
+    ++g_FrameStats.drawCalls;
 }
 
 void GfxRenderCmdEncoder::drawIndexedTriangles(u32 indexCount, rgBool is32bitIndex, GfxFrameResource const* indexBufferResource, u32 instanceCount)
 {
+    rgAssert(indexBufferResource && indexBufferResource->type == GfxFrameResource::Type_Buffer);
+
+    D3D12_INDEX_BUFFER_VIEW indexBufferView;
+    indexBufferView.BufferLocation = indexBufferResource->d3dResource->GetGPUVirtualAddress();
+    indexBufferView.SizeInBytes = indexBufferResource->sizeInBytes;
+    indexBufferView.Format = is32bitIndex ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT;
+
+    currentCommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    currentCommandList->IASetIndexBuffer(&indexBufferView);
+    currentCommandList->DrawIndexedInstanced(indexCount, instanceCount, 0, 0, 0);
+
+    needDescriptorTableBump(true);
+    ++g_FrameStats.drawCalls;
 }
 
 //*****************************************************************************
@@ -1579,7 +1626,7 @@ GfxPipelineArgument* GfxComputeCmdEncoder::getPipelineArgument(char const* bindi
     auto infoIter = GfxState::computePSO->arguments.find(bindingTag);
     if(infoIter == GfxState::computePSO->arguments.end())
     {
-        rgLogWarn("Resource/Binding(%s) cannot be found in the current pipeline(%s)", bindingTag, GfxState::computePSO->tag);
+        rgLogCategory(LogCategory_Gfx, LogLevel_Warn, "Resource/Binding(%s) cannot be found in the current pipeline(%s)", bindingTag, GfxState::computePSO->tag);
         return nullptr;
     }
 
@@ -1641,58 +1688,150 @@ void GfxBlitCmdEncoder::copyTexture(GfxTexture* srcTexture, GfxTexture* dstTextu
 // Frame Resource Allocator
 //*****************************************************************************
 
+static ComPtr<ID3D12Heap> createFrameAllocatorHeap(u32 sizeInBytes, D3D12_HEAP_FLAGS flags, wchar_t const* name)
+{
+    D3D12_HEAP_DESC heapDesc = {};
+    heapDesc.SizeInBytes = sizeInBytes;
+    if(flags == D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS)
+    {
+        heapDesc.Properties.Type = D3D12_HEAP_TYPE_CUSTOM;
+        heapDesc.Properties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_WRITE_COMBINE;
+        heapDesc.Properties.MemoryPoolPreference = D3D12_MEMORY_POOL_L0;
+    }
+    else
+    {
+        heapDesc.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;
+    }
+    heapDesc.Alignment = (flags == D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES) ? D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT : D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+    heapDesc.Flags = flags;
+
+    ComPtr<ID3D12Heap> heap;
+    BreakIfFail(getDevice()->CreateHeap(&heapDesc, IID_PPV_ARGS(&heap)));
+    heap->SetName(name);
+    return heap;
+}
+
 void GfxFrameAllocator::create(u32 bufferHeapSize, u32 nonRTDSTextureHeapSize, u32 rtDSTextureHeapSize)
 {
-    D3D12_HEAP_DESC bufferHeapDesc = {};
-    bufferHeapDesc.SizeInBytes = bufferHeapSize;
-    bufferHeapDesc.Properties.Type = D3D12_HEAP_TYPE_CUSTOM;
-    bufferHeapDesc.Properties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_WRITE_COMBINE;
-    bufferHeapDesc.Properties.MemoryPoolPreference = D3D12_MEMORY_POOL_L0;
-    bufferHeapDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
-    bufferHeapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
-    BreakIfFail(getDevice()->CreateHeap(&bufferHeapDesc, IID_PPV_ARGS(&d3dBufferHeap)));
-    d3dBufferHeap->SetName(L"GfxFrameAllocator::d3dBufferHeap");
-
-    D3D12_HEAP_DESC nonRTDSTextureHeapDesc = {};
-    nonRTDSTextureHeapDesc.SizeInBytes = bufferHeapSize;
-    nonRTDSTextureHeapDesc.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;
-    nonRTDSTextureHeapDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
-    nonRTDSTextureHeapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
-    BreakIfFail(getDevice()->CreateHeap(&nonRTDSTextureHeapDesc, IID_PPV_ARGS(&d3dNonRTDSTextureHeap)));
-    d3dNonRTDSTextureHeap->SetName(L"GfxFrameAllocator::d3dNonRTDSTextureHeap");
-
-    D3D12_HEAP_DESC rtDSTextureHeapDesc = {};
-    rtDSTextureHeapDesc.SizeInBytes = bufferHeapSize;
-    rtDSTextureHeapDesc.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;
-    rtDSTextureHeapDesc.Alignment = D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT;
-    rtDSTextureHeapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
-    BreakIfFail(getDevice()->CreateHeap(&rtDSTextureHeapDesc, IID_PPV_ARGS(&d3dRTDSTextureHeap)));
-    d3dRTDSTextureHeap->SetName(L"GfxFrameAllocator::d3dRTDSTextureHeap");
+    // Buffers go through allocate(), textures are bumped in their own heaps by newTexture2D()
+    capacity = roundUp(bufferHeapSize, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+    d3dBufferHeap = createFrameAllocatorHeap(capacity, D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS, L"GfxFrameAllocator::d3dBufferHeap");
+
+    // The texture heaps are only emptied all at once, a ring can't keep textures of older frames in them
+    rgAssert(mode == Mode_PerFrame || (nonRTDSTextureHeapSize == 0 && rtDSTextureHeapSize == 0));
+    d3dNonRTDSTextureHeapSize = roundUp(nonRTDSTextureHeapSize, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+    d3dRTDSTextureHeapSize = roundUp(rtDSTextureHeapSize, D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT);
+    d3dNonRTDSTextureHeapOffset = 0;
+    d3dRTDSTextureHeapOffset = 0;
+    d3dNonRTDSTextureFrameSize = 0;
+    d3dRTDSTextureFrameSize = 0;
+    if(d3dNonRTDSTextureHeapSize > 0)
+    {
+        d3dNonRTDSTextureHeap = createFrameAllocatorHeap(d3dNonRTDSTextureHeapSize, D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES, L"GfxFrameAllocator::d3dNonRTDSTextureHeap");
+    }
+    if(d3dRTDSTextureHeapSize > 0)
+    {
+        d3dRTDSTextureHeap = createFrameAllocatorHeap(d3dRTDSTextureHeapSize, D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES, L"GfxFrameAllocator::d3dRTDSTextureHeap");
+    }
 }
 
 void GfxFrameAllocator::destroy()
 {
+    d3dResources.clear();
+    d3dOverflowBufferHeaps.clear();
+}
+
+void GfxFrameAllocator::recreateHeap(u32 newCapacity)
+{
+    capacity = roundUp(newCapacity, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+    d3dBufferHeap = createFrameAllocatorHeap(capacity, D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS, L"GfxFrameAllocator::d3dBufferHeap");
+}
+
+void GfxFrameAllocator::createOverflowBlock(u32 size)
+{
+    u32 heapSize = roundUp(size, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+    d3dOverflowBufferHeaps.push_back(createFrameAllocatorHeap(heapSize, D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS, L"GfxFrameAllocator::d3dOverflowBufferHeap"));
+}
+
+void GfxFrameAllocator::releaseOverflowBlocks(u32 count)
+{
+    d3dOverflowBufferHeaps.erase(d3dOverflowBufferHeaps.begin(), d3dOverflowBufferHeaps.begin() + count);
 }
 
-void GfxFrameAllocator::releaseResources()
+void GfxFrameAllocator::releaseResources(u32 count)
 {
-    // NOTE: clear() will call the ComPtr destructors which will release the resouce.
+    // NOTE: erase() will call the ComPtr destructors which will release the resouce.
     //          i.e. no need to call ->Release() on each d3dResources manually.
-    d3dResources.clear();
+    d3dResources.erase(d3dResources.begin(), d3dResources.begin() + count);
+    if(d3dResources.empty())
+    {
+        d3dNonRTDSTextureHeapOffset = 0;
+        d3dRTDSTextureHeapOffset = 0;
+    }
+}
+
+u32 GfxFrameAllocator::getResourceCount()
+{
+    return (u32)d3dResources.size();
+}
+
+static u32 growTextureHeapSize(u32 heapSize, u32 frameSize, u32 alignment)
+{
+    u32 newSize = eastl::max(heapSize, alignment);
+    while(newSize < frameSize)
+    {
+        newSize *= 2;
+    }
+    return newSize;
+}
+
+void GfxFrameAllocator::resetTextureHeaps(rgBool grow)
+{
+    // Called after the frame's resources were released, nothing is placed in the texture heaps anymore
+    if(grow && d3dNonRTDSTextureFrameSize > d3dNonRTDSTextureHeapSize)
+    {
+        u32 newSize = growTextureHeapSize(d3dNonRTDSTextureHeapSize, d3dNonRTDSTextureFrameSize, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+        rgLogWarn("GfxFrameAllocator non RT/DS texture heap needed %u bytes, growing from %u to %u bytes", d3dNonRTDSTextureFrameSize, d3dNonRTDSTextureHeapSize, newSize);
+        d3dNonRTDSTextureHeapSize = newSize;
+        d3dNonRTDSTextureHeap = createFrameAllocatorHeap(d3dNonRTDSTextureHeapSize, D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES, L"GfxFrameAllocator::d3dNonRTDSTextureHeap");
+    }
+    if(grow && d3dRTDSTextureFrameSize > d3dRTDSTextureHeapSize)
+    {
+        u32 newSize = growTextureHeapSize(d3dRTDSTextureHeapSize, d3dRTDSTextureFrameSize, D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT);
+        rgLogWarn("GfxFrameAllocator RT/DS texture heap needed %u bytes, growing from %u to %u bytes", d3dRTDSTextureFrameSize, d3dRTDSTextureHeapSize, newSize);
+        d3dRTDSTextureHeapSize = newSize;
+        d3dRTDSTextureHeap = createFrameAllocatorHeap(d3dRTDSTextureHeapSize, D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES, L"GfxFrameAllocator::d3dRTDSTextureHeap");
+    }
+    d3dNonRTDSTextureFrameSize = 0;
+    d3dRTDSTextureFrameSize = 0;
 }
 
 GfxFrameResource GfxFrameAllocator::newBuffer(const char* tag, u32 size, void* initialData)
+{
+    if(initialData == nullptr)
+    {
+        return newBufferMapped(tag, size, nullptr);
+    }
+
+    void* mappedPtr = nullptr;
+    GfxFrameResource output = newBufferMapped(tag, size, &mappedPtr);
+    memcpy(mappedPtr, initialData, size);
+    return output;
+}
+
+GfxFrameResource GfxFrameAllocator::newBufferMapped(const char* tag, u32 size, void** outMappedPtr)
 {
     rgAssert(size > 0);
 
     u32 alignedSize = roundUp(size, 256); // CBVs size needs to be 256 bytes multiple
-    u32 alignedStartOffset = bumpStorageAligned(alignedSize, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+    Allocation allocation = allocate(alignedSize, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+    ID3D12Heap* heap = (allocation.block == 0) ? d3dBufferHeap.Get() : d3dOverflowBufferHeaps[allocation.block - 1].Get();
 
     CD3DX12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(alignedSize, D3D12_RESOURCE_FLAG_NONE);
     ComPtr<ID3D12Resource> bufferResource;
     BreakIfFail(getDevice()->CreatePlacedResource(
-        d3dBufferHeap.Get(),
-        alignedStartOffset,
+        heap,
+        allocation.offset,
         &resourceDesc,
         D3D12_RESOURCE_STATE_GENERIC_READ,
         nullptr,
@@ -1701,13 +1840,11 @@ GfxFrameResource GfxFrameAllocator::newBuffer(const char* tag, u32 size, void* i
 
     setDebugName(bufferResource, tag);
 
-    if(initialData != nullptr)
+    if(outMappedPtr != nullptr)
     {
-        void* mappedPtr = nullptr;
+        // Upload heap resources can stay mapped, the mapping goes away with the resource
         CD3DX12_RANGE mapRange(0, 0);
-        BreakIfFail(bufferResource->Map(0, &mapRange, &mappedPtr));
-        memcpy(mappedPtr, initialData, size);
-        bufferResource->Unmap(0, nullptr);
+        BreakIfFail(bufferResource->Map(0, &mapRange, outMappedPtr));
     }
 
     d3dResources.push_back(bufferResource);
@@ -1721,7 +1858,37 @@ GfxFrameResource GfxFrameAllocator::newBuffer(const char* tag, u32 size, void* i
 
 GfxFrameResource GfxFrameAllocator::newTexture2D(const char* tag, void* initialData, u32 width, u32 height, TinyImageFormat format, GfxTextureUsage usage)
 {
-    ComPtr<ID3D12Resource> texRes = createTextureResource(tag, GfxTextureDim_2D, width, height, format, GfxTextureMipFlag_1Mip, usage, nullptr);
+    rgBool isRTDS = (usage & (GfxTextureUsage_RenderTarget | GfxTextureUsage_DepthStencil)) != 0;
+    ID3D12Heap* heap = isRTDS ? d3dRTDSTextureHeap.Get() : d3dNonRTDSTextureHeap.Get();
+    u32& heapOffset = isRTDS ? d3dRTDSTextureHeapOffset : d3dNonRTDSTextureHeapOffset;
+    u32 heapSize = isRTDS ? d3dRTDSTextureHeapSize : d3dNonRTDSTextureHeapSize;
+    u32& heapFrameSize = isRTDS ? d3dRTDSTextureFrameSize : d3dNonRTDSTextureFrameSize;
+
+    CD3DX12_RESOURCE_DESC resourceDesc = makeTextureResourceDesc(GfxTextureDim_2D, width, height, format, GfxTextureMipFlag_1Mip, usage);
+    D3D12_RESOURCE_ALLOCATION_INFO allocationInfo = getDevice()->GetResourceAllocationInfo(0, 1, &resourceDesc);
+    u64 placementOffset = (heapOffset + allocationInfo.Alignment - 1) & ~(allocationInfo.Alignment - 1);
+
+    // Count the texture as if the heap had room for it, reset() grows the heap to that size
+    u32 alignedSize = (u32)(roundUp(heapFrameSize, (u32)allocationInfo.Alignment) - heapFrameSize + allocationInfo.SizeInBytes);
+    heapFrameSize += alignedSize;
+    frameTextureSize += alignedSize;
+
+    ComPtr<ID3D12Resource> texRes;
+    if(heap != nullptr && placementOffset + allocationInfo.SizeInBytes <= heapSize)
+    {
+        texRes = createTextureResource(tag, GfxTextureDim_2D, width, height, format, GfxTextureMipFlag_1Mip, usage, nullptr, heap, placementOffset);
+        heapOffset = (u32)(placementOffset + allocationInfo.SizeInBytes);
+    }
+    else
+    {
+        // Out of the heap, the texture gets its own memory
+        if(frameTextureOverflowSize == 0)
+        {
+            rgLogWarn("GfxFrameAllocator texture heap is full, '%s' and the rest of the frame's textures that don't fit are committed resources", tag);
+        }
+        frameTextureOverflowSize += alignedSize;
+        texRes = createTextureResource(tag, GfxTextureDim_2D, width, height, format, GfxTextureMipFlag_1Mip, usage, nullptr);
+    }
     d3dResources.push_back(texRes);
 
     GfxFrameResource output;
@@ -1731,6 +1898,58 @@ GfxFrameResource GfxFrameAllocator::newTexture2D(const char* tag, void* initialD
     return output;
 }
 
+//*****************************************************************************
+// Transient Texture Heap
+//*****************************************************************************
+
+// Only takes RT/DS textures, so it works on resource heap tier 1 too
+static ComPtr<ID3D12Heap> transientTextureHeap;
+
+rgBool gfxCreateTransientTextureHeap(rgSize sizeInBytes)
+{
+    transientTextureHeap = createFrameAllocatorHeap((u32)sizeInBytes, D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES, L"transientTextureHeap");
+    return true;
+}
+
+void gfxDestroyTransientTextureHeap()
+{
+    transientTextureHeap.Reset();
+}
+
+rgBool gfxGetTransientTexturePlacement(u32 width, u32 height, TinyImageFormat format, GfxTextureUsage usage, rgSize* outSizeInBytes, rgSize* outAlignment)
+{
+    if((usage & (GfxTextureUsage_RenderTarget | GfxTextureUsage_DepthStencil)) == 0)
+    {
+        return false;
+    }
+
+    CD3DX12_RESOURCE_DESC resourceDesc = makeTextureResourceDesc(GfxTextureDim_2D, width, height, format, GfxTextureMipFlag_1Mip, usage);
+    D3D12_RESOURCE_ALLOCATION_INFO allocationInfo = getDevice()->GetResourceAllocationInfo(0, 1, &resourceDesc);
+    *outSizeInBytes = (rgSize)allocationInfo.SizeInBytes;
+    *outAlignment = (rgSize)allocationInfo.Alignment;
+    return true;
+}
+
+GfxTexture* gfxCreatePlacedTransientTexture(char const* tag, u32 width, u32 height, TinyImageFormat format, GfxTextureUsage usage, rgSize heapOffset)
+{
+    rgAssert(transientTextureHeap != nullptr);
+    texturePlacementHeap = transientTextureHeap.Get();
+    texturePlacementOffset = heapOffset;
+    GfxTexture* texture = GfxTexture::create(tag, GfxTextureDim_2D, width, height, format, GfxTextureMipFlag_1Mip, usage, nullptr);
+    texturePlacementHeap = nullptr;
+    texturePlacementOffset = 0;
+    return texture;
+}
+
+void gfxBeginTransientTextureAliasing(GfxTexture* texture)
+{
+    // A null before-resource stands for every resource which used the memory before
+    currentCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Aliasing(nullptr, texture->d3dResource.Get()));
+    // A placed texture's contents are undefined when it is new or was aliased, it needs a clear or discard before it is used.
+    // It is still in the RENDER_TARGET or DEPTH_WRITE state it was created in, which DiscardResource() wants
+    currentCommandList->DiscardResource(texture->d3dResource.Get(), nullptr);
+}
+
 //*****************************************************************************
 // Call from main | loop init() destroy() startNextFrame() endFrame()
 //*****************************************************************************
@@ -1928,9 +2147,10 @@ i32 gfxInit()
     // create commandlist
     currentCommandList = createGraphicsCommandList(commandAllocator[0], nullptr);
 
-    // create resource uploader
+    // create resource uploader, the app's setup() runs on this thread before the first frame
     resourceUploader = rgNew(ResourceUploadBatch)(getDevice().Get());
     resourceUploader->Begin();
+    renderThreadID.store(SDL_ThreadID());
 
     {
         // Create a fence with initial value 0 which is equal to d3d.nextFrameFenceValues[g_FrameIndex=0]
@@ -1951,6 +2171,18 @@ void gfxDestroy()
 {
     waitForGpu();
     ::CloseHandle(frameFenceEvent);
+
+    ImGui_ImplDX12_Shutdown();
+    ImGui_ImplSDL2_Shutdown();
+
+    // Not made by GfxTexture::create(), see gfxInit()
+    for(i32 i = 0; i < RG_MAX_FRAMES_IN_FLIGHT; ++i)
+    {
+        rgDelete(swapchainLinearTexture[i]);
+        rgDelete(swapchainTextures[i]);
+        swapchainLinearTexture[i] = nullptr;
+        swapchainTextures[i] = nullptr;
+    }
 }
 
 i32 draw()
@@ -1979,6 +2211,9 @@ void checkerWaitTillFrameCompleted(i32 frameIndex)
 
 void gfxStartNextFrame()
 {
+    // In the pipelined mode this is a different thread than the one that ran gfxInit()
+    renderThreadID.store(SDL_ThreadID(), std::memory_order_relaxed);
+
     UINT64 prevFrameFenceValue = (g_FrameIndex != -1) ? frameFenceValues[g_FrameIndex] : 0;
 
     g_FrameIndex = dxgiSwapchain->GetCurrentBackBufferIndex();
@@ -2020,7 +2255,9 @@ void gfxEndFrame()
 
     BreakIfFail(currentCommandList->Close());
 
+    // Only the render thread records into this batch, loader threads submit their own
     auto resourceUploaderFinish = resourceUploader->End(commandQueue.Get());
+    resourceUploader->Begin();
     resourceUploaderFinish.wait();
 
     ID3D12CommandList* commandLists[] = { currentCommandList.Get() };
@@ -2029,8 +2266,6 @@ void gfxEndFrame()
 
     UINT64 fenceValueToSignal = frameFenceValues[g_FrameIndex];
     BreakIfFail(commandQueue->Signal(frameFence.Get(), fenceValueToSignal));
-
-    resourceUploader->Begin(); // Should this be moved to gfxRunOnFrameBeginJob()?
 }
 
 void gfxOnSizeChanged()
@@ -2071,11 +2306,11 @@ void gfxRendererImGuiNewFrame()
     ImGui_ImplDX12_NewFrame();
 }
 
-void gfxRendererImGuiRenderDrawData()
+void gfxRendererImGuiRenderDrawData(ImDrawData* drawData)
 {
     D3D12_CPU_DESCRIPTOR_HANDLE rtv = getD3DView(swapchainLinearTexture[g_FrameIndex], GfxD3DViewType_RTV).descriptor;
     currentCommandList->OMSetRenderTargets(1, &rtv, FALSE, NULL);
-    ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), currentCommandList.Get());
+    ImGui_ImplDX12_RenderDrawData(drawData, currentCommandList.Get());
 }
 
 TinyImageFormat gfxGetBackbufferFormat()
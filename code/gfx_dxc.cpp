@@ -11,6 +11,7 @@
 #include <filesystem>
 
 static ComPtr<IDxcUtils> g_DxcUtils;
+static SDL_SpinLock g_DxcUtilsLock; // PSOs are created on loader threads too
 
 static void checkResult(HRESULT hr)
 {
@@ -72,6 +73,8 @@ public:
 
 ShaderBlobRef createShaderBlob(char const* filename, GfxStage stage, char const* entrypoint, char const* defines, bool genSPIRV)
 {
+    rgProfileFunction();
+
     rgAssert(entrypoint);
     rgAssert(filename);
     rgAssert(entrypoint);
@@ -163,10 +166,12 @@ ShaderBlobRef createShaderBlob(char const* filename, GfxStage stage, char const*
     dxcArgs.push_back(L"-Zi");
 
     // create include handler
+    SDL_AtomicLock(&g_DxcUtilsLock);
     if(!g_DxcUtils)
     {
         checkResult(DxcCreateInstance(CLSID_DxcUtils, __uuidof(IDxcUtils), (void**)&g_DxcUtils));
     }
+    SDL_AtomicUnlock(&g_DxcUtilsLock);
 
     ComPtr<CustomIncludeHandler> customIncludeHandler(rgNew(CustomIncludeHandler));
 
@@ -179,7 +184,7 @@ ShaderBlobRef createShaderBlob(char const* filename, GfxStage stage, char const*
     strcpy(filepath, "../code/shaders/");
     strncat(filepath, filename, 490);
 
-    FileData shaderFileData = fileRead(filepath); // TODO: destructor deleter for FileData
+    FileMapping shaderFileData = fileMap(filepath); // TODO: destructor deleter for FileMapping
     rgAssert(shaderFileData.isValid);
     
     // prepare for passing shader to dxc
@@ -193,14 +198,14 @@ ShaderBlobRef createShaderBlob(char const* filename, GfxStage stage, char const*
     checkResult(compiler3->Compile(&shaderSource, dxcArgs.data(), (UINT32)dxcArgs.size(), customIncludeHandler.Get(), __uuidof(IDxcResult), (void**)&result));
 
     // free shader file data
-    fileFree(&shaderFileData);
+    fileUnmap(&shaderFileData);
 
     // print warnings and errors from compilation result
     ComPtr<IDxcBlobUtf8> errorMsg;
     result->GetOutput(DXC_OUT_ERRORS, IID_PPV_ARGS(&errorMsg), nullptr);
     if(errorMsg && errorMsg->GetStringLength())
     {
-        rgLogError("***Shader Compile Warn/Error(%s, %s),Defines:%s***\n%s", filename, entrypoint, defines, errorMsg->GetStringPointer());
+        rgLogCategory(LogCategory_Gfx, LogLevel_Error, "***Shader Compile Warn/Error(%s, %s),Defines:%s***\n%s", filename, entrypoint, defines, errorMsg->GetStringPointer());
     }
 
     // get the compiled shader blob from compilation result
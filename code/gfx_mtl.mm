@@ -66,6 +66,7 @@ static id<MTLArgumentEncoder>   bindlessTextureArgEncoder;
 static id<MTLBuffer>            bindlessTextureArgBuffer;
 
 static eastl::vector<GfxTexture*>   frameBeginJobGenTextureMipmaps;
+static SDL_SpinLock                 frameBeginJobLock; // Textures are created on loader threads too
 
 // ----------------------------------------
 // HELPER FUNCTIONS
@@ -288,6 +289,12 @@ MTLVertexFormat toMTLVertexFormat(TinyImageFormat fmt)
         case TinyImageFormat_R8G8B8A8_UNORM:
             result = MTLVertexFormatUChar4Normalized;
             break;
+        case TinyImageFormat_R16G16_SNORM:
+            result = MTLVertexFormatShort2Normalized;
+            break;
+        case TinyImageFormat_R32_UINT:
+            result = MTLVertexFormatUInt;
+            break;
         INVALID_DEFAULT_CASE;
     }
     return result;
@@ -393,7 +400,7 @@ GfxTexture createGfxTextureFromMTLTexture(id<MTLTexture> mtlTexture)
 // Buffer type
 // -----------
 
-void GfxBuffer::createGfxObject(char const* tag, GfxMemoryType memoryType, void* buf, rgSize size, GfxBufferUsage usage, GfxBuffer* obj)
+void GfxBuffer::createGfxObject(char const* tag, GfxMemoryType memoryType, void const* buf, rgSize size, GfxBufferUsage usage, GfxBuffer* obj)
 {
     if(usage != GfxBufferUsage_ShaderRW)
     {
@@ -508,7 +515,9 @@ void GfxTexture::createGfxObject(char const* tag, GfxTextureDim dim, u32 width,
         
         if(mipFlag == GfxTextureMipFlag_GenMips)
         {
+            SDL_AtomicLock(&frameBeginJobLock);
             frameBeginJobGenTextureMipmaps.push_back(obj);
+            SDL_AtomicUnlock(&frameBeginJobLock);
         }
     }
 
@@ -858,6 +867,12 @@ void GfxRenderCmdEncoder::begin(char const* tag, GfxRenderPass* renderPass)
     [re setFragmentBuffer:bindlessTextureArgBuffer offset:0 atIndex:kBindlessTextureSetBinding];
     
     [re useHeap:asMTLHeap(gfxGetFrameAllocator()->getHeap()) stages:MTLRenderStageVertex|MTLRenderStageFragment];
+    // Only once it exists, a ring made during this pass is still reachable by direct binds
+    GfxFrameAllocator* ringAllocator = gfxFindRingAllocator();
+    if(ringAllocator != nullptr)
+    {
+        [re useHeap:asMTLHeap(ringAllocator->getHeap()) stages:MTLRenderStageVertex|MTLRenderStageFragment];
+    }
     
     mtlRenderCommandEncoder = (__bridge void*)re;
     hasEnded = false;
@@ -953,7 +968,7 @@ GfxPipelineArgument* GfxRenderCmdEncoder::getPipelineArgument(char const* bindin
     auto infoIter = GfxState::graphicsPSO->arguments.find(bindingTag);
     if(infoIter == GfxState::graphicsPSO->arguments.end())
     {
-        rgLogError("Can't find the specified bindingTag(%s) in the shaders", bindingTag);
+        rgLogCategory(LogCategory_Gfx, LogLevel_Error, "Can't find the specified bindingTag(%s) in the shaders", bindingTag);
         return;
     }
     
@@ -961,7 +976,7 @@ GfxPipelineArgument* GfxRenderCmdEncoder::getPipelineArgument(char const* bindin
     
     if(((info->stages & GfxStage_VS) != GfxStage_VS) && (info->stages & GfxStage_FS) != GfxStage_FS)
     {
-        rgLogError("Resource/Binding(%s) cannot be found in the current pipeline(%s)", bindingTag, GfxState::graphicsPSO->tag);
+        rgLogCategory(LogCategory_Gfx, LogLevel_Error, "Resource/Binding(%s) cannot be found in the current pipeline(%s)", bindingTag, GfxState::graphicsPSO->tag);
         rgAssert(!"TODO: LogError should stop the execution");
     }
     
@@ -1051,66 +1066,11 @@ void GfxRenderCmdEncoder::bindTexture(char const* bindingTag, GfxTexture* textur
     }
 }
 
-//-----------------------------------------------------------------------------
-void GfxRenderCmdEncoder::drawTexturedQuads(TexturedQuads* quads, Matrix4 const* viewMatrix, Matrix4 const* projectionMatrix)
-{
-    if(quads->size() < 1)
-    {
-        return;
-        rgAssert("No textured quads to draw");
-    }
-    
-    eastl::vector<SimpleVertexFormat> vertices;
-    SimpleInstanceParams instanceParams;
-    
-    genTexturedQuadVertices(quads, &vertices, &instanceParams);
-    
-    GfxFrameResource vertexBufAllocation = gfxGetFrameAllocator()->newBuffer("drawTexturedQuadsVertexBuf", (u32)vertices.size() * sizeof(SimpleVertexFormat), vertices.data());
-    GfxFrameResource instanceParamsBuffer = gfxGetFrameAllocator()->newBuffer("instanceParamsCBuffer", sizeof(SimpleInstanceParams), &instanceParams);
-
-    //-
-    // camera
-    struct
-    {
-        f32 projection2d[16];
-        f32 view2d[16];
-    } cameraParams;
-    
-    if(projectionMatrix != nullptr)
-    {
-        copyMatrix4ToFloatArray(cameraParams.projection2d, *projectionMatrix);
-    }
-    else
-    {
-        copyMatrix4ToFloatArray(cameraParams.projection2d, makeOrthographicProjectionMatrix(0.0f, (f32)g_WindowInfo.width, (f32)g_WindowInfo.height, 0.0f, 0.1f, 1000.0f));
-    }
-
-    if(viewMatrix != nullptr)
-    {
-        copyMatrix4ToFloatArray(cameraParams.view2d, *viewMatrix);
-    }
-    else
-    {
-        copyMatrix4ToFloatArray(cameraParams.view2d, Matrix4::lookAt(Point3(0, 0, 0), Point3(0, 0, -1000.0f), Vector3(0, 1.0f, 0)));
-    }
-
-    GfxFrameResource cameraBuffer = gfxGetFrameAllocator()->newBuffer("cameraCBuffer", sizeof(cameraParams), (void*)&cameraParams);
-    
-    // --
-
-    bindBuffer("camera", &cameraBuffer);
-    bindBuffer("instanceParams", &instanceParamsBuffer);
-    bindSamplerState("simpleSampler", GfxState::samplerBilinearRepeat);
-    
-    setVertexBuffer(&vertexBufAllocation, 0);
-
-    drawTriangles(0, (u32)vertices.size(), 1);
-}
-
 //-----------------------------------------------------------------------------
 void GfxRenderCmdEncoder::drawTriangles(u32 vertexStart, u32 vertexCount, u32 instanceCount)
 {
     [asMTLRenderCommandEncoder(mtlRenderCommandEncoder) drawPrimitives:MTLPrimitiveTypeTriangle vertexStart:0 vertexCount:vertexCount instanceCount:instanceCount];
+    ++g_FrameStats.drawCalls;
 }
 
 void GfxRenderCmdEncoder::drawIndexedTriangles(u32 indexCount, rgBool is32bitIndex, GfxBuffer const* indexBuffer, u32 bufferOffset, u32 instanceCount)
@@ -1118,6 +1078,7 @@ void GfxRenderCmdEncoder::drawIndexedTriangles(u32 indexCount, rgBool is32bitInd
     rgAssert(mtlRenderCommandEncoder);
     MTLIndexType indexElementType = is32bitIndex ? MTLIndexTypeUInt32 : MTLIndexTypeUInt16;
     [asMTLRenderCommandEncoder(mtlRenderCommandEncoder) drawIndexedPrimitives:MTLPrimitiveTypeTriangle indexCount:indexCount indexType:indexElementType indexBuffer:getMTLBuffer(indexBuffer) indexBufferOffset:bufferOffset instanceCount:instanceCount];
+    ++g_FrameStats.drawCalls;
 }
 
 void GfxRenderCmdEncoder::drawIndexedTriangles(u32 indexCount, rgBool is32bitIndex, GfxFrameResource const* indexBufferResource, u32 instanceCount)
@@ -1126,6 +1087,7 @@ void GfxRenderCmdEncoder::drawIndexedTriangles(u32 indexCount, rgBool is32bitInd
     rgAssert(indexBufferResource && indexBufferResource->type == GfxFrameResource::Type_Buffer);
     MTLIndexType indexElementType = is32bitIndex ? MTLIndexTypeUInt32 : MTLIndexTypeUInt16;
     [asMTLRenderCommandEncoder(mtlRenderCommandEncoder) drawIndexedPrimitives:MTLPrimitiveTypeTriangle indexCount:indexCount indexType:indexElementType indexBuffer:asMTLBuffer(indexBufferResource->mtlBuffer) indexBufferOffset:0 instanceCount:instanceCount];
+    ++g_FrameStats.drawCalls;
 }
 
 // Compute Encoder
@@ -1139,6 +1101,11 @@ void GfxComputeCmdEncoder::begin(char const* tag)
     [cce pushDebugGroup:[NSString stringWithUTF8String:tag]];
     [cce useHeap:bindlessTextureHeap];
     [cce useHeap:asMTLHeap(gfxGetFrameAllocator()->getHeap())];
+    GfxFrameAllocator* ringAllocator = gfxFindRingAllocator();
+    if(ringAllocator != nullptr)
+    {
+        [cce useHeap:asMTLHeap(ringAllocator->getHeap())];
+    }
     mtlComputeCommandEncoder = (__bridge void*)cce;
     hasEnded = false;
 }
@@ -1178,7 +1145,7 @@ GfxPipelineArgument* GfxComputeCmdEncoder::getPipelineArgument(char const* bindi
     auto infoIter = GfxState::computePSO->arguments.find(bindingTag);
     if(infoIter == GfxState::computePSO->arguments.end())
     {
-        rgLogWarn("Resource/Binding(%s) cannot be found in the current pipeline(%s)", bindingTag, GfxState::computePSO->tag);
+        rgLogCategory(LogCategory_Gfx, LogLevel_Warn, "Resource/Binding(%s) cannot be found in the current pipeline(%s)", bindingTag, GfxState::computePSO->tag);
         return nullptr;
     }
     
@@ -1195,7 +1162,7 @@ void GfxComputeCmdEncoder::bindBuffer(char const* bindingTag, GfxBuffer* buffer,
     GfxPipelineArgument* info = getPipelineArgument(bindingTag);
     if(info == nullptr)
     {
-        rgLogWarn("Skipping binding buffer(%s) for pipeline(%s)", bindingTag, GfxState::computePSO->tag);
+        rgLogCategory(LogCategory_Gfx, LogLevel_Warn, "Skipping binding buffer(%s) for pipeline(%s)", bindingTag, GfxState::computePSO->tag);
         return;
     }
     
@@ -1210,7 +1177,7 @@ void GfxComputeCmdEncoder::bindBuffer(char const* bindingTag, GfxFrameResource c
     GfxPipelineArgument* info = getPipelineArgument(bindingTag);
     if(info == nullptr)
     {
-        rgLogWarn("Skipping binding buffer(%s) for pipeline(%s)", bindingTag, GfxState::computePSO->tag);
+        rgLogCategory(LogCategory_Gfx, LogLevel_Warn, "Skipping binding buffer(%s) for pipeline(%s)", bindingTag, GfxState::computePSO->tag);
         return;
     }
     
@@ -1234,7 +1201,7 @@ void GfxComputeCmdEncoder::bindTexture(char const* bindingTag, GfxTexture* textu
     GfxPipelineArgument* info = getPipelineArgument(bindingTag);
     if(info == nullptr)
     {
-        rgLogWarn("Skipping binding texture(%s) for pipeline(%s)", bindingTag, GfxState::computePSO->tag);
+        rgLogCategory(LogCategory_Gfx, LogLevel_Warn, "Skipping binding texture(%s) for pipeline(%s)", bindingTag, GfxState::computePSO->tag);
         return;
     }
     
@@ -1249,7 +1216,7 @@ void GfxComputeCmdEncoder::bindSamplerState(char const* bindingTag, GfxSamplerSt
     GfxPipelineArgument* info = getPipelineArgument(bindingTag);
     if(info == nullptr)
     {
-        rgLogWarn("Skipping binding sampler(%s) for pipeline(%s)", bindingTag, GfxState::computePSO->tag);
+        rgLogCategory(LogCategory_Gfx, LogLevel_Warn, "Skipping binding sampler(%s) for pipeline(%s)", bindingTag, GfxState::computePSO->tag);
         return;
     }
     
@@ -1307,57 +1274,105 @@ void GfxBlitCmdEncoder::copyTexture(GfxTexture* srcTexture, GfxTexture* dstTextu
 // GFX FRAME RESOURCE ALLOCATOR
 // ----------------------------------------
 
-void GfxFrameAllocator::create(u32 bufferHeapSize, u32 nonRTDSTextureHeapSize, u32 rtDSTextureHeapSize)
+static id<MTLHeap> createFrameAllocatorHeap(u32 sizeInBytes, NSString* label)
 {
-    u32 totalSizeInBytes = bufferHeapSize + nonRTDSTextureHeapSize + rtDSTextureHeapSize;
-
     MTLHeapDescriptor* heapDesc = [MTLHeapDescriptor new];
     heapDesc.type = MTLHeapTypePlacement;
     heapDesc.storageMode = MTLStorageModeShared;
     heapDesc.cpuCacheMode = MTLCPUCacheModeWriteCombined;
     heapDesc.hazardTrackingMode = MTLHazardTrackingModeTracked; // TODO: use untracked for better perf. Similar to D3D12
     heapDesc.resourceOptions = MTLResourceStorageModeShared | MTLResourceCPUCacheModeWriteCombined | MTLResourceHazardTrackingModeTracked;
-    heapDesc.size = totalSizeInBytes;
+    heapDesc.size = sizeInBytes;
     
     id<MTLHeap> hp = [getMTLDevice() newHeapWithDescriptor:heapDesc];
     rgAssert(hp != nil);
     [heapDesc release];
-    hp.label = @"FrameAllocator";
-    
-    heap = (__bridge void*)hp;
+    hp.label = label;
+    return hp;
+}
+
+void GfxFrameAllocator::create(u32 bufferHeapSize, u32 nonRTDSTextureHeapSize, u32 rtDSTextureHeapSize)
+{
+    capacity = bufferHeapSize + nonRTDSTextureHeapSize + rtDSTextureHeapSize;
+    heap = (__bridge void*)createFrameAllocatorHeap(capacity, @"FrameAllocator");
 }
 
 void GfxFrameAllocator::destroy()
+{
+    releaseResources((u32)mtlResources.size());
+    releaseOverflowBlocks((u32)overflowHeaps.size());
+    [asMTLHeap(heap) release];
+}
+
+void GfxFrameAllocator::recreateHeap(u32 newCapacity)
 {
     [asMTLHeap(heap) release];
+    heap = (__bridge void*)createFrameAllocatorHeap(newCapacity, @"FrameAllocator");
+    capacity = newCapacity;
+}
+
+// NOTE: Encoders only call useHeap: on the main heap, resources in overflow
+// blocks can be bound directly but not reached through argument buffers
+void GfxFrameAllocator::createOverflowBlock(u32 size)
+{
+    overflowHeaps.push_back((__bridge void*)createFrameAllocatorHeap(size, @"FrameAllocatorOverflow"));
+}
+
+void GfxFrameAllocator::releaseOverflowBlocks(u32 count)
+{
+    for(u32 i = 0; i < count; ++i)
+    {
+        [asMTLHeap(overflowHeaps[i]) release];
+    }
+    overflowHeaps.erase(overflowHeaps.begin(), overflowHeaps.begin() + count);
 }
 
-void GfxFrameAllocator::releaseResources()
+void GfxFrameAllocator::releaseResources(u32 count)
 {
-    i32 l = mtlResources.size();
-    for(i32 i = 0; i < l; ++i)
+    for(u32 i = 0; i < count; ++i)
     {
         id<MTLResource> re = (__bridge id<MTLResource>)mtlResources[i];
         [re release];
     }
-    mtlResources.clear();
+    mtlResources.erase(mtlResources.begin(), mtlResources.begin() + count);
+}
+
+u32 GfxFrameAllocator::getResourceCount()
+{
+    return (u32)mtlResources.size();
+}
+
+void GfxFrameAllocator::resetTextureHeaps(rgBool grow)
+{
+    // Textures go through allocate() like buffers, there are no separate texture heaps
 }
 
 GfxFrameResource GfxFrameAllocator::newBuffer(const char* tag, u32 size, void* initialData)
+{
+    void* mappedPtr = nullptr;
+    GfxFrameResource output = newBufferMapped(tag, size, &mappedPtr);
+    if(initialData != nullptr)
+    {
+        std::memcpy(mappedPtr, initialData, size);
+    }
+    return output;
+}
+
+GfxFrameResource GfxFrameAllocator::newBufferMapped(const char* tag, u32 size, void** outMappedPtr)
 {
     MTLResourceOptions options = MTLResourceStorageModeShared | MTLResourceHazardTrackingModeTracked | MTLResourceCPUCacheModeWriteCombined;
     MTLSizeAndAlign sizeAndAlign = [getMTLDevice() heapBufferSizeAndAlignWithLength:size options:options];
     
-    u32 alignedStartOffset = bumpStorageAligned(sizeAndAlign.size, sizeAndAlign.align);
+    Allocation allocation = allocate(sizeAndAlign.size, sizeAndAlign.align);
+    void* blockHeap = (allocation.block == 0) ? heap : overflowHeaps[allocation.block - 1];
     
-    id<MTLBuffer> br = [asMTLHeap(heap) newBufferWithLength:size options:options offset:alignedStartOffset];
+    id<MTLBuffer> br = [asMTLHeap(blockHeap) newBufferWithLength:size options:options offset:allocation.offset];
     rgAssert(br != nil);
     br.label = [NSString stringWithUTF8String:tag];
     
-    if(initialData != nullptr)
+    if(outMappedPtr != nullptr)
     {
-        void* mappedPtr = [br contents];
-        std::memcpy(mappedPtr, initialData, size);
+        *outMappedPtr = [br contents];
     }
     
     mtlResources.push_back((__bridge void*)br);
@@ -1387,9 +1402,10 @@ GfxFrameResource GfxFrameAllocator::newTexture2D(const char* tag, void* initialD
     texDesc.usage = toMTLTextureUsage(usage);
     
     MTLSizeAndAlign sizeAndAlign = [getMTLDevice() heapTextureSizeAndAlignWithDescriptor:texDesc];
-    u32 alignedStartOffset = bumpStorageAligned(sizeAndAlign.size, sizeAndAlign.align);
+    Allocation allocation = allocate(sizeAndAlign.size, sizeAndAlign.align);
+    void* blockHeap = (allocation.block == 0) ? heap : overflowHeaps[allocation.block - 1];
     
-    id<MTLTexture> te = [asMTLHeap(heap) newTextureWithDescriptor:texDesc offset:alignedStartOffset];
+    id<MTLTexture> te = [asMTLHeap(blockHeap) newTextureWithDescriptor:texDesc offset:allocation.offset];
     te.label = [NSString stringWithUTF8String:tag];
     [texDesc release];
     
@@ -1410,6 +1426,36 @@ GfxFrameResource GfxFrameAllocator::newTexture2D(const char* tag, void* initialD
     return output;
 }
 
+// ----------------------------------------
+// TRANSIENT TEXTURE HEAP
+// ----------------------------------------
+
+// TODO: place them in an MTLHeap of MTLHeapTypePlacement, till then the transient pool only has committed textures
+rgBool gfxCreateTransientTextureHeap(rgSize sizeInBytes)
+{
+    return false;
+}
+
+void gfxDestroyTransientTextureHeap()
+{
+}
+
+rgBool gfxGetTransientTexturePlacement(u32 width, u32 height, TinyImageFormat format, GfxTextureUsage usage, rgSize* outSizeInBytes, rgSize* outAlignment)
+{
+    return false;
+}
+
+GfxTexture* gfxCreatePlacedTransientTexture(char const* tag, u32 width, u32 height, TinyImageFormat format, GfxTextureUsage usage, rgSize heapOffset)
+{
+    rgAssert(!"No transient texture heap");
+    return nullptr;
+}
+
+void gfxBeginTransientTextureAliasing(GfxTexture* texture)
+{
+    rgAssert(!"No transient texture heap");
+}
+
 //***********************************************************************
 //***********************************************************************
 //***********************************************************************
@@ -1525,7 +1571,9 @@ i32 gfxInit()
 
 void gfxDestroy()
 {
-    
+    // Command buffers retain what they use, objects can be released while they finish
+    ImGui_ImplMetal_Shutdown();
+    ImGui_ImplSDL2_Shutdown();
 }
 
 void gfxStartNextFrame()
@@ -1591,16 +1639,21 @@ void gfxEndFrame()
 // TODO: should this be done at abstracted level?
 void gfxRunOnFrameBeginJob()
 {
-    if(frameBeginJobGenTextureMipmaps.size() > 0)
+    // Swap the queue out so loader threads aren't blocked while the blits are encoded
+    eastl::vector<GfxTexture*> textures;
+    SDL_AtomicLock(&frameBeginJobLock);
+    textures.swap(frameBeginJobGenTextureMipmaps);
+    SDL_AtomicUnlock(&frameBeginJobLock);
+
+    if(textures.size() > 0)
     {
         id<MTLBlitCommandEncoder> mipmapGenCmdList = [getMTLCommandBuffer() blitCommandEncoder];
         mipmapGenCmdList.label = @"OnFrameBegin GenMipMap";
-        for(GfxTexture* tex : frameBeginJobGenTextureMipmaps)
+        for(GfxTexture* tex : textures)
         {
             [mipmapGenCmdList generateMipmapsForTexture:asMTLTexture(tex->mtlTexture)];
         }
         [mipmapGenCmdList endEncoding];
-        frameBeginJobGenTextureMipmaps.clear();
     }
 }
 
@@ -1626,7 +1679,7 @@ void gfxRendererImGuiNewFrame()
     [renderPassDesc autorelease];
 }
 
-void gfxRendererImGuiRenderDrawData()
+void gfxRendererImGuiRenderDrawData(ImDrawData* drawData)
 {
     // TODO: imgui assumes linear color RT, but our MTLDrawable is sRGB
     // To fix the issue with incorrect color, create a linear texture-view
@@ -1639,7 +1692,7 @@ void gfxRendererImGuiRenderDrawData()
     imguiRenderPass.colorAttachments[0].storeAction = GfxStoreAction_Store;
     
     GfxRenderCmdEncoder* cmdEncoder = gfxSetRenderPass("ImGui Pass", &imguiRenderPass);
-    ImGui_ImplMetal_RenderDrawData(ImGui::GetDrawData(), getMTLCommandBuffer(), asMTLRenderCommandEncoder(cmdEncoder->mtlRenderCommandEncoder));
+    ImGui_ImplMetal_RenderDrawData(drawData, getMTLCommandBuffer(), asMTLRenderCommandEncoder(cmdEncoder->mtlRenderCommandEncoder));
     cmdEncoder->end();
 }
 
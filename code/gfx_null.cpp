@@ -0,0 +1,765 @@
+#if defined(RG_NULL_RNDR)
+#include "gfx.h"
+
+#include "backends/imgui_impl_sdl2.h"
+
+#include <EASTL/algorithm.h>
+
+#include <string.h>
+
+// NOTE: Null renderer doesn't talk to any GPU. All the resources are backed by
+// CPU memory and the command encoders only do the CPU side book-keeping, so
+// the engine overhead of a frame can be measured on machines without a GPU.
+// Shaders are not compiled, therefore pipeline arguments are never populated
+// and binding calls on them are silently ignored.
+
+static GfxTexture* backbufferTexture;
+static GfxTexture* backbufferTextureLinear;
+
+static GfxTexture* imguiFontTexture;
+
+static eastl::vector<GfxTexture*> frameBeginJobGenTextureMipmaps;
+static SDL_SpinLock frameBeginJobLock; // Textures are created on loader threads too
+
+static u32 quitAfterFrameCount; // 0 means run until SDL_QUIT
+
+//*****************************************************************************
+// Helper Functions
+//*****************************************************************************
+
+static u32 getTextureFaceCount(GfxTextureDim dim)
+{
+    return (dim == GfxTextureDim_Cube) ? 6 : 1;
+}
+
+// 2x2 box filter of each mip from the previous one. Pixels are decoded to
+// float so sRGB formats are filtered in linear space.
+static void genTextureMipmapsOnCPU(GfxTexture* texture)
+{
+    TinyImageFormat format = texture->format;
+    if(TinyImageFormat_IsCompressed(format))
+    {
+        rgAssert(!"GenMips is not supported for compressed formats");
+        return;
+    }
+
+    u32 const bytesPerPixel = TinyImageFormat_BitSizeOfBlock(format) / 8;
+
+    eastl::vector<f32> srcRows(texture->width * 4 * 2);
+    eastl::vector<f32> dstRow(eastl::max(1u, texture->width >> 1) * 4);
+
+    u8* face = (u8*)texture->nullMemory;
+    for(u32 f = 0; f < getTextureFaceCount(texture->dim); ++f)
+    {
+        u8* src = face;
+        for(u32 m = 1; m < texture->mipmapCount; ++m)
+        {
+            u32 const srcWidth = eastl::max(1u, texture->width >> (m - 1));
+            u32 const srcHeight = eastl::max(1u, texture->height >> (m - 1));
+            u32 const dstWidth = eastl::max(1u, texture->width >> m);
+            u32 const dstHeight = eastl::max(1u, texture->height >> m);
+            u8* dst = src + srcWidth * srcHeight * bytesPerPixel;
+
+            for(u32 y = 0; y < dstHeight; ++y)
+            {
+                u32 const y0 = eastl::min(y * 2, srcHeight - 1);
+                u32 const y1 = eastl::min(y * 2 + 1, srcHeight - 1);
+
+                TinyImageFormat_DecodeInput in0 = {};
+                in0.pixel = src + y0 * srcWidth * bytesPerPixel;
+                TinyImageFormat_DecodeLogicalPixelsF(format, &in0, srcWidth, &srcRows[0]);
+                TinyImageFormat_DecodeInput in1 = {};
+                in1.pixel = src + y1 * srcWidth * bytesPerPixel;
+                TinyImageFormat_DecodeLogicalPixelsF(format, &in1, srcWidth, &srcRows[srcWidth * 4]);
+
+                for(u32 x = 0; x < dstWidth; ++x)
+                {
+                    u32 const x0 = eastl::min(x * 2, srcWidth - 1);
+                    u32 const x1 = eastl::min(x * 2 + 1, srcWidth - 1);
+                    for(u32 c = 0; c < 4; ++c)
+                    {
+                        dstRow[x * 4 + c] = 0.25f * (srcRows[x0 * 4 + c] + srcRows[x1 * 4 + c]
+                            + srcRows[(srcWidth + x0) * 4 + c] + srcRows[(srcWidth + x1) * 4 + c]);
+                    }
+                }
+
+                TinyImageFormat_EncodeOutput out = {};
+                out.pixel = dst + y * dstWidth * bytesPerPixel;
+                TinyImageFormat_EncodeLogicalPixelsF(format, dstRow.data(), dstWidth, &out);
+            }
+
+            src = dst;
+        }
+        face = src + eastl::max(1u, texture->width >> (texture->mipmapCount - 1)) * eastl::max(1u, texture->height >> (texture->mipmapCount - 1)) * bytesPerPixel;
+    }
+}
+
+//*****************************************************************************
+// GfxBuffer Implementation
+//*****************************************************************************
+
+void GfxBuffer::createGfxObject(char const* tag, GfxMemoryType memoryType, void const* buf, rgSize size, GfxBufferUsage usage, GfxBuffer* obj)
+{
+    rgAssert(size > 0);
+
+    obj->nullMemory = rgMalloc(size);
+    rgAssert(obj->nullMemory != nullptr);
+
+    if(buf != nullptr)
+    {
+        memcpy(obj->nullMemory, buf, size);
+    }
+    else
+    {
+        memset(obj->nullMemory, 0, size);
+    }
+}
+
+void GfxBuffer::destroyGfxObject(GfxBuffer* obj)
+{
+    rgFree(obj->nullMemory);
+    obj->nullMemory = nullptr;
+}
+
+void* GfxBuffer::map(u32 rangeBeginOffset, u32 rangeSizeInBytes)
+{
+    rgAssert(rangeBeginOffset < size);
+    mappedMemory = (u8*)nullMemory + rangeBeginOffset;
+    return mappedMemory;
+}
+
+void GfxBuffer::unmap()
+{
+    mappedMemory = nullptr;
+}
+
+//*****************************************************************************
+// GfxSamplerState Implementation
+//*****************************************************************************
+
+void GfxSamplerState::createGfxObject(char const* tag, GfxSamplerAddressMode rstAddressMode, GfxSamplerMinMagFilter minFilter, GfxSamplerMinMagFilter magFilter, GfxSamplerMipFilter mipFilter, rgBool anisotropy, GfxSamplerState* obj)
+{
+}
+
+void GfxSamplerState::destroyGfxObject(GfxSamplerState* obj)
+{
+}
+
+//*****************************************************************************
+// GfxTexture Implementation
+//*****************************************************************************
+
+void GfxTexture::createGfxObject(char const* tag, GfxTextureDim dim, u32 width, u32 height, TinyImageFormat format, GfxTextureMipFlag mipFlag, GfxTextureUsage usage, ImageSlice* slices, GfxTexture* obj)
+{
+    u32 faceCount = getTextureFaceCount(dim);
+
+    // Memory layout: face0[mip0, mip1, ..], face1[mip0, mip1, ..], ..
+    rgSize totalSizeInBytes = 0;
+    for(u32 m = 0; m < obj->mipmapCount; ++m)
+    {
+        totalSizeInBytes += calcTextureSurfaceSizeInBytes(format, eastl::max(1u, width >> m), eastl::max(1u, height >> m));
+    }
+    totalSizeInBytes *= faceCount;
+
+    obj->nullMemory = rgMalloc(totalSizeInBytes);
+    rgAssert(obj->nullMemory != nullptr);
+
+    if(slices == nullptr)
+    {
+        return;
+    }
+
+    // When mips are generated, only the top level mip of each face is provided
+    u32 providedMipCount = (mipFlag == GfxTextureMipFlag_GenMips) ? 1 : obj->mipmapCount;
+
+    u8* dst = (u8*)obj->nullMemory;
+    for(u32 f = 0; f < faceCount; ++f)
+    {
+        for(u32 m = 0; m < obj->mipmapCount; ++m)
+        {
+            rgSize mipSizeInBytes = calcTextureSurfaceSizeInBytes(format, eastl::max(1u, width >> m), eastl::max(1u, height >> m));
+            if(m < providedMipCount)
+            {
+                ImageSlice* slice = &slices[f * providedMipCount + m];
+                memcpy(dst, slice->pixels, eastl::min((rgSize)slice->slicePitch, mipSizeInBytes));
+            }
+            dst += mipSizeInBytes;
+        }
+    }
+
+    if(mipFlag == GfxTextureMipFlag_GenMips)
+    {
+        SDL_AtomicLock(&frameBeginJobLock);
+        frameBeginJobGenTextureMipmaps.push_back(obj);
+        SDL_AtomicUnlock(&frameBeginJobLock);
+    }
+}
+
+void GfxTexture::destroyGfxObject(GfxTexture* obj)
+{
+    SDL_AtomicLock(&frameBeginJobLock);
+    frameBeginJobGenTextureMipmaps.erase(eastl::remove(frameBeginJobGenTextureMipmaps.begin(), frameBeginJobGenTextureMipmaps.end(), obj), frameBeginJobGenTextureMipmaps.end());
+    SDL_AtomicUnlock(&frameBeginJobLock);
+
+    rgFree(obj->nullMemory);
+    obj->nullMemory = nullptr;
+}
+
+//*****************************************************************************
+// GfxGraphicsPSO Implementation
+//*****************************************************************************
+
+void GfxGraphicsPSO::createGfxObject(char const* tag, GfxVertexInputDesc* vertexInputDesc, GfxShaderDesc* shaderDesc, GfxRenderStateDesc* renderStateDesc, GfxGraphicsPSO* obj)
+{
+    rgAssert(shaderDesc != nullptr);
+}
+
+void GfxGraphicsPSO::destroyGfxObject(GfxGraphicsPSO* obj)
+{
+}
+
+//*****************************************************************************
+// GfxComputePSO Implementation
+//*****************************************************************************
+
+void GfxComputePSO::createGfxObject(const char* tag, GfxShaderDesc* shaderDesc, GfxComputePSO* obj)
+{
+    rgAssert(shaderDesc != nullptr);
+}
+
+void GfxComputePSO::destroyGfxObject(GfxComputePSO* obj)
+{
+}
+
+//*****************************************************************************
+// GfxRenderCmdEncoder Implementation
+//*****************************************************************************
+
+void GfxRenderCmdEncoder::begin(char const* tag, GfxRenderPass* renderPass)
+{
+    rgAssert(renderPass != nullptr);
+    hasEnded = false;
+}
+
+void GfxRenderCmdEncoder::end()
+{
+    hasEnded = true;
+}
+
+//-----------------------------------------------------------------------------
+void GfxRenderCmdEncoder::pushDebugTag(const char* tag)
+{
+}
+
+void GfxRenderCmdEncoder::popDebugTag()
+{
+}
+
+//-----------------------------------------------------------------------------
+void GfxRenderCmdEncoder::setViewport(rgFloat4 viewport)
+{
+    setViewport(viewport.x, viewport.y, viewport.z, viewport.w);
+}
+
+void GfxRenderCmdEncoder::setViewport(f32 originX, f32 originY, f32 width, f32 height)
+{
+}
+
+void GfxRenderCmdEncoder::setScissorRect(u32 xPixels, u32 yPixels, u32 widthPixels, u32 heightPixels)
+{
+}
+
+//-----------------------------------------------------------------------------
+void GfxRenderCmdEncoder::setGraphicsPSO(GfxGraphicsPSO* pso)
+{
+    rgAssert(pso != nullptr);
+    GfxState::graphicsPSO = pso;
+}
+
+//-----------------------------------------------------------------------------
+void GfxRenderCmdEncoder::setVertexBuffer(GfxBuffer const* buffer, u32 offset, u32 slot)
+{
+    rgAssert(buffer != nullptr);
+}
+
+void GfxRenderCmdEncoder::setVertexBuffer(GfxFrameResource const* resource, u32 slot)
+{
+    rgAssert(resource != nullptr && resource->type == GfxFrameResource::Type_Buffer);
+}
+
+//-----------------------------------------------------------------------------
+GfxPipelineArgument* GfxRenderCmdEncoder::getPipelineArgument(char const* bindingTag)
+{
+    rgAssert(GfxState::graphicsPSO != nullptr);
+    rgAssert(bindingTag);
+
+    // Arguments are never reflected by the null renderer, but keep the lookup
+    // so that its cost is included in the measurements
+    auto infoIter = GfxState::graphicsPSO->arguments.find(bindingTag);
+    if(infoIter == GfxState::graphicsPSO->arguments.end())
+    {
+        return nullptr;
+    }
+    return &infoIter->second;
+}
+
+void GfxRenderCmdEncoder::bindBuffer(char const* bindingTag, GfxBuffer* buffer, u32 offset)
+{
+    rgAssert(buffer != nullptr);
+    getPipelineArgument(bindingTag);
+}
+
+void GfxRenderCmdEncoder::bindBuffer(char const* bindingTag, GfxFrameResource const* resource)
+{
+    rgAssert(resource != nullptr);
+    getPipelineArgument(bindingTag);
+}
+
+void GfxRenderCmdEncoder::bindTexture(char const* bindingTag, GfxTexture* texture)
+{
+    rgAssert(texture != nullptr);
+    getPipelineArgument(bindingTag);
+}
+
+void GfxRenderCmdEncoder::bindSamplerState(char const* bindingTag, GfxSamplerState* sampler)
+{
+    rgAssert(sampler != nullptr);
+    getPipelineArgument(bindingTag);
+}
+
+//-----------------------------------------------------------------------------
+void GfxRenderCmdEncoder::drawTriangles(u32 vertexStart, u32 vertexCount, u32 instanceCount)
+{
+    rgAssert(GfxState::graphicsPSO != nullptr);
+    ++g_FrameStats.drawCalls;
+}
+
+void GfxRenderCmdEncoder::drawIndexedTriangles(u32 indexCount, rgBool is32bitIndex, GfxBuffer const* indexBuffer, u32 bufferOffset, u32 instanceCount)
+{
+    rgAssert(GfxState::graphicsPSO != nullptr);
+    rgAssert(indexBuffer != nullptr);
+    rgAssert(bufferOffset + indexCount * (is32bitIndex ? 4 : 2) <= indexBuffer->size);
+    ++g_FrameStats.drawCalls;
+}
+
+void GfxRenderCmdEncoder::drawIndexedTriangles(u32 indexCount, rgBool is32bitIndex, GfxFrameResource const* indexBufferResource, u32 instanceCount)
+{
+    rgAssert(GfxState::graphicsPSO != nullptr);
+    rgAssert(indexBufferResource && indexBufferResource->type == GfxFrameResource::Type_Buffer);
+    ++g_FrameStats.drawCalls;
+}
+
+//*****************************************************************************
+// GfxComputeCmdEncoder Implementation
+//*****************************************************************************
+
+void GfxComputeCmdEncoder::begin(char const* tag)
+{
+    hasEnded = false;
+}
+
+void GfxComputeCmdEncoder::end()
+{
+    hasEnded = true;
+}
+
+void GfxComputeCmdEncoder::pushDebugTag(char const* tag)
+{
+}
+
+void GfxComputeCmdEncoder::popDebugTag()
+{
+}
+
+void GfxComputeCmdEncoder::setComputePSO(GfxComputePSO* pso)
+{
+    rgAssert(pso != nullptr);
+    GfxState::computePSO = pso;
+}
+
+GfxPipelineArgument* GfxComputeCmdEncoder::getPipelineArgument(char const* bindingTag)
+{
+    rgAssert(GfxState::computePSO != nullptr);
+    rgAssert(bindingTag);
+
+    auto infoIter = GfxState::computePSO->arguments.find(bindingTag);
+    if(infoIter == GfxState::computePSO->arguments.end())
+    {
+        return nullptr;
+    }
+    return &infoIter->second;
+}
+
+void GfxComputeCmdEncoder::bindBuffer(char const* bindingTag, GfxBuffer* buffer, u32 offset)
+{
+    rgAssert(buffer != nullptr);
+    getPipelineArgument(bindingTag);
+}
+
+void GfxComputeCmdEncoder::bindBuffer(char const* bindingTag, GfxFrameResource const* resource)
+{
+    rgAssert(resource != nullptr);
+    getPipelineArgument(bindingTag);
+}
+
+void GfxComputeCmdEncoder::bindBufferFromData(char const* bindingTag, u32 sizeInBytes, void* data)
+{
+    GfxFrameResource resource = gfxGetFrameAllocator()->newBuffer(bindingTag, sizeInBytes, data);
+    bindBuffer(bindingTag, &resource);
+}
+
+void GfxComputeCmdEncoder::bindTexture(char const* bindingTag, GfxTexture* texture)
+{
+    rgAssert(texture != nullptr);
+    getPipelineArgument(bindingTag);
+}
+
+void GfxComputeCmdEncoder::bindSamplerState(char const* bindingTag, GfxSamplerState* sampler)
+{
+    rgAssert(sampler != nullptr);
+    getPipelineArgument(bindingTag);
+}
+
+void GfxComputeCmdEncoder::dispatch(u32 threadgroupsGridX, u32 threadgroupsGridY, u32 threadgroupsGridZ)
+{
+    rgAssert(GfxState::computePSO != nullptr);
+}
+
+//*****************************************************************************
+// GfxBlitCmdEncoder Implementation
+//*****************************************************************************
+
+void GfxBlitCmdEncoder::begin(char const* tag)
+{
+    hasEnded = false;
+}
+
+void GfxBlitCmdEncoder::end()
+{
+    cmds.clear();
+    hasEnded = true;
+}
+
+void GfxBlitCmdEncoder::pushDebugTag(const char* tag)
+{
+}
+
+void GfxBlitCmdEncoder::genMips(GfxTexture* srcTexture)
+{
+    rgAssert(srcTexture != nullptr);
+
+    Cmd cmd;
+    cmd.type = Cmd::Type_GenMips;
+    cmd.genMips.tex = srcTexture;
+    cmds.push_back(cmd);
+}
+
+void GfxBlitCmdEncoder::copyTexture(GfxTexture* srcTexture, GfxTexture* dstTexture, u32 srcMipLevel, u32 dstMipLevel, u32 mipLevelCount)
+{
+    rgAssert(srcTexture != nullptr && dstTexture != nullptr);
+    rgAssert(srcTexture->format == dstTexture->format);
+    rgAssert(srcMipLevel + mipLevelCount <= srcTexture->mipmapCount);
+    rgAssert(dstMipLevel + mipLevelCount <= dstTexture->mipmapCount);
+
+    auto mipOffsetInBytes = [](GfxTexture* tex, u32 mipLevel) -> rgSize
+    {
+        rgSize offsetInBytes = 0;
+        for(u32 m = 0; m < mipLevel; ++m)
+        {
+            offsetInBytes += calcTextureSurfaceSizeInBytes(tex->format, eastl::max(1u, tex->width >> m), eastl::max(1u, tex->height >> m));
+        }
+        return offsetInBytes;
+    };
+
+    u8* src = (u8*)srcTexture->nullMemory + mipOffsetInBytes(srcTexture, srcMipLevel);
+    u8* dst = (u8*)dstTexture->nullMemory + mipOffsetInBytes(dstTexture, dstMipLevel);
+    for(u32 m = 0; m < mipLevelCount; ++m)
+    {
+        rgSize srcSizeInBytes = calcTextureSurfaceSizeInBytes(srcTexture->format, eastl::max(1u, srcTexture->width >> (srcMipLevel + m)), eastl::max(1u, srcTexture->height >> (srcMipLevel + m)));
+        rgSize dstSizeInBytes = calcTextureSurfaceSizeInBytes(dstTexture->format, eastl::max(1u, dstTexture->width >> (dstMipLevel + m)), eastl::max(1u, dstTexture->height >> (dstMipLevel + m)));
+        memcpy(dst, src, eastl::min(srcSizeInBytes, dstSizeInBytes));
+        src += srcSizeInBytes;
+        dst += dstSizeInBytes;
+    }
+}
+
+//*****************************************************************************
+// Frame Resource Allocator
+//*****************************************************************************
+
+void GfxFrameAllocator::create(u32 bufferHeapSize, u32 nonRTDSTextureHeapSize, u32 rtDSTextureHeapSize)
+{
+    capacity = bufferHeapSize + nonRTDSTextureHeapSize + rtDSTextureHeapSize;
+    heap = rgMalloc(capacity);
+    rgAssert(heap != nullptr);
+}
+
+void GfxFrameAllocator::destroy()
+{
+    releaseOverflowBlocks((u32)overflowHeaps.size());
+    rgFree(heap);
+    heap = nullptr;
+}
+
+void GfxFrameAllocator::recreateHeap(u32 newCapacity)
+{
+    rgFree(heap);
+    heap = rgMalloc(newCapacity);
+    rgAssert(heap != nullptr);
+    capacity = newCapacity;
+}
+
+void GfxFrameAllocator::createOverflowBlock(u32 size)
+{
+    void* block = rgMalloc(size);
+    rgAssert(block != nullptr);
+    overflowHeaps.push_back(block);
+}
+
+void GfxFrameAllocator::releaseOverflowBlocks(u32 count)
+{
+    for(u32 i = 0; i < count; ++i)
+    {
+        rgFree(overflowHeaps[i]);
+    }
+    overflowHeaps.erase(overflowHeaps.begin(), overflowHeaps.begin() + count);
+}
+
+void GfxFrameAllocator::releaseResources(u32 count)
+{
+}
+
+u32 GfxFrameAllocator::getResourceCount()
+{
+    return 0;
+}
+
+void GfxFrameAllocator::resetTextureHeaps(rgBool grow)
+{
+}
+
+GfxFrameResource GfxFrameAllocator::newBuffer(const char* tag, u32 size, void* initialData)
+{
+    void* mappedPtr = nullptr;
+    GfxFrameResource output = newBufferMapped(tag, size, &mappedPtr);
+    if(initialData != nullptr)
+    {
+        memcpy(mappedPtr, initialData, size);
+    }
+    return output;
+}
+
+GfxFrameResource GfxFrameAllocator::newBufferMapped(const char* tag, u32 size, void** outMappedPtr)
+{
+    // Same alignment as D3D12 constant buffers
+    u32 alignedSize = (size + 255) & ~255;
+    Allocation allocation = allocate(alignedSize, 256);
+
+    void* ptr = (u8*)((allocation.block == 0) ? heap : overflowHeaps[allocation.block - 1]) + allocation.offset;
+    if(outMappedPtr != nullptr)
+    {
+        *outMappedPtr = ptr;
+    }
+
+    GfxFrameResource output;
+    output.type = GfxFrameResource::Type_Buffer;
+    output.sizeInBytes = alignedSize;
+    output.nullMemory = ptr;
+
+    return output;
+}
+
+GfxFrameResource GfxFrameAllocator::newTexture2D(const char* tag, void* initialData, u32 width, u32 height, TinyImageFormat format, GfxTextureUsage usage)
+{
+    if(initialData != nullptr && (usage & GfxTextureUsage_MemorylessRenderTarget))
+    {
+        rgAssert(!"When texture usage is MemorylessRenderTraget, texture initial data can't be used");
+    }
+
+    u32 sizeInBytes = (u32)calcTextureSurfaceSizeInBytes(format, width, height);
+    Allocation allocation = allocate(sizeInBytes, 65536); // D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT
+
+    void* ptr = (u8*)((allocation.block == 0) ? heap : overflowHeaps[allocation.block - 1]) + allocation.offset;
+    if(initialData != nullptr)
+    {
+        memcpy(ptr, initialData, sizeInBytes);
+    }
+
+    GfxFrameResource output;
+    output.type = GfxFrameResource::Type_Texture;
+    output.sizeInBytes = sizeInBytes;
+    output.nullMemory = ptr;
+
+    return output;
+}
+
+//*****************************************************************************
+// Transient Texture Heap
+//*****************************************************************************
+
+// No placed textures, the transient pool only has committed ones
+rgBool gfxCreateTransientTextureHeap(rgSize sizeInBytes)
+{
+    return false;
+}
+
+void gfxDestroyTransientTextureHeap()
+{
+}
+
+rgBool gfxGetTransientTexturePlacement(u32 width, u32 height, TinyImageFormat format, GfxTextureUsage usage, rgSize* outSizeInBytes, rgSize* outAlignment)
+{
+    return false;
+}
+
+GfxTexture* gfxCreatePlacedTransientTexture(char const* tag, u32 width, u32 height, TinyImageFormat format, GfxTextureUsage usage, rgSize heapOffset)
+{
+    rgAssert(!"No transient texture heap");
+    return nullptr;
+}
+
+void gfxBeginTransientTextureAliasing(GfxTexture* texture)
+{
+    rgAssert(!"No transient texture heap");
+}
+
+//*****************************************************************************
+// Call from main | loop init() destroy() startNextFrame() endFrame()
+//*****************************************************************************
+
+i32 gfxInit()
+{
+    rgAssert(g_AppMainWindow);
+
+    backbufferTexture = GfxTexture::create("backbuffer", GfxTextureDim_2D, g_WindowInfo.width, g_WindowInfo.height, gfxGetBackbufferFormat(), GfxTextureMipFlag_1Mip, GfxTextureUsage_RenderTarget, nullptr);
+    backbufferTextureLinear = GfxTexture::create("backbufferLinear", GfxTextureDim_2D, g_WindowInfo.width, g_WindowInfo.height, convertSRGBToLinearFormat(gfxGetBackbufferFormat()), GfxTextureMipFlag_1Mip, GfxTextureUsage_RenderTarget, nullptr);
+
+    // There is no window to close, for benchmark runs the frame count is given via env var
+    char const* frameCountStr = SDL_getenv("RG_NULL_RNDR_FRAME_COUNT");
+    if(frameCountStr != nullptr)
+    {
+        quitAfterFrameCount = (u32)SDL_atoi(frameCountStr);
+        rgLog("Null renderer will quit after %u frames", quitAfterFrameCount);
+    }
+
+    return 0;
+}
+
+void gfxDestroy()
+{
+    ImGui_ImplSDL2_Shutdown();
+    GfxTexture::destroy(imguiFontTexture);
+    imguiFontTexture = nullptr;
+
+    GfxTexture::destroy(backbufferTexture);
+    GfxTexture::destroy(backbufferTextureLinear);
+    backbufferTexture = nullptr;
+    backbufferTextureLinear = nullptr;
+
+    frameBeginJobGenTextureMipmaps.set_capacity(0);
+}
+
+void gfxStartNextFrame()
+{
+    g_FrameIndex = (g_FrameIndex + 1) % RG_MAX_FRAMES_IN_FLIGHT;
+
+    // There is no GPU to wait on, every frame is considered completed
+    gfxAtFrameStart();
+}
+
+void gfxEndFrame()
+{
+    if(quitAfterFrameCount > 0 && g_FrameNumber >= quitAfterFrameCount)
+    {
+        g_ShouldAppQuit = true;
+    }
+}
+
+void gfxOnSizeChanged()
+{
+    // Nothing is in flight on a GPU, the old backbuffers go through the regular deferred destroy
+    GfxTexture::destroy(backbufferTexture);
+    GfxTexture::destroy(backbufferTextureLinear);
+
+    backbufferTexture = GfxTexture::create("backbuffer", GfxTextureDim_2D, g_WindowInfo.width, g_WindowInfo.height, gfxGetBackbufferFormat(), GfxTextureMipFlag_1Mip, GfxTextureUsage_RenderTarget, nullptr);
+    backbufferTextureLinear = GfxTexture::create("backbufferLinear", GfxTextureDim_2D, g_WindowInfo.width, g_WindowInfo.height, convertSRGBToLinearFormat(gfxGetBackbufferFormat()), GfxTextureMipFlag_1Mip, GfxTextureUsage_RenderTarget, nullptr);
+}
+
+void gfxRunOnFrameBeginJob()
+{
+    // Swap the queue out so loader threads aren't blocked while the mips are filtered
+    eastl::vector<GfxTexture*> textures;
+    SDL_AtomicLock(&frameBeginJobLock);
+    textures.swap(frameBeginJobGenTextureMipmaps);
+    SDL_AtomicUnlock(&frameBeginJobLock);
+
+    for(GfxTexture* texture : textures)
+    {
+        genTextureMipmapsOnCPU(texture);
+    }
+}
+
+void gfxSetBindlessResource(u32 slot, GfxTexture* ptr)
+{
+    rgAssert(ptr != nullptr);
+}
+
+void gfxRendererImGuiInit()
+{
+    ImGuiIO& io = ImGui::GetIO();
+    io.BackendRendererName = "imgui_impl_null";
+
+    // Build the font atlas, it is required before ImGui::NewFrame()
+    unsigned char* pixels;
+    int width, height;
+    io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+
+    ImageSlice fontSlice = {};
+    fontSlice.width = (u16)width;
+    fontSlice.height = (u16)height;
+    fontSlice.rowPitch = width * 4;
+    fontSlice.slicePitch = width * height * 4;
+    fontSlice.pixels = pixels;
+    imguiFontTexture = GfxTexture::create("imguiFont", GfxTextureDim_2D, width, height, TinyImageFormat_R8G8B8A8_UNORM, GfxTextureMipFlag_1Mip, GfxTextureUsage_ShaderRead, &fontSlice);
+    io.Fonts->SetTexID((ImTextureID)imguiFontTexture);
+
+    // There is no SDL_Renderer, the SDL2 backend will use the window size as display size
+    ImGui_ImplSDL2_InitForSDLRenderer(g_AppMainWindow, nullptr);
+}
+
+void gfxRendererImGuiNewFrame()
+{
+}
+
+void gfxRendererImGuiRenderDrawData(ImDrawData* drawData)
+{
+    // Copy the vertices and indices in frame allocator like the GPU backends do
+    if(drawData == nullptr || drawData->TotalVtxCount <= 0)
+    {
+        return;
+    }
+
+    for(i32 n = 0; n < drawData->CmdListsCount; ++n)
+    {
+        ImDrawList const* drawList = drawData->CmdLists[n];
+        gfxGetFrameAllocator()->newBuffer("imguiVertexBuffer", drawList->VtxBuffer.Size * sizeof(ImDrawVert), drawList->VtxBuffer.Data);
+        gfxGetFrameAllocator()->newBuffer("imguiIndexBuffer", drawList->IdxBuffer.Size * sizeof(ImDrawIdx), drawList->IdxBuffer.Data);
+    }
+}
+
+GfxTexture* gfxGetBackbufferTexture()
+{
+    return backbufferTexture;
+}
+
+GfxTexture* gfxGetBackbufferTextureLinear()
+{
+    return backbufferTextureLinear;
+}
+
+TinyImageFormat gfxGetBackbufferFormat()
+{
+    return TinyImageFormat_R8G8B8A8_SRGB;
+}
+
+#endif
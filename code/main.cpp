@@ -16,7 +16,6 @@
 #include "shaders/shaderinterop_common.h"
 
 // TODO:
-// 2. Add rgLogDebug() rgLogError()
 // 3. Then use the suitable rgLogXXX() version in VKDbgReportCallback Function based on msgType 
 // 4. Integrate EASTL
 //
@@ -25,11 +24,13 @@ GameState* g_GameState;
 PhysicSystem* g_PhysicSystem;
 Viewport* g_Viewport;
 
-eastl::vector<GfxTexture*> debugTextureHandles;
+eastl::vector<TextureRef> debugTextureHandles;
+SpriteBatch* staticSprites;
 
 FontRef inconFont;
 
 GfxGraphicsPSO* simple2DPSO;
+GfxGraphicsPSO* simple2DInstancedPSO;
 GfxGraphicsPSO* skyboxPSO;
 GfxComputePSO*  tonemapGenerateHistogramPSO;
 GfxComputePSO*  tonemapClearOutputLuminanceHistogramPSO;
@@ -39,9 +40,10 @@ GfxComputePSO*  compositePSO;
 GfxGraphicsPSO* principledBrdfPSO;
 GfxGraphicsPSO* gridPSO;
 
+GfxTexture* tinyTex;
 GfxTexture* sangiuseppeBridgeCubeTex;
 GfxTexture* sangiuseppeBridgeCubeIrradianceTex;
-GfxTexture* japaneseStoneWallDiff1kTex;
+TextureRef  japaneseStoneWallDiff1kTex;
 
 GfxBuffer* skyboxVertexBuffer;
 GfxBuffer* outputLuminanceHistogramBuffer;
@@ -51,7 +53,7 @@ i32 setup()
     g_GameState = rgNew(GameState);
 
     ImageRef tinyTexture = loadImage("tiny.tga");
-    GfxTexture::create("tiny", GfxTextureDim_2D, tinyTexture->width, tinyTexture->height, tinyTexture->format, GfxTextureMipFlag_1Mip, GfxTextureUsage_ShaderRead, tinyTexture->slices);
+    tinyTex = GfxTexture::create("tiny", GfxTextureDim_2D, tinyTexture->width, tinyTexture->height, tinyTexture->format, GfxTextureMipFlag_1Mip, GfxTextureUsage_ShaderRead, tinyTexture->slices);
     //gfx::texture->destroy(rgCRC32("tiny"));
     // TODO: don't call destoy on first frame  gfx::onFrameBegin
     
@@ -59,13 +61,14 @@ i32 setup()
     {
         char path[256];
         snprintf(path, 256, "debugTextures/textureSlice%d.png", i);
-        ImageRef t = loadImage(path);
-        GfxTexture* t2d = GfxTexture::create(path, GfxTextureDim_2D, t->width, t->height, t->format, GfxTextureMipFlag_1Mip, GfxTextureUsage_ShaderRead, t->slices);
-        debugTextureHandles.push_back(t2d);
+        debugTextureHandles.push_back(loadTexture(path, TextureLoadFlags_SRGB));
     }
 
-    ImageRef flowerTex = loadImage("flower.png");
-    g_GameState->flowerTexture = GfxTexture::create("flower", GfxTextureDim_2D, flowerTex->width, flowerTex->height, flowerTex->format, GfxTextureMipFlag_GenMips, GfxTextureUsage_ShaderRead, flowerTex->slices);
+    g_GameState->flowerTexture = loadTexture("flower.png");
+
+    // 2D art that doesn't move, uploaded once instead of every frame
+    staticSprites = rgNew(SpriteBatch)("staticSprites");
+    staticSprites->add(defaultQuadUV, {200.0f, 300.0f, 447.0f, 400.0f}, 0xFFFFFFFF, {0, 0, 0, 1}, g_GameState->flowerTexture);
     
     //gfxDestroyBuffer("ocean_tile");
     g_GameState->shaderballModel = loadModel("shaderball_test1.xml");
@@ -106,6 +109,12 @@ i32 setup()
     //simple2dRenderStateDesc.triangleFillMode = GfxTriangleFillMode_Lines;
     
     simple2DPSO = GfxGraphicsPSO::create("simple2d", &vertexDesc, &simple2dShaderDesc, &simple2dRenderStateDesc);
+
+    GfxVertexInputDesc quadInstanceDesc = makeTexturedQuadInstanceInputDesc();
+    GfxShaderDesc simple2dInstancedShaderDesc = simple2dShaderDesc;
+    simple2dInstancedShaderDesc.vsEntrypoint = "vsSimple2dInstanced";
+    simple2dInstancedShaderDesc.fsEntrypoint = "fsSimple2dInstanced";
+    simple2DInstancedPSO = GfxGraphicsPSO::create("simple2dInstanced", &quadInstanceDesc, &simple2dInstancedShaderDesc, &simple2dRenderStateDesc);
     
     //
     GfxVertexInputDesc vertexPosTexCoordNormal = {};
@@ -222,12 +231,8 @@ i32 setup()
     // Initialize show/hide vars
     g_GameState->debugShowGrid = false;
     
-    g_PhysicSystem = rgNew(PhysicSystem);
-    
-    g_GameState->baseColor2DRT = GfxTexture::create("baseColor2DRT", GfxTextureDim_2D, g_WindowInfo.width, g_WindowInfo.height, TinyImageFormat_R8G8B8A8_UNORM, GfxTextureMipFlag_1Mip, GfxTextureUsage_RenderTarget, nullptr);
-    
-    g_GameState->baseColorRT = GfxTexture::create("baseColorRT", GfxTextureDim_2D, g_WindowInfo.width, g_WindowInfo.height, TinyImageFormat_R16G16B16A16_SFLOAT, GfxTextureMipFlag_1Mip, GfxTextureUsage_RenderTarget, nullptr);
-    g_GameState->depthStencilRT = GfxTexture::create("depthStencilRT", GfxTextureDim_2D, g_WindowInfo.width, g_WindowInfo.height, TinyImageFormat_D32_SFLOAT, GfxTextureMipFlag_1Mip, GfxTextureUsage_DepthStencil, nullptr);
+    g_PhysicSystem = rgNew(PhysicSystem)(); // Zeroed, every particle starts at rest at the origin
+    g_PhysicSystem->gravity = {0.0f, -9.8f, 0.0f};
     
     ImageRef sanGiuseppeBridgeCube = loadImage("small_empty_room_1_alb.dds"); // je_gray_02.dds
     sangiuseppeBridgeCubeTex = GfxTexture::create("sangiuseppeBridgeCube", GfxTextureDim_Cube, sanGiuseppeBridgeCube->width, sanGiuseppeBridgeCube->height, sanGiuseppeBridgeCube->format, GfxTextureMipFlag_1Mip, GfxTextureUsage_ShaderRead, sanGiuseppeBridgeCube->slices);
@@ -237,8 +242,7 @@ i32 setup()
     
     
     ///
-    ImageRef japaneseStoneWall1k = loadImage("japanese_stone_wall_1k/japanese_stone_wall_diff_1k.png");
-    japaneseStoneWallDiff1kTex = GfxTexture::create("japanese_stone_wall_diff_1k", GfxTextureDim_2D, japaneseStoneWall1k->width, japaneseStoneWall1k->height, japaneseStoneWall1k->format, GfxTextureMipFlag_GenMips, GfxTextureUsage_ShaderRead, japaneseStoneWall1k->slices);
+    japaneseStoneWallDiff1kTex = loadTexture("japanese_stone_wall_1k/japanese_stone_wall_diff_1k.png");
     ///
 
     skyboxVertexBuffer = GfxBuffer::create("skyboxVertexBuffer", GfxMemoryType_Default, g_SkyboxVertices, sizeof(g_SkyboxVertices), GfxBufferUsage_VertexBuffer);
@@ -276,8 +280,85 @@ i32 setup()
     return 0;
 }
 
+void teardown()
+{
+    inconFont = nullptr;
+
+    GfxBuffer::destroy(outputLuminanceHistogramBuffer);
+    GfxBuffer::destroy(skyboxVertexBuffer);
+
+    japaneseStoneWallDiff1kTex = nullptr;
+    GfxTexture::destroy(sangiuseppeBridgeCubeIrradianceTex);
+    GfxTexture::destroy(sangiuseppeBridgeCubeTex);
+
+    rgDelete(g_PhysicSystem);
+    rgDelete(g_Viewport);
+
+    GfxComputePSO::destroy(compositePSO);
+    GfxComputePSO::destroy(tonemapReinhardPSO);
+    GfxComputePSO::destroy(tonemapComputeAvgLuminancePSO);
+    GfxComputePSO::destroy(tonemapClearOutputLuminanceHistogramPSO);
+    GfxComputePSO::destroy(tonemapGenerateHistogramPSO);
+    GfxGraphicsPSO::destroy(skyboxPSO);
+    GfxGraphicsPSO::destroy(gridPSO);
+    GfxGraphicsPSO::destroy(principledBrdfPSO);
+    GfxGraphicsPSO::destroy(simple2DInstancedPSO);
+    GfxGraphicsPSO::destroy(simple2DPSO);
+
+    debugTextureHandles.set_capacity(0);
+    GfxTexture::destroy(tinyTex);
+
+    rgDelete(staticSprites);
+    rgDelete(g_GameState);
+}
+
+// Everything the passes need of a frame. Filled by updateDemo() without
+// touching the gfx API, so in the pipelined mode it goes in the frame packet
+struct CommonParams
+{
+    f32 cameraBasisMatrix[9];
+    f32 _padding1[3];
+    f32 cameraViewMatrix[16];
+    f32 cameraProjMatrix[16];
+    f32 cameraViewProjMatrix[16];
+    f32 cameraInvViewMatrix[16];
+    f32 cameraInvProjMatrix[16];
+    f32 cameraViewRotOnlyMatrix[16];
+    f32 cameraNear;
+    f32 cameraFar;
+    f32 timeDelta;
+    f32 timeGame;
+};
+
+struct DemoFrame
+{
+    CommonParams    commonParams;
+    TexturedQuads   characterPortraits;
+    f32             tonemapperMinLogLuminance;
+    f32             tonemapperMaxLogLuminance;
+    f32             tonemapperAdaptationRate;
+    f32             tonemapperExposureKey;
+    rgBool          debugShowGrid;
+};
+
+// Render thread results for the ImGui windows, which are on the update thread in the pipelined mode
+struct DemoReadback
+{
+    GfxFrameStats               frameStats;
+    GfxFrameAllocatorStats      frameAllocatorStats;
+    GfxTransientTextureStats    transientTextureStats;
+    f32                         histogram[LUMINANCE_HISTOGRAM_BINS_COUNT];
+    f32                         adaptedLuminance;
+    f32                         exposure;
+};
+
+static DemoReadback demoReadback;
+static SDL_SpinLock demoReadbackLock;
+
 static bool showPostFXEditor = true;
 static bool showImGuiDemo = false;
+static bool showProfiler = false;
+static bool showMemory = false;
 static void showDebugInterface(bool* open)
 {
     static int location = 0;
@@ -311,7 +392,19 @@ static void showDebugInterface(bool* open)
         //}
         //ImGui::Text("%0.1f FPS (Avg)", 1.0 / (lastFewDeltaTSum / rgARRAY_COUNT(lastFewDeltaTs)));
         
+        SDL_AtomicLock(&demoReadbackLock);
+        GfxFrameStats frameStats = demoReadback.frameStats;
+        GfxFrameAllocatorStats frameAllocatorStats = demoReadback.frameAllocatorStats;
+        GfxTransientTextureStats transientTextureStats = demoReadback.transientTextureStats;
+        SDL_AtomicUnlock(&demoReadbackLock);
+
         ImGui::Text("%0.1f FPS (Avg)", io.Framerate);
+        ImGui::Text("%u draws, %u quads in %u draws, %u sprites uploaded", frameStats.drawCalls, frameStats.texturedQuads, frameStats.texturedQuadDraws, frameStats.spriteBatchUploads);
+        ImGui::Text("%u quads visible, %u culled", frameStats.texturedQuads, frameStats.texturedQuadsCulled);
+        ImGui::Text("Frame allocator %u KB last, %u KB peak of %u KB, %u overflows, %u grows", frameAllocatorStats.lastFrameSize / 1024, frameAllocatorStats.highWaterMark / 1024, frameAllocatorStats.capacity / 1024, frameAllocatorStats.overflowFrameCount, frameAllocatorStats.growCount);
+        TextureCacheStats textureCacheStats = getTextureCacheStats();
+        ImGui::Text("%u cached textures, %u hits, %u misses, %u evicted", textureCacheStats.entryCount, textureCacheStats.hits, textureCacheStats.misses, textureCacheStats.evictions);
+        ImGui::Text("%u transient textures, %u KB, %u KB saved by reuse and aliasing", transientTextureStats.textureCount, (u32)(transientTextureStats.allocatedBytes / 1024), (u32)(transientTextureStats.savedBytes / 1024));
         ImGui::Separator();
 
         ImGui::Text("GameLib");
@@ -342,6 +435,16 @@ static void showDebugInterface(bool* open)
                 showImGuiDemo = !showImGuiDemo;
             }
 
+            if(ImGui::MenuItem("Profiler", NULL, showProfiler))
+            {
+                showProfiler = !showProfiler;
+            }
+
+            if(ImGui::MenuItem("Memory", NULL, showMemory))
+            {
+                showMemory = !showMemory;
+            }
+
             if(open && ImGui::MenuItem("Close")) *open = false;
             ImGui::EndPopup();
         }
@@ -349,31 +452,19 @@ static void showDebugInterface(bool* open)
     ImGui::End();
 }
 
-i32 updateAndDraw(f64 dt)
+// Input, simulation and ImGui of the frame, must not call the gfx API
+static void updateDemo(DemoFrame* frame)
 {
     //rgLog("DeltaTime:%f FPS:%.1f\n", dt, 1.0/dt);
     if(showImGuiDemo) { ImGui::ShowDemoWindow(&showImGuiDemo); }
+    if(showProfiler) { profilerShowImGuiWindow(&showProfiler); }
+    if(showMemory) { memShowImGuiWindow(&showMemory); }
     showDebugInterface(NULL);
     
     g_Viewport->tick();
 
     // PREPARE COMMON RESOURCES & DATA
-    struct CommonParams
-    {
-        f32 cameraBasisMatrix[9];
-        f32 _padding1[3];
-        f32 cameraViewMatrix[16];
-        f32 cameraProjMatrix[16];
-        f32 cameraViewProjMatrix[16];
-        f32 cameraInvViewMatrix[16];
-        f32 cameraInvProjMatrix[16];
-        f32 cameraViewRotOnlyMatrix[16];
-        f32 cameraNear;
-        f32 cameraFar;
-        f32 timeDelta;
-        f32 timeGame;
-    } commonParams;
-    
+    CommonParams& commonParams = frame->commonParams;
     copyMatrix3ToFloatArray(commonParams.cameraBasisMatrix, g_Viewport->cameraBasis);
     copyMatrix4ToFloatArray(commonParams.cameraViewMatrix, g_Viewport->cameraView);
     copyMatrix4ToFloatArray(commonParams.cameraProjMatrix, g_Viewport->cameraProjection);
@@ -386,51 +477,90 @@ i32 updateAndDraw(f64 dt)
     commonParams.timeDelta = (f32)theAppInput->deltaTime;
     commonParams.timeGame  = (f32)theAppInput->time;
 
-    GfxFrameResource commonParamsBuffer = gfxGetFrameAllocator()->newBuffer("commonParams", sizeof(commonParams), &commonParams);
-    
-    // RENDER SIMPLE 2D STUFF
+    // SIMPLE 2D STUFF
+    for(i32 i = 0; i < 4; ++i)
     {
-        g_GameState->characterPortraits.erase(g_GameState->characterPortraits.begin(), g_GameState->characterPortraits.end());
-        for(i32 i = 0; i < 4; ++i)
+        for(i32 j = 0; j < 4; ++j)
         {
-            for(i32 j = 0; j < 4; ++j)
-            {
-                f32 px = (f32)(j * (100) + 10 * (j + 1) + sin(theAppInput->time) * 30);
-                f32 py = (f32)(i * (100) + 10 * (i + 1) + cos(theAppInput->time) * 30);
-                
-                pushTexturedQuad(&g_GameState->characterPortraits, SpriteLayer_0, defaultQuadUV, {px, py, 100.0f, 100.0f}, 0xFFFFFFFF, {0, 0, 0, 0}, debugTextureHandles[j + i * 4]);
-            }
+            f32 px = (f32)(j * (100) + 10 * (j + 1) + sin(theAppInput->time) * 30);
+            f32 py = (f32)(i * (100) + 10 * (i + 1) + cos(theAppInput->time) * 30);
+            
+            pushTexturedQuad(&frame->characterPortraits, SpriteLayer_0, defaultQuadUV, {px, py, 100.0f, 100.0f}, 0xFFFFFFFF, {0, 0, 0, 1}, debugTextureHandles[j + i * 4].get());
         }
-        pushTexturedQuad(&g_GameState->characterPortraits, SpriteLayer_0, defaultQuadUV, {200.0f, 300.0f, 447.0f, 400.0f}, 0xFFFFFFFF, {0, 0, 0, 0}, g_GameState->flowerTexture);
-        
-        pushText(&g_GameState->characterPortraits, 600, 500, inconFont, 1.0f, "Hello from rg_gamelib");
-        
-        GfxRenderPass simple2dRenderPass = {};
-        simple2dRenderPass.colorAttachments[0].texture = g_GameState->baseColor2DRT;
-        simple2dRenderPass.colorAttachments[0].loadAction = GfxLoadAction_Clear;
-        simple2dRenderPass.colorAttachments[0].storeAction = GfxStoreAction_Store;
-        simple2dRenderPass.colorAttachments[0].clearColor = { 0.0f, 0.0f, 0.0f, 0.0f };
-        simple2dRenderPass.depthStencilAttachmentTexture = g_GameState->depthStencilRT;
-        simple2dRenderPass.depthStencilAttachmentLoadAction = GfxLoadAction_Clear;
-        simple2dRenderPass.depthStencilAttachmentStoreAction = GfxStoreAction_Store;
-        simple2dRenderPass.clearDepth = 1.0f;
-        
-        GfxRenderCmdEncoder* simple2dRenderEncoder = gfxSetRenderPass("Simple2D Pass", &simple2dRenderPass);
-        simple2dRenderEncoder->setGraphicsPSO(simple2DPSO);
-        simple2dRenderEncoder->drawTexturedQuads(&g_GameState->characterPortraits, nullptr, nullptr);
-        simple2dRenderEncoder->end();
     }
-     
+    pushText(&frame->characterPortraits, 600, 500, inconFont, 1.0f, "Hello from rg_gamelib");
+
+    if(showPostFXEditor)
+    {
+        ImGui::SetNextWindowBgAlpha(0.0f); // Transparent background
+        if(ImGui::Begin("PostFX Editor", &showPostFXEditor))
+        {
+            ImGui::DragFloatRange2("LogLuminance", &g_GameState->tonemapperMinLogLuminance, &g_GameState->tonemapperMaxLogLuminance, 0.1f, -20.0f, 20.0f, "Min: %.1f", "Max: %.1f", ImGuiSliderFlags_AlwaysClamp);
+            ImGui::InputFloat("ExposureKey", &g_GameState->tonemapperExposureKey, 0.01f);
+            ImGui::InputFloat("AdaptationRate", &g_GameState->tonemapperAdaptationRate, 0.1f);
+            ImGui::SeparatorText("Histogram");
+#ifndef RG_D3D12_RNDR
+            SDL_AtomicLock(&demoReadbackLock);
+            float histogram[LUMINANCE_HISTOGRAM_BINS_COUNT];
+            SDL_memcpy(histogram, demoReadback.histogram, sizeof(histogram));
+            f32 adaptedLuminance = demoReadback.adaptedLuminance;
+            f32 exposure = demoReadback.exposure;
+            SDL_AtomicUnlock(&demoReadbackLock);
+
+            ImGui::PlotHistogram("##luminanceHistogram", histogram, rgArrayCount(histogram), 0, "luminanceHistogram", FLT_MAX, FLT_MAX, ImVec2(LUMINANCE_HISTOGRAM_BINS_COUNT * (LUMINANCE_BLOCK_SIZE < 32 ? 2 : 1), 100));
+            ImGui::Text("Adapted Luminance is %0.2f, and exposure is %0.2f", adaptedLuminance, exposure);
+#endif // !RG_D3D12_RNDR
+        }
+        ImGui::End();
+    }
+
+    frame->tonemapperMinLogLuminance = g_GameState->tonemapperMinLogLuminance;
+    frame->tonemapperMaxLogLuminance = g_GameState->tonemapperMaxLogLuminance;
+    frame->tonemapperAdaptationRate = g_GameState->tonemapperAdaptationRate;
+    frame->tonemapperExposureKey = g_GameState->tonemapperExposureKey;
+    frame->debugShowGrid = g_GameState->debugShowGrid;
+}
+
+// Records the passes of the frame, must not touch the game state
+static void renderDemo(DemoFrame* frame)
+{
+    // Results of the frames the GPU finished, for the ImGui windows
+    SDL_AtomicLock(&demoReadbackLock);
+    demoReadback.frameStats = *gfxGetLastFrameStats();
+    demoReadback.frameAllocatorStats = gfxGetFrameAllocatorStats();
+    demoReadback.transientTextureStats = gfxGetTransientTextureStats();
+#ifndef RG_D3D12_RNDR
+    u8* luminanceOutputBuffer = (u8*)outputLuminanceHistogramBuffer->map(0, 0);
+    u32* histogramData = (u32*)(luminanceOutputBuffer + LUMINANCE_BUFFER_OFFSET_HISTOGRAM);
+    for(int i = 0; i < rgArrayCount(demoReadback.histogram); ++i)
+    {
+        demoReadback.histogram[i] = histogramData[i];
+    }
+    demoReadback.adaptedLuminance = *(f32*)(luminanceOutputBuffer + LUMINANCE_BUFFER_OFFSET_LUMINANCE);
+    demoReadback.exposure = *(f32*)(luminanceOutputBuffer + LUMINANCE_BUFFER_OFFSET_EXPOSURE);
+    outputLuminanceHistogramBuffer->unmap();
+#endif // !RG_D3D12_RNDR
+    SDL_AtomicUnlock(&demoReadbackLock);
+
+    GfxFrameResource commonParamsBuffer = gfxGetFrameAllocator()->newBuffer("commonParams", sizeof(frame->commonParams), &frame->commonParams);
+    
+    // Render targets come from the transient pool every frame, so they follow the window size.
+    // Each one is released after its last pass, baseColor2DRT is acquired once baseColorRT is
+    // released so it can alias its memory
+    GfxTexture* baseColorRT = gfxAcquireTransientTexture("baseColorRT", g_WindowInfo.width, g_WindowInfo.height, TinyImageFormat_R16G16B16A16_SFLOAT, GfxTextureUsage_RenderTarget);
+    GfxTexture* depthStencilRT = gfxAcquireTransientTexture("depthStencilRT", g_WindowInfo.width, g_WindowInfo.height, TinyImageFormat_D32_SFLOAT, GfxTextureUsage_DepthStencil);
+
     // 1. demo scene render - draw ground plane and shaderball instances
     {
         GfxRenderPass sceneForwardPass = {};
-        sceneForwardPass.colorAttachments[0].texture = g_GameState->baseColorRT;
+        sceneForwardPass.colorAttachments[0].texture = baseColorRT;
         sceneForwardPass.colorAttachments[0].loadAction = GfxLoadAction_Clear;
         sceneForwardPass.colorAttachments[0].storeAction = GfxStoreAction_Store;
         sceneForwardPass.colorAttachments[0].clearColor = { 1.0f, 1.0f, 1.0f, 1.0f };
-        sceneForwardPass.depthStencilAttachmentTexture = g_GameState->depthStencilRT;
-        sceneForwardPass.depthStencilAttachmentLoadAction = GfxLoadAction_Load;
+        sceneForwardPass.depthStencilAttachmentTexture = depthStencilRT;
+        sceneForwardPass.depthStencilAttachmentLoadAction = GfxLoadAction_Clear;
         sceneForwardPass.depthStencilAttachmentStoreAction = GfxStoreAction_Store;
+        sceneForwardPass.clearDepth = 1.0f;
         
         GfxRenderCmdEncoder* sceneFowardRenderEncoder = gfxSetRenderPass("Scene Forward", &sceneForwardPass);
         sceneFowardRenderEncoder->setGraphicsPSO(principledBrdfPSO);
@@ -451,22 +581,24 @@ i32 updateAndDraw(f64 dt)
         
         sceneFowardRenderEncoder->bindBuffer("commonParams", &commonParamsBuffer);
         sceneFowardRenderEncoder->bindBuffer("instanceParams", &demoSceneMeshInstanceParams);
-        sceneFowardRenderEncoder->bindTexture("diffuseTexMap", japaneseStoneWallDiff1kTex);
+        sceneFowardRenderEncoder->bindTexture("diffuseTexMap", japaneseStoneWallDiff1kTex.get());
         sceneFowardRenderEncoder->bindTexture("irradianceMap", sangiuseppeBridgeCubeIrradianceTex);
         sceneFowardRenderEncoder->bindSamplerState("irradianceSampler", GfxState::samplerBilinearClampEdge);
         
-        for(i32 i = 0; i < g_GameState->shaderballModel->meshes.size(); ++i)
+        // The model is loaded in setup() and never changes, so it's shared with the update thread
+        Model* shaderballModel = g_GameState->shaderballModel.get();
+        for(i32 i = 0; i < shaderballModel->meshes.size(); ++i)
         {
-            Mesh* m = &g_GameState->shaderballModel->meshes[i];
+            Mesh* m = &shaderballModel->meshes[i];
             
-            sceneFowardRenderEncoder->setVertexBuffer(g_GameState->shaderballModel->vertexIndexBuffer, g_GameState->shaderballModel->vertexBufferOffset +  m->vertexDataOffset, 0);
+            sceneFowardRenderEncoder->setVertexBuffer(shaderballModel->vertexIndexBuffer, shaderballModel->vertexBufferOffset +  m->vertexDataOffset, 0);
             if(m->properties & MeshProperties_Has32BitIndices)
             {
-                sceneFowardRenderEncoder->drawIndexedTriangles(m->indexCount, true, g_GameState->shaderballModel->vertexIndexBuffer, g_GameState->shaderballModel->index32BufferOffset + m->indexDataOffset, 1);
+                sceneFowardRenderEncoder->drawIndexedTriangles(m->indexCount, true, shaderballModel->vertexIndexBuffer, shaderballModel->index32BufferOffset + m->indexDataOffset, 1);
             }
             else
             {
-                sceneFowardRenderEncoder->drawIndexedTriangles(m->indexCount, false, g_GameState->shaderballModel->vertexIndexBuffer, g_GameState->shaderballModel->index16BufferOffset + m->indexDataOffset, 1);
+                sceneFowardRenderEncoder->drawIndexedTriangles(m->indexCount, false, shaderballModel->vertexIndexBuffer, shaderballModel->index16BufferOffset + m->indexDataOffset, 1);
             }
         }
 
@@ -476,11 +608,11 @@ i32 updateAndDraw(f64 dt)
     // RENDER GRID AND EDITOR STUFF
     {
         GfxRenderPass skyboxRenderPass = {};
-        skyboxRenderPass.colorAttachments[0].texture = g_GameState->baseColorRT;
+        skyboxRenderPass.colorAttachments[0].texture = baseColorRT;
         skyboxRenderPass.colorAttachments[0].loadAction = GfxLoadAction_Load;
         skyboxRenderPass.colorAttachments[0].storeAction = GfxStoreAction_Store;
         skyboxRenderPass.colorAttachments[0].clearColor = { 1.0f, 1.0f, 0.0f, 1.0f };
-        skyboxRenderPass.depthStencilAttachmentTexture = g_GameState->depthStencilRT;
+        skyboxRenderPass.depthStencilAttachmentTexture = depthStencilRT;
         skyboxRenderPass.depthStencilAttachmentLoadAction = GfxLoadAction_Load;
         skyboxRenderPass.depthStencilAttachmentStoreAction = GfxStoreAction_Store;
         
@@ -493,13 +625,13 @@ i32 updateAndDraw(f64 dt)
         skyboxRenderEncoder->drawTriangles(0, 36, 1);
         skyboxRenderEncoder->end();
         
-        if(g_GameState->debugShowGrid)
+        if(frame->debugShowGrid)
         {
             GfxRenderPass gridRenderPass = {};
-            gridRenderPass.colorAttachments[0].texture = g_GameState->baseColorRT;
+            gridRenderPass.colorAttachments[0].texture = baseColorRT;
             gridRenderPass.colorAttachments[0].loadAction = GfxLoadAction_Load;
             gridRenderPass.colorAttachments[0].storeAction = GfxStoreAction_Store;
-            gridRenderPass.depthStencilAttachmentTexture = g_GameState->depthStencilRT;
+            gridRenderPass.depthStencilAttachmentTexture = depthStencilRT;
             gridRenderPass.depthStencilAttachmentLoadAction = GfxLoadAction_Load;
             gridRenderPass.depthStencilAttachmentStoreAction = GfxStoreAction_Store;
             
@@ -511,36 +643,6 @@ i32 updateAndDraw(f64 dt)
         }
         
         {
-            if(showPostFXEditor)
-            {
-                ImGui::SetNextWindowBgAlpha(0.0f); // Transparent background
-                if(ImGui::Begin("PostFX Editor", &showPostFXEditor))
-                {
-                    ImGui::DragFloatRange2("LogLuminance", &g_GameState->tonemapperMinLogLuminance, &g_GameState->tonemapperMaxLogLuminance, 0.1f, -20.0f, 20.0f, "Min: %.1f", "Max: %.1f", ImGuiSliderFlags_AlwaysClamp);
-                    ImGui::InputFloat("ExposureKey", &g_GameState->tonemapperExposureKey, 0.01f);
-                    ImGui::InputFloat("AdaptationRate", &g_GameState->tonemapperAdaptationRate, 0.1f);
-                    ImGui::SeparatorText("Histogram");
-#ifndef RG_D3D12_RNDR
-                    u8* luminanceOutputBuffer = (u8*)outputLuminanceHistogramBuffer->map(0, 0);
-                    
-                    u32* histogramData = (u32*)(luminanceOutputBuffer + LUMINANCE_BUFFER_OFFSET_HISTOGRAM);
-                    float histogram[LUMINANCE_HISTOGRAM_BINS_COUNT];
-                    for(int i = 0; i < rgArrayCount(histogram); ++i)
-                    {
-                        histogram[i] = histogramData[i];
-                    }
-                    
-                    ImGui::PlotHistogram("##luminanceHistogram", histogram, rgArrayCount(histogram), 0, "luminanceHistogram", FLT_MAX, FLT_MAX, ImVec2(LUMINANCE_HISTOGRAM_BINS_COUNT * (LUMINANCE_BLOCK_SIZE < 32 ? 2 : 1), 100));
-                    f32 adaptedLuminance = *(f32*)(luminanceOutputBuffer + LUMINANCE_BUFFER_OFFSET_LUMINANCE);
-                    f32 exposure = *(f32*)(luminanceOutputBuffer + LUMINANCE_BUFFER_OFFSET_EXPOSURE);
-                    ImGui::Text("Adapted Luminance is %0.2f, and exposure is %0.2f", adaptedLuminance, exposure);
-                    
-                    outputLuminanceHistogramBuffer->unmap();
-#endif // !RG_D3D12_RNDR
-                }
-                ImGui::End();
-            }
-     
             struct TonemapParams
             {
                 u32   inputImageWidth;
@@ -556,11 +658,11 @@ i32 updateAndDraw(f64 dt)
             tonemapParams.inputImageWidth = g_WindowInfo.width;
             tonemapParams.inputImageHeight = g_WindowInfo.height;
             tonemapParams.inputImagePixelCount = g_WindowInfo.width * g_WindowInfo.height;
-            tonemapParams.minLogLuminance = g_GameState->tonemapperMinLogLuminance;
-            tonemapParams.logLuminanceRange = g_GameState->tonemapperMaxLogLuminance - g_GameState->tonemapperMinLogLuminance;
-            tonemapParams.oneOverLogLuminanceRange = 1.0f / (g_GameState->tonemapperMaxLogLuminance - g_GameState->tonemapperMinLogLuminance);
-            tonemapParams.luminanceAdaptationKey = g_GameState->tonemapperExposureKey;
-            tonemapParams.tau = g_GameState->tonemapperAdaptationRate;
+            tonemapParams.minLogLuminance = frame->tonemapperMinLogLuminance;
+            tonemapParams.logLuminanceRange = frame->tonemapperMaxLogLuminance - frame->tonemapperMinLogLuminance;
+            tonemapParams.oneOverLogLuminanceRange = 1.0f / (frame->tonemapperMaxLogLuminance - frame->tonemapperMinLogLuminance);
+            tonemapParams.luminanceAdaptationKey = frame->tonemapperExposureKey;
+            tonemapParams.tau = frame->tonemapperAdaptationRate;
             
             GfxComputeCmdEncoder* postfxCmdEncoder = gfxSetComputePass("PostFx Pass");
                         
@@ -569,7 +671,7 @@ i32 updateAndDraw(f64 dt)
             postfxCmdEncoder->dispatch(LUMINANCE_BLOCK_SIZE, LUMINANCE_BLOCK_SIZE, 1);
             
             postfxCmdEncoder->setComputePSO(tonemapGenerateHistogramPSO);
-            postfxCmdEncoder->bindTexture("inputImage", g_GameState->baseColorRT);
+            postfxCmdEncoder->bindTexture("inputImage", baseColorRT);
             //postfxCmdEncoder->bindTexture("outputImage", gfx::getCurrentRenderTargetColorBuffer());
             postfxCmdEncoder->bindBufferFromData("TonemapParams", sizeof(tonemapParams), &tonemapParams);
             postfxCmdEncoder->bindBuffer("outputBuffer", outputLuminanceHistogramBuffer, 0);
@@ -582,33 +684,70 @@ i32 updateAndDraw(f64 dt)
             postfxCmdEncoder->dispatch(LUMINANCE_BLOCK_SIZE, LUMINANCE_BLOCK_SIZE, 1);
             
             postfxCmdEncoder->setComputePSO(tonemapReinhardPSO);
-            postfxCmdEncoder->bindTexture("inputImage", g_GameState->baseColorRT);
+            postfxCmdEncoder->bindTexture("inputImage", baseColorRT);
             postfxCmdEncoder->bindTexture("outputImage", gfxGetBackbufferTexture());
             //postfxCmdEncoder->bindBufferFromData("TonemapParams", sizeof(tonemapParams), &tonemapParams);
             postfxCmdEncoder->bindBuffer("outputBuffer", outputLuminanceHistogramBuffer, 0);
             postfxCmdEncoder->dispatch(g_WindowInfo.width, g_WindowInfo.height, 1);
             
-            //.....
-            struct
-            {
-                uint32_t inputImageDim[2];
-            } compositeParams;
-            
-            compositeParams.inputImageDim[0] = g_WindowInfo.width;
-            compositeParams.inputImageDim[1] = g_WindowInfo.height;
-            postfxCmdEncoder->setComputePSO(compositePSO);
-            postfxCmdEncoder->bindTexture("inputImage", g_GameState->baseColor2DRT);
-            postfxCmdEncoder->bindTexture("outputImage", gfxGetBackbufferTexture());
-            postfxCmdEncoder->bindBufferFromData("CompositeParams", sizeof(compositeParams), &compositeParams);
-            postfxCmdEncoder->dispatch(g_WindowInfo.width, g_WindowInfo.height, 1);
-            //
-            
             //postfxCmdEncoder->updateFence();
             postfxCmdEncoder->end();
         }
+        
+        gfxReleaseTransientTexture(baseColorRT);
     }
     
-    rgHash a = rgCRC32("hello world");
+    GfxTexture* baseColor2DRT = gfxAcquireTransientTexture("baseColor2DRT", g_WindowInfo.width, g_WindowInfo.height, TinyImageFormat_R8G8B8A8_UNORM, GfxTextureUsage_RenderTarget);
+    
+    // RENDER SIMPLE 2D STUFF
+    {
+        GfxRenderPass simple2dRenderPass = {};
+        simple2dRenderPass.colorAttachments[0].texture = baseColor2DRT;
+        simple2dRenderPass.colorAttachments[0].loadAction = GfxLoadAction_Clear;
+        simple2dRenderPass.colorAttachments[0].storeAction = GfxStoreAction_Store;
+        simple2dRenderPass.colorAttachments[0].clearColor = { 0.0f, 0.0f, 0.0f, 0.0f };
+        simple2dRenderPass.depthStencilAttachmentTexture = depthStencilRT;
+        simple2dRenderPass.depthStencilAttachmentLoadAction = GfxLoadAction_Clear;
+        simple2dRenderPass.depthStencilAttachmentStoreAction = GfxStoreAction_Store;
+        simple2dRenderPass.clearDepth = 1.0f;
+        
+        GfxRenderCmdEncoder* simple2dRenderEncoder = gfxSetRenderPass("Simple2D Pass", &simple2dRenderPass);
+        simple2dRenderEncoder->setGraphicsPSO(simple2DInstancedPSO);
+        // No depth test in this pass, the static background goes first so the text lands on top
+        simple2dRenderEncoder->drawSpriteBatch(staticSprites, nullptr, nullptr);
+        simple2dRenderEncoder->drawTexturedQuadsInstanced(&frame->characterPortraits, nullptr, nullptr);
+        simple2dRenderEncoder->end();
+    }
+    
+    gfxReleaseTransientTexture(depthStencilRT);
+    
+    // COMPOSITE THE 2D STUFF OVER THE TONEMAPPED SCENE
+    {
+        struct
+        {
+            uint32_t inputImageDim[2];
+        } compositeParams;
+        
+        compositeParams.inputImageDim[0] = g_WindowInfo.width;
+        compositeParams.inputImageDim[1] = g_WindowInfo.height;
+        
+        GfxComputeCmdEncoder* compositeCmdEncoder = gfxSetComputePass("Composite Pass");
+        compositeCmdEncoder->setComputePSO(compositePSO);
+        compositeCmdEncoder->bindTexture("inputImage", baseColor2DRT);
+        compositeCmdEncoder->bindTexture("outputImage", gfxGetBackbufferTexture());
+        compositeCmdEncoder->bindBufferFromData("CompositeParams", sizeof(compositeParams), &compositeParams);
+        compositeCmdEncoder->dispatch(g_WindowInfo.width, g_WindowInfo.height, 1);
+        compositeCmdEncoder->end();
+    }
+    
+    gfxReleaseTransientTexture(baseColor2DRT);
+}
+
+i32 updateAndDraw(f64 dt)
+{
+    DemoFrame frame;
+    updateDemo(&frame);
+    renderDemo(&frame);
 
 #if 0
     f32 timeStep = 1.0f / 60.0f;
@@ -633,6 +772,31 @@ class Demo3DApp : public TheApp
     {
         ::updateAndDraw(theAppInput->deltaTime);
     }
+
+    // Pipelined mode, run with --pipelined
+    void update(AppFramePacket* packet) override
+    {
+        DemoFrame* frame = rgPlacementNew(DemoFrame, packet->arena->allocate(sizeof(DemoFrame), alignof(DemoFrame)));
+        updateDemo(frame);
+        packet->userData = frame;
+    }
+
+    void render(AppFramePacket const* packet) override
+    {
+        // Arena memory, the destructor is never run
+        renderDemo((DemoFrame*)packet->userData);
+    }
+
+    void fixedUpdate(f64 fixedDeltaTime) override
+    {
+        g_PhysicSystem->timestep = (f32)fixedDeltaTime;
+        TickPhysicSystem(g_PhysicSystem);
+    }
+
+    void shutdown() override
+    {
+        ::teardown();
+    }
 };
 
 THE_APP_MAIN(Demo3DApp)
@@ -0,0 +1,287 @@
+#include "pack.h"
+
+#include <string.h>
+#include <compile_time_crc.h>
+
+// PACK FORMAT
+// -----------
+
+bool packNormalizePath(char const* path, char* outPath, size_t outPathSize)
+{
+    size_t length = 0;
+    char const* c = path;
+    while(*c != '\0')
+    {
+        // Read the next path component
+        char const* componentBegin = c;
+        while(*c != '\0' && *c != '/' && *c != '\\')
+        {
+            ++c;
+        }
+        size_t componentLength = c - componentBegin;
+        while(*c == '/' || *c == '\\')
+        {
+            ++c;
+        }
+
+        if(componentLength == 0 || (componentLength == 1 && componentBegin[0] == '.'))
+        {
+            continue;
+        }
+
+        if(componentLength == 2 && componentBegin[0] == '.' && componentBegin[1] == '.')
+        {
+            // Pop the last component, or keep the ".." if there is nothing to pop
+            size_t lastComponentBegin = length;
+            while(lastComponentBegin > 0 && outPath[lastComponentBegin - 1] != '/')
+            {
+                --lastComponentBegin;
+            }
+            bool lastIsDotDot = (length - lastComponentBegin == 2) && outPath[lastComponentBegin] == '.' && outPath[lastComponentBegin + 1] == '.';
+            if(length > 0 && !lastIsDotDot)
+            {
+                length = (lastComponentBegin > 0) ? lastComponentBegin - 1 : 0;
+                continue;
+            }
+        }
+
+        size_t separatorLength = (length > 0) ? 1 : 0;
+        if(length + separatorLength + componentLength + 1 > outPathSize)
+        {
+            return false;
+        }
+        if(separatorLength > 0)
+        {
+            outPath[length++] = '/';
+        }
+        memcpy(outPath + length, componentBegin, componentLength);
+        length += componentLength;
+    }
+
+    if(outPathSize == 0)
+    {
+        return false;
+    }
+    outPath[length] = '\0';
+    return true;
+}
+
+uint32_t packHashPath(char const* normalizedPath)
+{
+    return rgCRC32(normalizedPath);
+}
+
+// LZ COMPRESSION
+// --------------
+
+static const size_t kLzMinMatch = 4;
+static const size_t kLzLastLiterals = 5;   // Block must end with at least 5 literals
+static const size_t kLzMatchStartLimit = 12; // Last match must start at least 12 bytes before the end
+static const uint32_t kLzHashBits = 14;
+static const size_t kLzMaxOffset = 65535;
+
+static inline uint32_t lzRead32(uint8_t const* p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t lzHash(uint32_t v)
+{
+    return (v * 2654435761u) >> (32 - kLzHashBits);
+}
+
+static inline uint8_t* lzWriteLength(uint8_t* op, uint8_t* opEnd, size_t length)
+{
+    while(length >= 255)
+    {
+        if(op >= opEnd)
+        {
+            return nullptr;
+        }
+        *op++ = 255;
+        length -= 255;
+    }
+    if(op >= opEnd)
+    {
+        return nullptr;
+    }
+    *op++ = (uint8_t)length;
+    return op;
+}
+
+static uint8_t* lzWriteSequence(uint8_t* op, uint8_t* opEnd, uint8_t const* literals, size_t literalLength, size_t offset, size_t matchLength)
+{
+    if(op >= opEnd)
+    {
+        return nullptr;
+    }
+    uint8_t* token = op++;
+    *token = (uint8_t)((literalLength >= 15 ? 15 : literalLength) << 4);
+    if(literalLength >= 15 && (op = lzWriteLength(op, opEnd, literalLength - 15)) == nullptr)
+    {
+        return nullptr;
+    }
+
+    if((size_t)(opEnd - op) < literalLength)
+    {
+        return nullptr;
+    }
+    memcpy(op, literals, literalLength);
+    op += literalLength;
+
+    // Last sequence has only literals
+    if(matchLength == 0)
+    {
+        return op;
+    }
+
+    if(opEnd - op < 2)
+    {
+        return nullptr;
+    }
+    *op++ = (uint8_t)(offset & 0xFF);
+    *op++ = (uint8_t)(offset >> 8);
+
+    size_t matchCode = matchLength - kLzMinMatch;
+    *token |= (uint8_t)(matchCode >= 15 ? 15 : matchCode);
+    if(matchCode >= 15 && (op = lzWriteLength(op, opEnd, matchCode - 15)) == nullptr)
+    {
+        return nullptr;
+    }
+    return op;
+}
+
+size_t lzCompressBound(size_t srcSize)
+{
+    return srcSize + (srcSize / 255) + 16;
+}
+
+size_t lzCompress(uint8_t const* src, size_t srcSize, uint8_t* dst, size_t dstCapacity)
+{
+    uint8_t* op = dst;
+    uint8_t* opEnd = dst + dstCapacity;
+    size_t anchor = 0;
+
+    if(srcSize > kLzMatchStartLimit)
+    {
+        // Positions are stored +1, so 0 means empty
+        static thread_local uint32_t hashTable[1 << kLzHashBits];
+        memset(hashTable, 0, sizeof(hashTable));
+
+        size_t const matchStartLimit = srcSize - kLzMatchStartLimit;
+        size_t const matchEndLimit = srcSize - kLzLastLiterals;
+
+        size_t ip = 0;
+        while(ip < matchStartLimit)
+        {
+            uint32_t sequence = lzRead32(src + ip);
+            uint32_t h = lzHash(sequence);
+            size_t ref = hashTable[h];
+            hashTable[h] = (uint32_t)(ip + 1);
+
+            if(ref == 0 || ip - (ref - 1) > kLzMaxOffset || lzRead32(src + ref - 1) != sequence)
+            {
+                ++ip;
+                continue;
+            }
+            ref -= 1;
+
+            size_t matchLength = kLzMinMatch;
+            while(ip + matchLength < matchEndLimit && src[ref + matchLength] == src[ip + matchLength])
+            {
+                ++matchLength;
+            }
+
+            op = lzWriteSequence(op, opEnd, src + anchor, ip - anchor, ip - ref, matchLength);
+            if(op == nullptr)
+            {
+                return 0;
+            }
+            ip += matchLength;
+            anchor = ip;
+        }
+    }
+
+    op = lzWriteSequence(op, opEnd, src + anchor, srcSize - anchor, 0, 0);
+    return (op != nullptr) ? (size_t)(op - dst) : 0;
+}
+
+bool lzDecompress(uint8_t const* src, size_t srcSize, uint8_t* dst, size_t dstSize)
+{
+    uint8_t const* ip = src;
+    uint8_t const* ipEnd = src + srcSize;
+    uint8_t* op = dst;
+    uint8_t* opEnd = dst + dstSize;
+
+    auto readLength = [&ip, ipEnd](size_t* length) -> bool
+    {
+        uint8_t b;
+        do
+        {
+            if(ip >= ipEnd)
+            {
+                return false;
+            }
+            b = *ip++;
+            *length += b;
+        } while(b == 255);
+        return true;
+    };
+
+    while(ip < ipEnd)
+    {
+        uint8_t token = *ip++;
+
+        size_t literalLength = token >> 4;
+        if(literalLength == 15 && !readLength(&literalLength))
+        {
+            return false;
+        }
+        if((size_t)(ipEnd - ip) < literalLength || (size_t)(opEnd - op) < literalLength)
+        {
+            return false;
+        }
+        memcpy(op, ip, literalLength);
+        ip += literalLength;
+        op += literalLength;
+
+        if(ip == ipEnd)
+        {
+            break; // Last sequence
+        }
+
+        if(ipEnd - ip < 2)
+        {
+            return false;
+        }
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if(offset == 0 || offset > (size_t)(op - dst))
+        {
+            return false;
+        }
+
+        size_t matchLength = token & 15;
+        if(matchLength == 15 && !readLength(&matchLength))
+        {
+            return false;
+        }
+        matchLength += kLzMinMatch;
+        if((size_t)(opEnd - op) < matchLength)
+        {
+            return false;
+        }
+
+        // Byte by byte, as the match can overlap the bytes being written
+        uint8_t const* match = op - offset;
+        for(size_t i = 0; i < matchLength; ++i)
+        {
+            op[i] = match[i];
+        }
+        op += matchLength;
+    }
+
+    return op == opEnd;
+}
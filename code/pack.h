@@ -0,0 +1,62 @@
+#ifndef __PACK_H__
+#define __PACK_H__
+
+// NOTE: This file is shared with assetgen, it must not depend on core.h
+
+#include <stdint.h>
+#include <stddef.h>
+
+// PACK FORMAT
+// -----------
+// [PackHeader][PackEntry x entryCount][u32 hash table x hashTableSize][paths][entry data...]
+// The hash table is open addressed with linear probing, slots hold entry
+// indices keyed by packHashPath() of the normalized path. Entry data is
+// aligned to kPackDataAlignment, so it can be handed to the gfx API as is.
+
+static const uint32_t kPackMagic = 0x4B504752; // 'RGPK'
+static const uint32_t kPackVersion = 1;
+static const uint32_t kPackDataAlignment = 512; // D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT
+static const uint32_t kPackInvalidEntry = 0xFFFFFFFF;
+
+enum PackEntryFlags : uint32_t
+{
+    PackEntryFlag_None = 0,
+    PackEntryFlag_Compressed = (1 << 0), // Compressed with lzCompress()
+};
+
+struct PackHeader
+{
+    uint32_t    magic;
+    uint32_t    version;
+    uint32_t    entryCount;
+    uint32_t    hashTableSize; // Power of 2
+    uint64_t    entriesOffset;
+    uint64_t    hashTableOffset;
+    uint64_t    pathsOffset;
+};
+
+struct PackEntry
+{
+    uint32_t    pathHash;
+    uint32_t    pathOffset; // From PackHeader::pathsOffset, null terminated
+    uint64_t    dataOffset; // From the start of the pack
+    uint64_t    storedSize;
+    uint64_t    size;       // Uncompressed size
+    uint32_t    flags;
+    uint32_t    _padding;
+};
+
+// Converts '\' to '/', and drops "./", "dir/../" and repeated '/', returns false if it doesn't fit
+bool        packNormalizePath(char const* path, char* outPath, size_t outPathSize);
+uint32_t    packHashPath(char const* normalizedPath);
+
+// LZ COMPRESSION
+// --------------
+// LZ4 block format, fast to decompress. Only meant for the offline packer
+// and the loaders, not for streaming.
+
+size_t      lzCompressBound(size_t srcSize);
+size_t      lzCompress(uint8_t const* src, size_t srcSize, uint8_t* dst, size_t dstCapacity); // Returns 0 on failure
+bool        lzDecompress(uint8_t const* src, size_t srcSize, uint8_t* dst, size_t dstSize); // dstSize must be the exact uncompressed size
+
+#endif // __PACK_H__
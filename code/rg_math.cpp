@@ -0,0 +1,406 @@
+#include "rg_math.h"
+
+// LANE SHUFFLES
+// -------------
+// Interleaved <-> planar for 4 elements of 2, 3 or 4 floats
+
+#if defined(RG_SIMD_SSE2)
+static RG_INLINE void deinterleave2(f32 const* in, rgSimd4* x, rgSimd4* y)
+{
+    rgSimd4 a = _mm_loadu_ps(in);
+    rgSimd4 b = _mm_loadu_ps(in + 4);
+    *x = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+    *y = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+}
+
+static RG_INLINE void interleave2(f32* out, rgSimd4 x, rgSimd4 y)
+{
+    _mm_storeu_ps(out, _mm_unpacklo_ps(x, y));
+    _mm_storeu_ps(out + 4, _mm_unpackhi_ps(x, y));
+}
+
+static RG_INLINE void deinterleave3(f32 const* in, rgSimd4* x, rgSimd4* y, rgSimd4* z)
+{
+    rgSimd4 a = _mm_loadu_ps(in);     // x0 y0 z0 x1
+    rgSimd4 b = _mm_loadu_ps(in + 4); // y1 z1 x2 y2
+    rgSimd4 c = _mm_loadu_ps(in + 8); // z2 x3 y3 z3
+
+    rgSimd4 x23 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2));
+    *x = _mm_shuffle_ps(a, x23, _MM_SHUFFLE(2, 0, 3, 0));
+
+    rgSimd4 y01 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1));
+    rgSimd4 y23 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3));
+    *y = _mm_shuffle_ps(y01, y23, _MM_SHUFFLE(2, 0, 2, 0));
+
+    rgSimd4 z01 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2));
+    rgSimd4 z23 = _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0));
+    *z = _mm_shuffle_ps(z01, z23, _MM_SHUFFLE(2, 0, 2, 0));
+}
+
+static RG_INLINE void interleave3(f32* out, rgSimd4 x, rgSimd4 y, rgSimd4 z)
+{
+    rgSimd4 a0 = _mm_shuffle_ps(x, y, _MM_SHUFFLE(0, 0, 0, 0));
+    rgSimd4 a1 = _mm_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0));
+    _mm_storeu_ps(out, _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(2, 0, 2, 0)));
+
+    rgSimd4 b0 = _mm_shuffle_ps(y, z, _MM_SHUFFLE(1, 1, 1, 1));
+    rgSimd4 b1 = _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 2, 2, 2));
+    _mm_storeu_ps(out + 4, _mm_shuffle_ps(b0, b1, _MM_SHUFFLE(2, 0, 2, 0)));
+
+    rgSimd4 c0 = _mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2));
+    rgSimd4 c1 = _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3));
+    _mm_storeu_ps(out + 8, _mm_shuffle_ps(c0, c1, _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+static RG_INLINE void deinterleave4(f32 const* in, rgSimd4* x, rgSimd4* y, rgSimd4* z, rgSimd4* w)
+{
+    rgSimd4 a = _mm_loadu_ps(in);
+    rgSimd4 b = _mm_loadu_ps(in + 4);
+    rgSimd4 c = _mm_loadu_ps(in + 8);
+    rgSimd4 d = _mm_loadu_ps(in + 12);
+    _MM_TRANSPOSE4_PS(a, b, c, d);
+    *x = a;
+    *y = b;
+    *z = c;
+    *w = d;
+}
+
+static RG_INLINE void interleave4(f32* out, rgSimd4 x, rgSimd4 y, rgSimd4 z, rgSimd4 w)
+{
+    _MM_TRANSPOSE4_PS(x, y, z, w);
+    _mm_storeu_ps(out, x);
+    _mm_storeu_ps(out + 4, y);
+    _mm_storeu_ps(out + 8, z);
+    _mm_storeu_ps(out + 12, w);
+}
+#elif defined(RG_SIMD_NEON)
+static RG_INLINE void deinterleave2(f32 const* in, rgSimd4* x, rgSimd4* y)
+{
+    float32x4x2_t v = vld2q_f32(in);
+    *x = v.val[0];
+    *y = v.val[1];
+}
+
+static RG_INLINE void interleave2(f32* out, rgSimd4 x, rgSimd4 y)
+{
+    float32x4x2_t v = {{x, y}};
+    vst2q_f32(out, v);
+}
+
+static RG_INLINE void deinterleave3(f32 const* in, rgSimd4* x, rgSimd4* y, rgSimd4* z)
+{
+    float32x4x3_t v = vld3q_f32(in);
+    *x = v.val[0];
+    *y = v.val[1];
+    *z = v.val[2];
+}
+
+static RG_INLINE void interleave3(f32* out, rgSimd4 x, rgSimd4 y, rgSimd4 z)
+{
+    float32x4x3_t v = {{x, y, z}};
+    vst3q_f32(out, v);
+}
+
+static RG_INLINE void deinterleave4(f32 const* in, rgSimd4* x, rgSimd4* y, rgSimd4* z, rgSimd4* w)
+{
+    float32x4x4_t v = vld4q_f32(in);
+    *x = v.val[0];
+    *y = v.val[1];
+    *z = v.val[2];
+    *w = v.val[3];
+}
+
+static RG_INLINE void interleave4(f32* out, rgSimd4 x, rgSimd4 y, rgSimd4 z, rgSimd4 w)
+{
+    float32x4x4_t v = {{x, y, z, w}};
+    vst4q_f32(out, v);
+}
+#else
+static RG_INLINE void deinterleave2(f32 const* in, rgSimd4* x, rgSimd4* y)
+{
+    for(i32 i = 0; i < 4; ++i)
+    {
+        x->v[i] = in[i * 2 + 0];
+        y->v[i] = in[i * 2 + 1];
+    }
+}
+
+static RG_INLINE void interleave2(f32* out, rgSimd4 x, rgSimd4 y)
+{
+    for(i32 i = 0; i < 4; ++i)
+    {
+        out[i * 2 + 0] = x.v[i];
+        out[i * 2 + 1] = y.v[i];
+    }
+}
+
+static RG_INLINE void deinterleave3(f32 const* in, rgSimd4* x, rgSimd4* y, rgSimd4* z)
+{
+    for(i32 i = 0; i < 4; ++i)
+    {
+        x->v[i] = in[i * 3 + 0];
+        y->v[i] = in[i * 3 + 1];
+        z->v[i] = in[i * 3 + 2];
+    }
+}
+
+static RG_INLINE void interleave3(f32* out, rgSimd4 x, rgSimd4 y, rgSimd4 z)
+{
+    for(i32 i = 0; i < 4; ++i)
+    {
+        out[i * 3 + 0] = x.v[i];
+        out[i * 3 + 1] = y.v[i];
+        out[i * 3 + 2] = z.v[i];
+    }
+}
+
+static RG_INLINE void deinterleave4(f32 const* in, rgSimd4* x, rgSimd4* y, rgSimd4* z, rgSimd4* w)
+{
+    for(i32 i = 0; i < 4; ++i)
+    {
+        x->v[i] = in[i * 4 + 0];
+        y->v[i] = in[i * 4 + 1];
+        z->v[i] = in[i * 4 + 2];
+        w->v[i] = in[i * 4 + 3];
+    }
+}
+
+static RG_INLINE void interleave4(f32* out, rgSimd4 x, rgSimd4 y, rgSimd4 z, rgSimd4 w)
+{
+    for(i32 i = 0; i < 4; ++i)
+    {
+        out[i * 4 + 0] = x.v[i];
+        out[i * 4 + 1] = y.v[i];
+        out[i * 4 + 2] = z.v[i];
+        out[i * 4 + 3] = w.v[i];
+    }
+}
+#endif
+
+// TRANSFORM
+// ---------
+
+void mathTransformPoints2D(rgFloat2 const* points, rgFloat2* outPoints, u32 count, f32 angle, rgFloat2 translation)
+{
+    f32 s = sinf(angle);
+    f32 c = cosf(angle);
+
+    rgSimd4 s4 = simdSet1(s);
+    rgSimd4 c4 = simdSet1(c);
+    rgSimd4 tx4 = simdSet1(translation.x);
+    rgSimd4 ty4 = simdSet1(translation.y);
+
+    u32 i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        rgSimd4 x, y;
+        deinterleave2((f32 const*)(points + i), &x, &y);
+        rgSimd4 outX = simdSub(simdMadd(c4, x, tx4), simdMul(s4, y));
+        rgSimd4 outY = simdMadd(c4, y, simdMadd(s4, x, ty4));
+        interleave2((f32*)(outPoints + i), outX, outY);
+    }
+
+    for(; i < count; ++i)
+    {
+        rgFloat2 p = points[i];
+        outPoints[i] = rgFloat2{c * p.x - s * p.y + translation.x, s * p.x + c * p.y + translation.y};
+    }
+}
+
+void mathTransformPoints2DSoA(f32 const* x, f32 const* y, f32 const* sinA, f32 const* cosA, f32 const* tx, f32 const* ty, f32* outX, f32* outY, u32 count)
+{
+    u32 i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        rgSimd4 x4 = simdLoad(x + i);
+        rgSimd4 y4 = simdLoad(y + i);
+        rgSimd4 s4 = simdLoad(sinA + i);
+        rgSimd4 c4 = simdLoad(cosA + i);
+        rgSimd4 rx = simdSub(simdMadd(c4, x4, simdLoad(tx + i)), simdMul(s4, y4));
+        rgSimd4 ry = simdMadd(c4, y4, simdMadd(s4, x4, simdLoad(ty + i)));
+        simdStore(outX + i, rx);
+        simdStore(outY + i, ry);
+    }
+
+    for(; i < count; ++i)
+    {
+        f32 px = x[i];
+        f32 py = y[i];
+        outX[i] = cosA[i] * px - sinA[i] * py + tx[i];
+        outY[i] = sinA[i] * px + cosA[i] * py + ty[i];
+    }
+}
+
+// SIN COS
+// -------
+
+static RG_INLINE void sinCos4(rgSimd4 angle, rgSimd4* outSin, rgSimd4* outCos)
+{
+    // Reduce to [-pi, pi], 2pi is split in two so k * 2pi stays exact
+    rgSimd4 k = simdFloor(simdMadd(angle, simdSet1(0.15915494309189535f), simdSet1(0.5f)));
+    rgSimd4 x = simdSub(angle, simdMul(k, simdSet1(6.28125f)));
+    x = simdSub(x, simdMul(k, simdSet1(1.9353071795864769e-3f)));
+
+    // Reflect to [-pi/2, pi/2], sin(pi - x) = sin(x) and cos(pi - x) = -cos(x)
+    rgSimd4 const pi = simdSet1(3.14159265358979f);
+    rgSimd4 const halfPi = simdSet1(1.57079632679490f);
+    rgSimd4 aboveHalfPi = simdCmpGt(x, halfPi);
+    rgSimd4 belowHalfPi = simdCmpGt(simdNeg(halfPi), x);
+    x = simdSelect(aboveHalfPi, simdSub(pi, x), x);
+    x = simdSelect(belowHalfPi, simdSub(simdNeg(pi), x), x);
+    rgSimd4 cosSign = simdSelect(aboveHalfPi, simdSet1(-1.0f), simdSet1(1.0f));
+    cosSign = simdSelect(belowHalfPi, simdSet1(-1.0f), cosSign);
+
+    // Taylor series, the error of the last omitted term is below 6e-8 on [-pi/2, pi/2]
+    rgSimd4 x2 = simdMul(x, x);
+
+    rgSimd4 s = simdSet1(-2.5052108385441720e-8f);
+    s = simdMadd(s, x2, simdSet1(2.7557319223985893e-6f));
+    s = simdMadd(s, x2, simdSet1(-1.9841269841269841e-4f));
+    s = simdMadd(s, x2, simdSet1(8.3333333333333333e-3f));
+    s = simdMadd(s, x2, simdSet1(-1.6666666666666667e-1f));
+    s = simdMadd(s, x2, simdSet1(1.0f));
+    *outSin = simdMul(s, x);
+
+    rgSimd4 c = simdSet1(2.0876756987868099e-9f);
+    c = simdMadd(c, x2, simdSet1(-2.7557319223985891e-7f));
+    c = simdMadd(c, x2, simdSet1(2.4801587301587302e-5f));
+    c = simdMadd(c, x2, simdSet1(-1.3888888888888889e-3f));
+    c = simdMadd(c, x2, simdSet1(4.1666666666666667e-2f));
+    c = simdMadd(c, x2, simdSet1(-0.5f));
+    c = simdMadd(c, x2, simdSet1(1.0f));
+    *outCos = simdMul(c, cosSign);
+}
+
+void mathSinCos(f32 const* angles, f32* outSin, f32* outCos, u32 count)
+{
+    u32 i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        rgSimd4 s, c;
+        sinCos4(simdLoad(angles + i), &s, &c);
+        simdStore(outSin + i, s);
+        simdStore(outCos + i, c);
+    }
+
+    // Pad the remainder, so all the elements get the same approximation
+    if(i < count)
+    {
+        f32 a[4] = {};
+        f32 s[4];
+        f32 c[4];
+        u32 remaining = count - i;
+        for(u32 j = 0; j < remaining; ++j)
+        {
+            a[j] = angles[i + j];
+        }
+        rgSimd4 s4, c4;
+        sinCos4(simdLoad(a), &s4, &c4);
+        simdStore(s, s4);
+        simdStore(c, c4);
+        for(u32 j = 0; j < remaining; ++j)
+        {
+            outSin[i + j] = s[j];
+            outCos[i + j] = c[j];
+        }
+    }
+}
+
+// AOS <-> SOA
+// -----------
+
+void mathAoSToSoA(rgFloat2 const* in, f32* outX, f32* outY, u32 count)
+{
+    u32 i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        rgSimd4 x, y;
+        deinterleave2((f32 const*)(in + i), &x, &y);
+        simdStore(outX + i, x);
+        simdStore(outY + i, y);
+    }
+    for(; i < count; ++i)
+    {
+        outX[i] = in[i].x;
+        outY[i] = in[i].y;
+    }
+}
+
+void mathAoSToSoA(rgFloat3 const* in, f32* outX, f32* outY, f32* outZ, u32 count)
+{
+    u32 i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        rgSimd4 x, y, z;
+        deinterleave3((f32 const*)(in + i), &x, &y, &z);
+        simdStore(outX + i, x);
+        simdStore(outY + i, y);
+        simdStore(outZ + i, z);
+    }
+    for(; i < count; ++i)
+    {
+        outX[i] = in[i].x;
+        outY[i] = in[i].y;
+        outZ[i] = in[i].z;
+    }
+}
+
+void mathAoSToSoA(rgFloat4 const* in, f32* outX, f32* outY, f32* outZ, f32* outW, u32 count)
+{
+    u32 i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        rgSimd4 x, y, z, w;
+        deinterleave4((f32 const*)(in + i), &x, &y, &z, &w);
+        simdStore(outX + i, x);
+        simdStore(outY + i, y);
+        simdStore(outZ + i, z);
+        simdStore(outW + i, w);
+    }
+    for(; i < count; ++i)
+    {
+        outX[i] = in[i].x;
+        outY[i] = in[i].y;
+        outZ[i] = in[i].z;
+        outW[i] = in[i].w;
+    }
+}
+
+void mathSoAToAoS(f32 const* x, f32 const* y, rgFloat2* out, u32 count)
+{
+    u32 i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        interleave2((f32*)(out + i), simdLoad(x + i), simdLoad(y + i));
+    }
+    for(; i < count; ++i)
+    {
+        out[i] = rgFloat2{x[i], y[i]};
+    }
+}
+
+void mathSoAToAoS(f32 const* x, f32 const* y, f32 const* z, rgFloat3* out, u32 count)
+{
+    u32 i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        interleave3((f32*)(out + i), simdLoad(x + i), simdLoad(y + i), simdLoad(z + i));
+    }
+    for(; i < count; ++i)
+    {
+        out[i] = rgFloat3{x[i], y[i], z[i]};
+    }
+}
+
+void mathSoAToAoS(f32 const* x, f32 const* y, f32 const* z, f32 const* w, rgFloat4* out, u32 count)
+{
+    u32 i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        interleave4((f32*)(out + i), simdLoad(x + i), simdLoad(y + i), simdLoad(z + i), simdLoad(w + i));
+    }
+    for(; i < count; ++i)
+    {
+        out[i] = rgFloat4{x[i], y[i], z[i], w[i]};
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef __RG_MATH_H__
+#define __RG_MATH_H__
+
+#include "core.h"
+
+// BATCH MATH
+// ----------
+// Kernels over arrays, 4 lanes at a time with the rgSimd4 wrapper from core.h
+// and a scalar loop for the remainder. Input and output arrays can alias only
+// if they are the same array.
+
+// out[i] = rotate(points[i], angle) + translation
+void mathTransformPoints2D(rgFloat2 const* points, rgFloat2* outPoints, u32 count, f32 angle, rgFloat2 translation);
+
+// Per point rotation and translation, all arrays are SoA and count long:
+// outX[i] = cosA[i] * x[i] - sinA[i] * y[i] + tx[i]
+// outY[i] = sinA[i] * x[i] + cosA[i] * y[i] + ty[i]
+void mathTransformPoints2DSoA(f32 const* x, f32 const* y, f32 const* sinA, f32 const* cosA, f32 const* tx, f32 const* ty, f32* outX, f32* outY, u32 count);
+
+// Polynomial approximation, absolute error is below 1e-6 for |angle| < 1e4,
+// precision degrades with larger angles as the range reduction is done in f32
+void mathSinCos(f32 const* angles, f32* outSin, f32* outCos, u32 count);
+
+// AoS <-> SoA
+void mathAoSToSoA(rgFloat2 const* in, f32* outX, f32* outY, u32 count);
+void mathAoSToSoA(rgFloat3 const* in, f32* outX, f32* outY, f32* outZ, u32 count);
+void mathAoSToSoA(rgFloat4 const* in, f32* outX, f32* outY, f32* outZ, f32* outW, u32 count);
+
+void mathSoAToAoS(f32 const* x, f32 const* y, rgFloat2* out, u32 count);
+void mathSoAToAoS(f32 const* x, f32 const* y, f32 const* z, rgFloat3* out, u32 count);
+void mathSoAToAoS(f32 const* x, f32 const* y, f32 const* z, f32 const* w, rgFloat4* out, u32 count);
+
+#endif // __RG_MATH_H__
@@ -1,17 +1,31 @@
 #include "rg_physic.h"
 
-static void Verlet(PhysicSystem* sys)
+static const u32 kParticlesPerJob = 256;
+
+static void Verlet(PhysicSystem* sys, u32 begin, u32 end)
 {
-    for(u32 i = 0; i < kMaxParticles; ++i)
-    {
-        rgFloat3& curPos = sys->particlePos[i];
-        rgFloat3& prevPos = sys->particlePrevPos[i];
-        rgFloat3& forceAcc = sys->particleForceAccumulators[i];
-        rgFloat3 temp = curPos;
+    // Components are independent, so integrate the rgFloat3 arrays as flat floats
+    f32* curPos = (f32*)(sys->particlePos + begin);
+    f32* prevPos = (f32*)(sys->particlePrevPos + begin);
+    f32 const* forceAcc = (f32 const*)(sys->particleForceAccumulators + begin);
+    f32 const dt2 = sys->timestep * sys->timestep;
+    u32 const count = (end - begin) * 3;
 
-        curPos += curPos - prevPos + forceAcc * (sys->timestep * sys->timestep);
+    rgSimd4 dt2x4 = simdSet1(dt2);
+    u32 i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        rgSimd4 cur = simdLoad(curPos + i);
+        rgSimd4 prev = simdLoad(prevPos + i);
+        simdStore(curPos + i, simdMadd(simdLoad(forceAcc + i), dt2x4, simdSub(simdAdd(cur, cur), prev)));
+        simdStore(prevPos + i, cur);
+    }
 
-        prevPos = temp;
+    for(; i < count; ++i)
+    {
+        f32 cur = curPos[i];
+        curPos[i] = cur + cur - prevPos[i] + forceAcc[i] * dt2;
+        prevPos[i] = cur;
     }
 }
 
@@ -20,9 +34,9 @@ static void SatisfyConstraints(PhysicSystem* system)
 
 }
 
-static void AccumulateForces(PhysicSystem* system)
+static void AccumulateForces(PhysicSystem* system, u32 begin, u32 end)
 {
-    for(u32 i = 0; i < kMaxParticles; ++i)
+    for(u32 i = begin; i < end; ++i)
     {
         system->particleForceAccumulators[i] = system->gravity;
     }
@@ -30,7 +44,13 @@ static void AccumulateForces(PhysicSystem* system)
 
 void TickPhysicSystem(PhysicSystem* system)
 {
-    AccumulateForces(system);
-    Verlet(system);
+    rgProfileFunction();
+
+    // Particles are independent till constraints are satisfied
+    jobParallelFor(kMaxParticles, kParticlesPerJob, [system](u32 begin, u32 end)
+    {
+        AccumulateForces(system, begin, end);
+        Verlet(system, begin, end);
+    });
     SatisfyConstraints(system);
 }
@@ -12,7 +12,7 @@ struct PhysicSystem
     rgFloat3 particleForceAccumulators[kMaxParticles];
 
     rgFloat3 gravity;
-    f32  timestep;
+    f32  timestep; // Set it to the fixed step, and tick from TheApp::fixedUpdate()
 };
 
 void TickPhysicSystem(PhysicSystem* system);
@@ -1,4 +1,4 @@
-#define MAX_INSTANCES 1024
+#define MAX_INSTANCES 1024 // kMaxTexturedQuadsPerDraw in gfx.h
 
 struct Vertex2D
 {
@@ -38,7 +38,7 @@ VertexOut vsSimple2d(in Vertex2D v, uint vertexID : SV_VERTEXID, uint instanceID
     output.position = mul(camera.projection2d, mul(camera.view2d, float4(v.pos, 1.0)));
     output.texcoord = v.texcoord;
     output.color  = half4(v.color);
-    output.instanceID = vertexID / 6;
+    output.instanceID = vertexID / 4; // Indexed draw, 4 vertices per quad
     return output;
 }
 
@@ -51,3 +51,47 @@ half4 fsSimple2d(in VertexOut f) : SV_TARGET
     
     return finalColor;
 }
+
+// Instanced variant, one TexturedQuadInstance per quad and 6 vertices per instance
+
+struct QuadInstance2D
+{
+    float3 pos : POSITION;
+    float2 size : TEXCOORD0;
+    float4 uvRect : TEXCOORD1;
+    float4 color : COLOR;
+    float2 rotation : TEXCOORD2; // sin, cos
+    uint texID : TEXCOORD3;
+};
+
+struct QuadVertexOut
+{
+    float4 position : SV_POSITION;
+    float2 texcoord : TEXCOORD;
+    half4 color : COLOR;
+    nointerpolation uint texID : TEXID;
+};
+
+// 0 - 1
+// 3 - 2, same triangles as genTexturedQuadVertices()
+static const float2 kQuadCorners[6] = { float2(0, 0), float2(0, 1), float2(1, 0), float2(1, 0), float2(0, 1), float2(1, 1) };
+
+QuadVertexOut vsSimple2dInstanced(in QuadInstance2D q, uint vertexID : SV_VERTEXID)
+{
+    float2 corner = kQuadCorners[vertexID];
+    float2 p = corner * q.size;
+    float2 rotated = float2(q.rotation.y * p.x - q.rotation.x * p.y, q.rotation.x * p.x + q.rotation.y * p.y);
+
+    QuadVertexOut output;
+    output.position = mul(camera.projection2d, mul(camera.view2d, float4(q.pos.xy + rotated, q.pos.z, 1.0)));
+    output.texcoord = lerp(q.uvRect.xy, q.uvRect.zw, corner);
+    output.color = half4(q.color);
+    output.texID = q.texID;
+    return output;
+}
+
+half4 fsSimple2dInstanced(in QuadVertexOut f) : SV_TARGET
+{
+    half4 texel = bindlessTexture2D[NonUniformResourceIndex(f.texID)].Sample(simpleSampler, f.texcoord);
+    return texel * f.color;
+}
@@ -8,6 +8,8 @@
 #include <unordered_map>
 #include <map>
 #include <set>
+#include <filesystem>
+#include <algorithm>
 
 #include "DirectXTex.h"
 #define NULL 0
@@ -22,6 +24,7 @@
 #include <vectormath/vectormath.hpp>
 
 #include "pugixml.hpp"
+#include "pack.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 #define STB_IMAGE_WRITE_IMPLEMENTATION
@@ -777,11 +780,169 @@ void convert(std::string input, std::string output, bool transformVertex)
     chdir(rootWd);
 }
 
+// Packs every file under inputDir, see pack.h for the format
+static bool packDirectory(std::string inputDir, std::string outputFile, bool compress)
+{
+    namespace fs = std::filesystem;
+
+    struct PackInput
+    {
+        std::string path;       // Normalized, relative to inputDir
+        std::string diskPath;
+        std::vector<uint8_t> storedData;
+        PackEntry entry;
+    };
+    std::vector<PackInput> inputs;
+
+    std::error_code ec;
+    fs::path outputPath = fs::weakly_canonical(outputFile, ec);
+    for(fs::directory_entry const& dirEntry : fs::recursive_directory_iterator(inputDir, ec))
+    {
+        if(!dirEntry.is_regular_file() || fs::weakly_canonical(dirEntry.path(), ec) == outputPath)
+        {
+            continue;
+        }
+
+        PackInput input = {};
+        char normalizedPath[512];
+        std::string relativePath = fs::relative(dirEntry.path(), inputDir).generic_string();
+        if(!packNormalizePath(relativePath.c_str(), normalizedPath, sizeof(normalizedPath)))
+        {
+            std::cerr << "Path too long, skipping " << relativePath << std::endl;
+            continue;
+        }
+        input.path = normalizedPath;
+        input.diskPath = dirEntry.path().string();
+        inputs.push_back(std::move(input));
+    }
+    if(ec)
+    {
+        std::cerr << "Can't read directory " << inputDir << ": " << ec.message() << std::endl;
+        return false;
+    }
+
+    // Deterministic output
+    std::sort(inputs.begin(), inputs.end(), [](PackInput const& a, PackInput const& b) { return a.path < b.path; });
+
+    uint32_t hashTableSize = 16;
+    while(hashTableSize < inputs.size() * 2)
+    {
+        hashTableSize *= 2;
+    }
+
+    PackHeader header = {};
+    header.magic = kPackMagic;
+    header.version = kPackVersion;
+    header.entryCount = (uint32_t)inputs.size();
+    header.hashTableSize = hashTableSize;
+    header.entriesOffset = sizeof(PackHeader);
+    header.hashTableOffset = header.entriesOffset + sizeof(PackEntry) * inputs.size();
+    header.pathsOffset = header.hashTableOffset + sizeof(uint32_t) * hashTableSize;
+
+    std::vector<char> paths;
+    std::vector<uint32_t> hashTable(hashTableSize, kPackInvalidEntry);
+    for(uint32_t i = 0; i < inputs.size(); ++i)
+    {
+        PackInput& input = inputs[i];
+        input.entry.pathHash = packHashPath(input.path.c_str());
+        input.entry.pathOffset = (uint32_t)paths.size();
+        paths.insert(paths.end(), input.path.c_str(), input.path.c_str() + input.path.size() + 1);
+
+        uint32_t slot = input.entry.pathHash & (hashTableSize - 1);
+        while(hashTable[slot] != kPackInvalidEntry)
+        {
+            slot = (slot + 1) & (hashTableSize - 1);
+        }
+        hashTable[slot] = i;
+    }
+
+    auto alignUp = [](uint64_t v) { return (v + kPackDataAlignment - 1) & ~(uint64_t)(kPackDataAlignment - 1); };
+
+    uint64_t dataOffset = alignUp(header.pathsOffset + paths.size());
+    uint64_t totalSize = 0, totalStoredSize = 0;
+    for(PackInput& input : inputs)
+    {
+        std::ifstream file(input.diskPath, std::ios::binary);
+        std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+        input.entry.size = data.size();
+        input.entry.flags = PackEntryFlag_None;
+        input.storedData = std::move(data);
+
+        // Keep it compressed only if it's worth the decompression
+        if(compress && input.entry.size > 0)
+        {
+            std::vector<uint8_t> compressed(lzCompressBound(input.storedData.size()));
+            size_t compressedSize = lzCompress(input.storedData.data(), input.storedData.size(), compressed.data(), compressed.size());
+            if(compressedSize > 0 && compressedSize < input.storedData.size() * 9 / 10)
+            {
+                compressed.resize(compressedSize);
+                input.storedData = std::move(compressed);
+                input.entry.flags = PackEntryFlag_Compressed;
+            }
+        }
+
+        input.entry.storedSize = input.storedData.size();
+        input.entry.dataOffset = dataOffset;
+        dataOffset = alignUp(dataOffset + input.entry.storedSize);
+
+        totalSize += input.entry.size;
+        totalStoredSize += input.entry.storedSize;
+    }
+
+    FILE* outFile = fopen(outputFile.c_str(), "wb");
+    if(outFile == nullptr)
+    {
+        std::cerr << "Can't open " << outputFile << " for writing" << std::endl;
+        return false;
+    }
+
+    auto writeAt = [outFile](uint64_t offset, void const* data, size_t size)
+    {
+        // Pad with zeros till the offset
+        static const uint8_t zeros[kPackDataAlignment] = {};
+        long position = ftell(outFile);
+        while((uint64_t)position < offset)
+        {
+            size_t padding = std::min<uint64_t>(offset - position, sizeof(zeros));
+            fwrite(zeros, 1, padding, outFile);
+            position += (long)padding;
+        }
+        if(size > 0)
+        {
+            fwrite(data, 1, size, outFile);
+        }
+    };
+
+    writeAt(0, &header, sizeof(header));
+    for(PackInput const& input : inputs)
+    {
+        fwrite(&input.entry, sizeof(PackEntry), 1, outFile);
+    }
+    fwrite(hashTable.data(), sizeof(uint32_t), hashTable.size(), outFile);
+    fwrite(paths.data(), 1, paths.size(), outFile);
+    for(PackInput const& input : inputs)
+    {
+        writeAt(input.entry.dataOffset, input.storedData.data(), input.storedData.size());
+    }
+    fclose(outFile);
+
+    std::cout << "Packed " << inputs.size() << " files, " << totalSize << " bytes stored in " << totalStoredSize << " bytes" << std::endl;
+    return true;
+}
+
 int main(int argc, char **argv)
 {
+    if(argc >= 4 && strcmp(argv[1], "--pack") == 0)
+    {
+        bool compress = !(argc > 4 && strcmp(argv[4], "--nocompress") == 0);
+        return packDirectory(argv[2], argv[3], compress) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
 	if(argc != 3)
 	{
 		std::cerr << "Wrong number of arguments, just give me the the name of input and output file. Example: cow.gltf cow" << std::endl;
+		std::cerr << "To pack a directory: --pack <input dir> <output file> [--nocompress]" << std::endl;
 		return EXIT_FAILURE;
 	}
     
@@ -36,3 +36,15 @@ void changeWorkingDir(eastl::string dir)
 {
     chdir(dir.c_str());
 }
+
+eastl::string joinPath(eastl::string const& basePath, char const* path)
+{
+    if(basePath.empty())
+    {
+        return eastl::string(path);
+    }
+    eastl::string result = basePath;
+    result.push_back('/');
+    result.append(path);
+    return result;
+}
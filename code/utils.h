@@ -10,6 +10,7 @@
 eastl::string   extractBasePath(eastl::string path);
 eastl::string   getCurrentWorkingDir();
 void            changeWorkingDir(eastl::string dir);
+eastl::string   joinPath(eastl::string const& basePath, char const* path); // Returns path if basePath is empty
 
 // INLINE FUNCTIONS
 // ----------------